@@ -1,3 +1,5 @@
 D:\Vulkan\Bin\glslangValidator.exe -V uioverlay.vert -o uioverlay.vert.spv
 D:\Vulkan\Bin\glslangValidator.exe -V uioverlay.frag -o uioverlay.frag.spv
+D:\Vulkan\Bin\glslangValidator.exe -V cull.comp -o cull.comp.spv
+D:\Vulkan\Bin\glslangValidator.exe -V depthpyramid.comp -o depthpyramid.comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,18 @@
+// Decoding of quantized vkglTF vertex components, see vkglTF::VertexLayout
+// Include with GL_GOOGLE_include_directive (glslangValidator and glslc both support it)
+
+// Octahedral encoded direction (R16G16_SNORM normal)
+vec3 octDecode(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0) {
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(v);
+}
+
+// Octahedral encoded tangent (R16G16_SNORM), y is remapped to [0, 1] and its sign is the bitangent handedness
+vec4 tangentDecode(vec2 e)
+{
+	return vec4(octDecode(vec2(e.x, abs(e.y) * 2.0 - 1.0)), e.y < 0.0 ? -1.0 : 1.0);
+}
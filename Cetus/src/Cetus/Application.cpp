@@ -23,12 +23,13 @@ const std::vector<const char*> validationLayers = {
 };
 
 extern bool g_ApplicationRunning;
-static uint32_t s_CurrentFrameIndex = 0;							// ڴ洢ǰֵ֡ÿһ֡ʼʱ
+static uint32_t s_CurrentFrameIndex = 0;							// ǰ֡ÿֺ֡ȡֵΧΪ[0, s_FramesInFlight)
+static uint32_t s_FramesInFlight = 2;								// ֡ApplicationSpecification::FramesInFlightָ
 
 static VkInstance               g_Instance = VK_NULL_HANDLE;		// vkʵ
 static Cetus::VulkanDevice*		g_Device;
 static VkQueue                  g_Queue = VK_NULL_HANDLE;			// 
-static VkDescriptorPool         g_DescriptorPool = VK_NULL_HANDLE;	// 
+static VkQueue                  g_TransferQueue = VK_NULL_HANDLE;	// У豸ûжĴʱg_Queueͬ
 static VkAllocationCallbacks*	g_Allocator = NULL;					// 
 static VkDebugUtilsMessengerEXT g_DebugMessenger = VK_NULL_HANDLE;	// Ա
 static VkPipelineCache          g_PipelineCache = VK_NULL_HANDLE;	// ߻
@@ -36,8 +37,34 @@ static ImGui_ImplVulkanH_Window g_MainWindowData;					// 
 static int                      g_MinImageCount = 2;				// ˫
 static bool                     g_SwapChainRebuild = false;			// һg_SwapChainRebuildڱʾǷҪؽֵڴڴСıʱΪtrue 
 
-static std::vector<std::vector<VkCommandBuffer>> s_AllocatedCommandBuffers;// һάs_AllocatedCommandBuffersڴ洢壬ÿԪһʾһ֡塣
-static std::vector<std::vector<std::function<void()>>> s_ResourceFreeQueue;// һάs_ResourceFreeQueueڴ洢ҪͷŵԴÿԪһʾһ֡ҪͷŵԴÿԴһ󣬱ʾͷŵĲ
+// ÿ֡ӵеԴ֡뽻ͼCPU¼N+1֡ʱGPUִеN֡
+struct FrameContext
+{
+	VkCommandPool	CommandPool = VK_NULL_HANDLE;				// ֡רõأø֡ǰ
+	VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;				// ֡壬ڼ¼ImGuiĻ
+	VkCommandBuffer UploadCommandBuffer = VK_NULL_HANDLE;		// ֡ϴ壬¼ϴͼĿһύǰ
+	bool			UploadRecording = false;					// ϴǷѾʼ¼һεGetUploadCommandBufferʱſʼ
+	VkFence			Fence = VK_NULL_HANDLE;						// ֡ύɺGPUźţCPUø֡ǰȴ
+	VkSemaphore		ImageAcquiredSemaphore = VK_NULL_HANDLE;	// ȡͼɵź
+	std::vector<VkCommandBuffer> AllocatedCommandBuffers;		// ͨGetCommandBufferӸ֡ط
+	uint64_t		SubmittedValue = 0;							// ֡һύʱֵ֧ʱźʱդ״̬ɽ
+};
+static std::vector<FrameContext> s_Frames;							// ֡СΪs_FramesInFlight
+static std::vector<VkFence> s_ImagesInFlight;						// ¼ÿŽͼڱһ֡դʹã򷵻ͼʱҪȴ
+
+// GPUʱߣÿ֡ύһֵӳͷŵԴGPUԽһαʹõֵͷ
+static bool						s_TimelineSemaphoreSupported = false;	// 豸ǷVK_KHR_timeline_semaphore˻صÿ֡դ
+static VkSemaphore				s_TimelineSemaphore = VK_NULL_HANDLE;
+static PFN_vkGetSemaphoreCounterValueKHR s_vkGetSemaphoreCounterValueKHR = nullptr;
+static uint64_t					s_NextTimelineValue = 1;				// һ֡ύֵ
+static uint64_t					s_CompletedTimelineValue = 0;			// GPUȷɵֵ
+
+static constexpr uint32_t		s_MaxBindlessTextures = 65536;			// ްޣ豸޸Сʱȡ豸
+static bool						s_InstanceProperties2Enabled = false;	// ʵǷVK_KHR_get_physical_device_properties2豸ϢԽṹҪ
+static Cetus::ResourceFreeQueue s_ResourceFreeQueue;					// ʱֵӳͷŶ
+static Cetus::StagingRing		s_StagingRing;							// Imageõĳ־ӳϴռ֡ύʱ߻
+static Cetus::FencePool			s_FencePool;							// FlushCommandBufferϴθõդ
+static Cetus::UploadContext		s_UploadContext;						// ϴжʱڴִ
 
 static Cetus::Application* s_Instance = nullptr;
 
@@ -112,6 +139,11 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityF
 				instanceExtensions.push_back(glfwExtensions[i]);
 			}
 		}
+		// ʱźԽṹҪͨVkPhysicalDeviceFeatures2豸ϢVulkan 1.0Ҫʵչ
+		if (std::find(supportedInstanceExtensions.begin(), supportedInstanceExtensions.end(), VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) != supportedInstanceExtensions.end()) {
+			instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			s_InstanceProperties2Enabled = true;
+		}
 		if (enableValidationLayers || std::find(supportedInstanceExtensions.begin(), supportedInstanceExtensions.end(), VK_EXT_DEBUG_UTILS_EXTENSION_NAME) != supportedInstanceExtensions.end()) {
 			instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 		}
@@ -184,37 +216,91 @@ static void SetupVulkan(){
 
 	// ߼豸һͼζ 4_
 	{
-		VkResult res = g_Device->createLogicalDevice({}, {}, nullptr);
+		std::vector<const char*> deviceExtensions;
+		void* pNextChain = nullptr;
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+		if (s_InstanceProperties2Enabled && g_Device->extensionSupported(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		{
+			// չڲԿãȲѯtimelineSemaphoreλ֧ʱ˻صդ
+			PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(g_Instance, "vkGetPhysicalDeviceFeatures2KHR");
+			if (getFeatures2)
+			{
+				VkPhysicalDeviceFeatures2KHR features2{};
+				features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+				features2.pNext = &timelineSemaphoreFeatures;
+				getFeatures2(g_Device->physicalDevice, &features2);
+			}
+		}
+		if (timelineSemaphoreFeatures.timelineSemaphore)
+		{
+			deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			pNextChain = &timelineSemaphoreFeatures;
+			s_TimelineSemaphoreSupported = true;
+		}
+
+		// ԴԤչڴͳʽϴѯÿѵԤ
+		if (s_InstanceProperties2Enabled && g_Device->extensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+		{
+			deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			g_Device->getPhysicalDeviceMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(g_Instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+		}
+
+		// ֧ʱȫֵްԽṹʱź֮ǰ
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+		uint32_t maxBindlessTextures = 0;
+		bool bindlessSupported = s_InstanceProperties2Enabled
+			&& g_Device->extensionSupported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) && g_Device->extensionSupported(VK_KHR_MAINTENANCE3_EXTENSION_NAME)
+			&& Cetus::BindlessTable::querySupport(g_Instance, g_Device->physicalDevice, descriptorIndexingFeatures, maxBindlessTextures);
+		if (bindlessSupported)
+		{
+			deviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			descriptorIndexingFeatures.pNext = pNextChain;
+			pNextChain = &descriptorIndexingFeatures;
+		}
+
+		// ӼƣGPU޳ѿɼѹ󣬻ֱӴӻ
+		bool drawIndirectCountSupported = g_Device->extensionSupported(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (drawIndirectCountSupported)
+			deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+		// ӻƣһvkCmdDrawIndexedIndirectύfirstInstanceΪ±괫ɫ
+		// ֧drawIndirectFirstInstanceʱãglTFģͺFileLoadingFlags::IndirectDrawModel::indirectDrawΪfalse˻صڵ
+		VkPhysicalDeviceFeatures enabledFeatures{};
+		enabledFeatures.multiDrawIndirect = g_Device->features.multiDrawIndirect;
+		enabledFeatures.drawIndirectFirstInstance = g_Device->features.drawIndirectFirstInstance;
+
+		// У豸ִֻ֧Ķʱϴִ
+		VkResult res = g_Device->createLogicalDevice(enabledFeatures, deviceExtensions, pNextChain, true, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
 		if (res != VK_SUCCESS) {
 			Cetus::tools::exitFatal("Could not create Vulkan device: \n" + Cetus::tools::errorString(res), res);
 		}
+		if (bindlessSupported && g_Device->bindlessTable.create(g_Device->logicalDevice, std::min(maxBindlessTextures, s_MaxBindlessTextures)) != VK_SUCCESS) {
+			std::cerr << "Could not create the bindless texture table, textures are bound per draw\n";
+		}
+		// baseԴglTFް±꣩ͨ豸ڽͷŶ
+		g_Device->submitResourceFree = [](std::function<void()>&& func) { Cetus::Application::SubmitResourceFree(std::move(func)); };
+		if (drawIndirectCountSupported)
+			g_Device->cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(g_Device->logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
 		vkGetDeviceQueue(g_Device->logicalDevice, g_Device->queueFamilyIndices.graphics, 0, &g_Queue);
+		vkGetDeviceQueue(g_Device->logicalDevice, g_Device->queueFamilyIndices.transfer, 0, &g_TransferQueue);
 	}
 
-	//  19_
+	// ʱźʼֵΪ0ÿ֡ύs_NextTimelineValue
+	if (s_TimelineSemaphoreSupported)
 	{
-		std::vector<VkDescriptorPoolSize> pool_sizes =
-		{
-			{ VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
-			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
-			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
-			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
-		};
-		VkDescriptorPoolCreateInfo poolInfo = {};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-		poolInfo.maxSets = 1000 * static_cast<uint32_t>(pool_sizes.size());
-		poolInfo.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-		poolInfo.pPoolSizes = pool_sizes.data();
-		if (vkCreateDescriptorPool(g_Device->logicalDevice, &poolInfo, g_Allocator, &g_DescriptorPool) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create descriptor pool!");
+		s_vkGetSemaphoreCounterValueKHR = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(g_Device->logicalDevice, "vkGetSemaphoreCounterValueKHR");
+
+		VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeInfo.initialValue = 0;
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (s_vkGetSemaphoreCounterValueKHR == nullptr || vkCreateSemaphore(g_Device->logicalDevice, &semaphoreInfo, g_Allocator, &s_TimelineSemaphore) != VK_SUCCESS) {
+			s_TimelineSemaphoreSupported = false;	// ˻صդ
 		}
 	}
 }
@@ -245,7 +331,8 @@ static void SetupVulkanWindow(ImGui_ImplVulkanH_Window* wd, VkSurfaceKHR surface
 
 static void CleanupVulkan()
 {
-	vkDestroyDescriptorPool(g_Device->logicalDevice, g_DescriptorPool, g_Allocator);
+	if (s_TimelineSemaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(g_Device->logicalDevice, s_TimelineSemaphore, g_Allocator);
 
 	if (enableValidationLayers) {
 		auto func = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(g_Instance, "vkDestroyDebugUtilsMessengerEXT");
@@ -263,13 +350,169 @@ static void CleanupVulkanWindow()
 	ImGui_ImplVulkanH_DestroyWindow(g_Instance, g_Device->logicalDevice, &g_MainWindowData, g_Allocator);
 }
 
+static void CreateFrameContexts(uint32_t framesInFlight)	// ֡ÿ֡ӵԼء塢դź
+{
+	s_Frames.resize(framesInFlight);
+	for (FrameContext& frame : s_Frames)
+	{
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = g_Device->queueFamilyIndices.graphics;
+		if (vkCreateCommandPool(g_Device->logicalDevice, &poolInfo, g_Allocator, &frame.CommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create frame command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = frame.CommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(g_Device->logicalDevice, &allocInfo, &frame.CommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate frame command buffer!");
+		}
+		if (vkAllocateCommandBuffers(g_Device->logicalDevice, &allocInfo, &frame.UploadCommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate frame upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;			// ʼΪѴ״̬һεȴʱ
+		if (vkCreateFence(g_Device->logicalDevice, &fenceInfo, g_Allocator, &frame.Fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create frame fence!");
+		}
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(g_Device->logicalDevice, &semaphoreInfo, g_Allocator, &frame.ImageAcquiredSemaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create frame semaphore!");
+		}
+	}
+}
+
+static void DestroyFrameContexts()
+{
+	for (FrameContext& frame : s_Frames)
+	{
+		vkDestroySemaphore(g_Device->logicalDevice, frame.ImageAcquiredSemaphore, g_Allocator);
+		vkDestroyFence(g_Device->logicalDevice, frame.Fence, g_Allocator);
+		vkDestroyCommandPool(g_Device->logicalDevice, frame.CommandPool, g_Allocator);	// ػһͷŴз
+	}
+	s_Frames.clear();
+	s_ImagesInFlight.clear();
+}
+
+static uint64_t QueryCompletedTimelineValue()	// ѯGPUɵʱֵ
+{
+	if (s_TimelineSemaphoreSupported)
+	{
+		uint64_t value = 0;
+		if (s_vkGetSemaphoreCounterValueKHR(g_Device->logicalDevice, s_TimelineSemaphore, &value) == VK_SUCCESS && value > s_CompletedTimelineValue)
+			s_CompletedTimelineValue = value;
+	}
+	else
+	{
+		// ͬһϵύ˳ɣդѴ֡ύֵɵֵ
+		for (const FrameContext& frame : s_Frames)
+		{
+			if (frame.SubmittedValue > s_CompletedTimelineValue && vkGetFenceStatus(g_Device->logicalDevice, frame.Fence) == VK_SUCCESS)
+				s_CompletedTimelineValue = frame.SubmittedValue;
+		}
+	}
+	return s_CompletedTimelineValue;
+}
+
+static void SubmitFrame(VkSubmitInfo& info, FrameContext& frame)	// ύһ֡ʱֵá֡դ
+{
+	std::vector<VkSemaphore> signalSemaphores(info.pSignalSemaphores, info.pSignalSemaphores + info.signalSemaphoreCount);
+	std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);	// ֵźӦֵᱻ
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+	if (s_TimelineSemaphoreSupported)
+	{
+		signalSemaphores.push_back(s_TimelineSemaphore);
+		signalValues.push_back(s_NextTimelineValue);
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.signalSemaphoreValueCount = (uint32_t)signalValues.size();
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+		timelineInfo.pNext = info.pNext;
+		info.pNext = &timelineInfo;
+		info.signalSemaphoreCount = (uint32_t)signalSemaphores.size();
+		info.pSignalSemaphores = signalSemaphores.data();
+	}
+
+	vkResetFences(g_Device->logicalDevice, 1, &frame.Fence);
+	if (vkQueueSubmit(g_Queue, 1, &info, frame.Fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit draw command buffer!");
+	}
+	frame.SubmittedValue = s_NextTimelineValue++;
+	s_StagingRing.Retire(frame.SubmittedValue);		// ֡дϴύɺ󼴿ɸ
+}
+
+static void BeginFrameContext()	// ʼõǰ֡ȴһεύִϣȻͷԴ
+{
+	FrameContext& frame = s_Frames[s_CurrentFrameIndex];
+	// ֻȴդդύǰãύ֡Сڣ´εȴʱ
+	vkWaitForFences(g_Device->logicalDevice, 1, &frame.Fence, VK_TRUE, UINT64_MAX);
+
+	// ͷGPUѾԴڵǰ֡κύ֮ǰԴͷ
+	const uint64_t completedValue = QueryCompletedTimelineValue();
+	s_ResourceFreeQueue.Collect(completedValue);
+	s_StagingRing.Collect(completedValue);
+	g_Device->descriptorAllocator.beginFrame(s_CurrentFrameIndex);	// һ֡ÿ֡
+	s_UploadContext.Collect();
+	{// ͷGetCommandBuffer岢
+		if (frame.AllocatedCommandBuffers.size() > 0)
+		{
+			vkFreeCommandBuffers(g_Device->logicalDevice, frame.CommandPool, (uint32_t)frame.AllocatedCommandBuffers.size(), frame.AllocatedCommandBuffers.data());
+			frame.AllocatedCommandBuffers.clear();
+		}
+		if (vkResetCommandPool(g_Device->logicalDevice, frame.CommandPool, 0) != VK_SUCCESS) {
+			throw std::runtime_error("failed to reset command Pool!");
+		}
+		frame.UploadRecording = false;
+	}
+}
+
+static uint32_t EndFrameUploads(FrameContext& frame, VkCommandBuffer* commandBuffers)	// ֡ϴ壬Ҫǰύ
+{
+	if (!frame.UploadRecording)
+		return 0;
+	if (vkEndCommandBuffer(frame.UploadCommandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record upload command buffer!");
+	}
+	frame.UploadRecording = false;
+	commandBuffers[0] = frame.UploadCommandBuffer;
+	return 1;
+}
+
+// ϴеȴͼζлȡͼȨ¼֡ϴر֡ύҪȴź
+static void AcquireFrameUploads(std::vector<VkSemaphore>& waitSemaphores, std::vector<VkPipelineStageFlags>& waitStages)
+{
+	// ֡ڼ¼ûύͳһύ֤ڱ֡Ļ֮ǰ
+	s_UploadContext.Submit();
+
+	std::vector<VkImageMemoryBarrier> barriers;
+	std::vector<VkSemaphore> semaphores;
+	VkPipelineStageFlags dstStages = 0;
+	if (!s_UploadContext.TakePendingAcquires(barriers, dstStages, semaphores))
+		return;
+
+	VkCommandBuffer command_buffer = Cetus::Application::GetUploadCommandBuffer();
+	vkCmdPipelineBarrier(command_buffer, dstStages, dstStages, 0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+	for (VkSemaphore semaphore : semaphores)
+	{
+		waitSemaphores.push_back(semaphore);
+		waitStages.push_back(dstStages);
+		// ֡ύɺźٴα
+		Cetus::Application::SubmitResourceFree([semaphore]() { s_UploadContext.RecycleSemaphore(semaphore); });
+	}
+}
+
 static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data) // һ֡
 {
 	VkResult err;
 
-	VkSemaphore image_acquired_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
-	VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
-	err = vkAcquireNextImageKHR(g_Device->logicalDevice, wd->Swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE, &wd->FrameIndex);
+	FrameContext& frame = s_Frames[s_CurrentFrameIndex];
+	err = vkAcquireNextImageKHR(g_Device->logicalDevice, wd->Swapchain, UINT64_MAX, frame.ImageAcquiredSemaphore, VK_NULL_HANDLE, &wd->FrameIndex);
 	if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
 	{
 		g_SwapChainRebuild = true;//ؽ
@@ -279,35 +522,17 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data) //
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
+	// 򷵻ؽͼͼԱһ֡ʹãֻȴһ֡
+	if (s_ImagesInFlight[wd->FrameIndex] != VK_NULL_HANDLE && s_ImagesInFlight[wd->FrameIndex] != frame.Fence)
+		vkWaitForFences(g_Device->logicalDevice, 1, &s_ImagesInFlight[wd->FrameIndex], VK_TRUE, UINT64_MAX);
+	s_ImagesInFlight[wd->FrameIndex] = frame.Fence;
 
-	s_CurrentFrameIndex = (s_CurrentFrameIndex + 1) % g_MainWindowData.ImageCount;
-
-	ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
-	{
-		vkWaitForFences(g_Device->logicalDevice, 1, &fd->Fence, VK_TRUE, UINT64_MAX);    // ȴһ֡Ⱦ
-		vkResetFences(g_Device->logicalDevice, 1, &fd->Fence);
-	}
-	
-	{// ִжԴĲ
-		for (auto& func : s_ResourceFreeQueue[s_CurrentFrameIndex])
-			func();
-		s_ResourceFreeQueue[s_CurrentFrameIndex].clear();
-	}
+	ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];	// ͼֻṩ֡壬ͬԷ֡
 	{
-		auto& allocatedCommandBuffers = s_AllocatedCommandBuffers[wd->FrameIndex];
-		if (allocatedCommandBuffers.size() > 0)
-		{
-			vkFreeCommandBuffers(g_Device->logicalDevice, fd->CommandPool, (uint32_t)allocatedCommandBuffers.size(), allocatedCommandBuffers.data());
-			allocatedCommandBuffers.clear();
-		}
-
-		if (vkResetCommandPool(g_Device->logicalDevice, fd->CommandPool, 0) != VK_SUCCESS) {
-			throw std::runtime_error("failed to reset command Pool!");
-		}
 		VkCommandBufferBeginInfo info = {};
 		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		if (vkBeginCommandBuffer(fd->CommandBuffer, &info) != VK_SUCCESS) {
+		if (vkBeginCommandBuffer(frame.CommandBuffer, &info) != VK_SUCCESS) {
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
 	}
@@ -321,40 +546,63 @@ static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data) //
 		info.renderArea.extent.height = wd->Height;
 		info.clearValueCount = 1;
 		info.pClearValues = &wd->ClearValue;
-		vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(frame.CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
 	}
 
 	// Record dear imgui primitives into command buffer
-	ImGui_ImplVulkan_RenderDrawData(draw_data, fd->CommandBuffer);
+	ImGui_ImplVulkan_RenderDrawData(draw_data, frame.CommandBuffer);
 
 	// Submit command buffer
-	vkCmdEndRenderPass(fd->CommandBuffer);
+	vkCmdEndRenderPass(frame.CommandBuffer);
 	{
-		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->FrameIndex].RenderCompleteSemaphore;	// ͼѡ񣬳ǰᱻ
+		std::vector<VkSemaphore> wait_semaphores = { frame.ImageAcquiredSemaphore };
+		std::vector<VkPipelineStageFlags> wait_stages = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		AcquireFrameUploads(wait_semaphores, wait_stages);
 		VkSubmitInfo info = {};
 		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		info.waitSemaphoreCount = 1;
-		info.pWaitSemaphores = &image_acquired_semaphore;
-		info.pWaitDstStageMask = &wait_stage;
-		info.commandBufferCount = 1;
-		info.pCommandBuffers = &fd->CommandBuffer;
+		info.waitSemaphoreCount = (uint32_t)wait_semaphores.size();
+		info.pWaitSemaphores = wait_semaphores.data();
+		info.pWaitDstStageMask = wait_stages.data();
+		VkCommandBuffer command_buffers[2];
+		uint32_t command_buffer_count = EndFrameUploads(frame, command_buffers);
+		command_buffers[command_buffer_count++] = frame.CommandBuffer;
+		info.commandBufferCount = command_buffer_count;
+		info.pCommandBuffers = command_buffers;
 		info.signalSemaphoreCount = 1;
 		info.pSignalSemaphores = &render_complete_semaphore;
 
-		if (vkEndCommandBuffer(fd->CommandBuffer) != VK_SUCCESS) {
+		if (vkEndCommandBuffer(frame.CommandBuffer) != VK_SUCCESS) {
 			throw std::runtime_error("failed to record command buffer!");
 		}
-		if (vkQueueSubmit(g_Queue, 1, &info, fd->Fence) != VK_SUCCESS) {
-			throw std::runtime_error("failed to submit draw command buffer!");
-		}
+		SubmitFrame(info, frame);
 	}
 }
 
+static void FrameRetire()	// ֡ûȾС򽻻ڣʱȻύ֡ϴñ֡ڼͷŶеԴճʱ
+{
+	FrameContext& frame = s_Frames[s_CurrentFrameIndex];
+	std::vector<VkSemaphore> wait_semaphores;
+	std::vector<VkPipelineStageFlags> wait_stages;
+	AcquireFrameUploads(wait_semaphores, wait_stages);
+	if (!frame.UploadRecording && s_ResourceFreeQueue.Empty())
+		return;
+	VkCommandBuffer command_buffers[1];
+	VkSubmitInfo info = {};
+	info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	info.waitSemaphoreCount = (uint32_t)wait_semaphores.size();
+	info.pWaitSemaphores = wait_semaphores.data();
+	info.pWaitDstStageMask = wait_stages.data();
+	info.commandBufferCount = EndFrameUploads(frame, command_buffers);
+	info.pCommandBuffers = command_buffers;
+	SubmitFrame(info, frame);
+}
+
 static void FramePresent(ImGui_ImplVulkanH_Window* wd) // ֶ
 {
 	if (g_SwapChainRebuild)
 		return;
-	VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
+	VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->FrameIndex].RenderCompleteSemaphore;
 	VkPresentInfoKHR info = {};
 	info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	info.waitSemaphoreCount = 1;
@@ -371,8 +619,6 @@ static void FramePresent(ImGui_ImplVulkanH_Window* wd) // 
 	else if (err != VK_SUCCESS) {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
-
-	wd->SemaphoreIndex = (wd->SemaphoreIndex + 1) % wd->ImageCount; // Now we can use the next set of semaphores
 }
 
 static void glfw_error_callback(int error, const char* description)
@@ -421,6 +667,9 @@ namespace Cetus {
 			return;
 		}
 		SetupVulkan();
+		s_StagingRing.Init(g_Device, m_Specification.StagingRingSize);
+		s_FencePool.Init(g_Device->logicalDevice);
+		s_UploadContext.Init(g_Device, &s_FencePool, g_TransferQueue, g_Device->queueFamilyIndices.transfer, g_Queue, g_Device->queueFamilyIndices.graphics);
 
 		// Create Window Surface
 		VkSurfaceKHR surface;
@@ -435,8 +684,9 @@ namespace Cetus {
 		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
 		SetupVulkanWindow(wd, surface, w, h);
 
-		s_AllocatedCommandBuffers.resize(wd->ImageCount);
-		s_ResourceFreeQueue.resize(wd->ImageCount);
+		s_FramesInFlight = m_Specification.FramesInFlight > 0 ? m_Specification.FramesInFlight : 1;
+		CreateFrameContexts(s_FramesInFlight);
+		s_ImagesInFlight.assign(wd->ImageCount, VK_NULL_HANDLE);
 
 		// Setup Dear ImGui context
 		IMGUI_CHECKVERSION();
@@ -470,10 +720,14 @@ namespace Cetus {
 		init_info.QueueFamily = g_Device->queueFamilyIndices.graphics;
 		init_info.Queue = g_Queue;
 		init_info.PipelineCache = g_PipelineCache;
-		init_info.DescriptorPool = g_DescriptorPool;
+		{// ImGuiֻͼͷļϣһеĶأĶ
+			VkDescriptorPoolSize imguiPoolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 };
+			init_info.DescriptorPool = g_Device->descriptorAllocator.createExternalPool(&imguiPoolSize, 1, 1000);
+			IM_ASSERT(init_info.DescriptorPool != VK_NULL_HANDLE);
+		}
 		init_info.Subpass = 0;
 		init_info.MinImageCount = g_MinImageCount;
-		init_info.ImageCount = wd->ImageCount;
+		init_info.ImageCount = wd->ImageCount > s_FramesInFlight ? wd->ImageCount : s_FramesInFlight;	// ImGuiĶ㻺廷ImageCountתڷ֡ḲGPUڶȡĻ
 		init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 		init_info.Allocator = g_Allocator;
 		init_info.CheckVkResultFn = check_vk_result;
@@ -514,6 +768,8 @@ namespace Cetus {
 			check_vk_result(err);
 			ImGui_ImplVulkan_DestroyFontUploadObjects();
 		}
+
+		BeginFrameContext();	// һ֡ؾOnAttach/OnUpdateԵGetCommandBuffer
 	}
 
 	void Application::Shutdown()
@@ -528,12 +784,12 @@ namespace Cetus {
 		check_vk_result(err);
 
 		// Free resources in queue
-		for (auto& queue : s_ResourceFreeQueue)
-		{
-			for (auto& func : queue)
-				func();
-		}
-		s_ResourceFreeQueue.clear();
+		s_ResourceFreeQueue.Flush();
+		g_Device->submitResourceFree = nullptr;	// ֮ͷŵԴ豸ѾУֱͷ
+		s_StagingRing.Shutdown();
+		s_UploadContext.Shutdown();
+		s_FencePool.Shutdown();
+		DestroyFrameContexts();
 
 		ImGui_ImplVulkan_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
@@ -580,9 +836,8 @@ namespace Cetus {
 					ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_Device->physicalDevice, g_Device->logicalDevice, &g_MainWindowData, g_Device->queueFamilyIndices.graphics, g_Allocator, width, height, g_MinImageCount);
 					g_MainWindowData.FrameIndex = 0;
 
-					// Clear allocated command buffers from here since entire pool is destroyed
-					s_AllocatedCommandBuffers.clear();
-					s_AllocatedCommandBuffers.resize(g_MainWindowData.ImageCount);
+					// ͼܸı䣬ͼդ¼Ч֡زܽؽӰ
+					s_ImagesInFlight.assign(g_MainWindowData.ImageCount, VK_NULL_HANDLE);
 
 					g_SwapChainRebuild = false;
 				}
@@ -658,6 +913,7 @@ namespace Cetus {
 			wd->ClearValue.color.float32[1] = clear_color.y * clear_color.w;
 			wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
 			wd->ClearValue.color.float32[3] = clear_color.w;
+			const uint64_t frameTimelineValue = s_NextTimelineValue;
 			if (!main_is_minimized)
 				FrameRender(wd, main_draw_data);
 
@@ -672,6 +928,13 @@ namespace Cetus {
 			if (!main_is_minimized)
 				FramePresent(wd);
 
+			if (s_NextTimelineValue == frameTimelineValue)
+				FrameRetire();
+
+			// лһ֡ȴһεύɺٿʼһOnUpdate
+			s_CurrentFrameIndex = (s_CurrentFrameIndex + 1) % s_FramesInFlight;
+			BeginFrameContext();
+
 			float time = GetTime();
 			m_FrameTime = time - m_LastFrameTime;
 			m_TimeStep = glm::min<float>(m_FrameTime, 0.0333f);
@@ -707,10 +970,10 @@ namespace Cetus {
 
 	VkCommandBuffer Application::GetCommandBuffer(bool begin)
 	{
-		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
+		FrameContext& frame = s_Frames[s_CurrentFrameIndex];
 
-		// Use any command queue
-		VkCommandPool command_pool = wd->Frames[wd->FrameIndex].CommandPool;
+		// ӵǰ֡ط䣬֡ǰͳһͷ
+		VkCommandPool command_pool = frame.CommandPool;
 
 		VkCommandBufferAllocateInfo cmdBufAllocateInfo = {};
 		cmdBufAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -718,7 +981,7 @@ namespace Cetus {
 		cmdBufAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 		cmdBufAllocateInfo.commandBufferCount = 1;
 
-		VkCommandBuffer& command_buffer = s_AllocatedCommandBuffers[wd->FrameIndex].emplace_back();
+		VkCommandBuffer& command_buffer = frame.AllocatedCommandBuffers.emplace_back();
 		auto err = vkAllocateCommandBuffers(g_Device->logicalDevice, &cmdBufAllocateInfo, &command_buffer);
 
 		VkCommandBufferBeginInfo begin_info = {};
@@ -739,13 +1002,8 @@ namespace Cetus {
 		auto err = vkEndCommandBuffer(commandBuffer);
 		check_vk_result(err);
 
-		// Create fence to ensure that the command buffer has finished executing
-		VkFenceCreateInfo fenceCreateInfo = {};
-		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceCreateInfo.flags = 0;
-		VkFence fence;
-		err = vkCreateFence(g_Device->logicalDevice, &fenceCreateInfo, nullptr, &fence);
-		check_vk_result(err);
+		// Take a pooled fence to ensure that the command buffer has finished executing
+		VkFence fence = s_FencePool.Acquire();
 
 		err = vkQueueSubmit(g_Queue, 1, &end_info, fence);
 		check_vk_result(err);
@@ -753,13 +1011,63 @@ namespace Cetus {
 		err = vkWaitForFences(g_Device->logicalDevice, 1, &fence, VK_TRUE, UINT64_MAX);
 		check_vk_result(err);
 
-		vkDestroyFence(g_Device->logicalDevice, fence, nullptr);
+		s_FencePool.Release(fence);
+	}
+
+
+	VkCommandBuffer Application::GetUploadCommandBuffer()
+	{
+		FrameContext& frame = s_Frames[s_CurrentFrameIndex];
+		if (!frame.UploadRecording)
+		{
+			VkCommandBufferBeginInfo begin_info = {};
+			begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			auto err = vkBeginCommandBuffer(frame.UploadCommandBuffer, &begin_info);
+			check_vk_result(err);
+			frame.UploadRecording = true;
+		}
+		return frame.UploadCommandBuffer;
+	}
+
+	UploadContext& Application::GetUploadContext()
+	{
+		return s_UploadContext;
+	}
+
+	StagingRing& Application::GetStagingRing()
+	{
+		return s_StagingRing;
+	}
+
+	MemoryAllocator& Application::GetMemoryAllocator()
+	{
+		return g_Device->memoryAllocator;
+	}
+
+	DescriptorAllocator& Application::GetDescriptorAllocator()
+	{
+		return g_Device->descriptorAllocator;
+	}
+
+	BindlessTable* Application::GetBindlessTable()
+	{
+		return g_Device->bindlessTable.isCreated() ? &g_Device->bindlessTable : nullptr;
+	}
+
+	VulkanDevice& Application::GetVulkanDevice()
+	{
+		return *g_Device;
 	}
 
+	ResourceFreeQueue& Application::GetResourceFreeQueue()
+	{
+		return s_ResourceFreeQueue;
+	}
 
-	void Application::SubmitResourceFree(std::function<void()>&& func)
+	uint64_t Application::GetFrameTimelineValue()
 	{
-		s_ResourceFreeQueue[s_CurrentFrameIndex].emplace_back(func);
+		return s_NextTimelineValue;
 	}
 
 }
@@ -3,6 +3,9 @@
 #include "Layer.h"
 #include "base/VulkanDebug.h"
 #include "base/VulkanDevice.h"
+#include "ResourceFreeQueue.h"
+#include "StagingRing.h"
+#include "UploadContext.h"
 
 #include <string>
 #include <vector>
@@ -23,6 +26,8 @@ namespace Cetus {
 		std::string Name = "Cetus App";		// һstd::string͵ĳԱڴ洢ӦóƣĬΪ"Cetus App"
 		uint32_t Width = 1600;				// һuint32_t͵ĳԱڴ洢ӦóĿȣĬΪ1600
 		uint32_t Height = 900;				// һuint32_t͵ĳԱڴ洢Ӧóĸ߶ȣĬΪ900
+		uint32_t FramesInFlight = 2;		// ͬʱGPUִе֡֡뽻ͼ޹أĬΪ2
+		uint64_t StagingRingSize = 64ull * 1024 * 1024;	// ImageõϴСĬΪ64MB
 	};
 
 
@@ -63,6 +68,13 @@ namespace Cetus {
 
 		static VkCommandBuffer GetCommandBuffer(bool begin);			// һ̬ڻȡVulkan󣬽һֵΪָǷʼ¼һVkCommandBuffer͵ֵ
 		static void FlushCommandBuffer(VkCommandBuffer commandBuffer);	// һ̬ύVulkan󣬽һVkCommandBuffer͵ĲָҪύ
+		static VkCommandBuffer GetUploadCommandBuffer();				// ȡǰ֡ϴ壨ѿʼ¼汾֡һύڻ֮ǰҪԼύ
+		static StagingRing& GetStagingRing();							// ȡImageõϴĿռڵǰ֡ύɺ
+		static MemoryAllocator& GetMemoryAllocator();					// ȡ豸ڴӷImageԴڴ涼
+		static DescriptorAllocator& GetDescriptorAllocator();			// ȡפϿͷţÿ֡֡ʼʱ
+		static BindlessTable* GetBindlessTable();						// ȡް豸֧ʱnullptr
+		static VulkanDevice& GetVulkanDevice();							// ȡ豸װɲѯԴԤڴͳ
+		static UploadContext& GetUploadContext();						// ȡϴģഫϲΪһύؿɵȴƱ
 		// ֵһֱʽֵ𣬱ʾһҿɱƶıʽֵһǲѰַĳڱʽֵдʱ󣬶ԵġֵܳڸֵʽߣҲܱ޸ġֵʼֵãʵƶ壬߳12
 		//	磬±ʽֵֵ
 		//	ֵ(ֵַ)1a, true
@@ -73,7 +85,11 @@ namespace Cetus {
 		//	Ƚϱʽ
 		//	ȡַʽ
 		//	lambdaʽ
-		static void SubmitResourceFree(std::function<void()>&& func);	// һ̬ύԴͷŵĺһstd::function<void()>͵ֵΪָҪִеԴͷŵĺ
+		// ύԴͷŵĺGPUɵǰ֡ύִСֱӴͷŶе洢УݲܳResourceFreeQueue::InlineStorageSizeֽ
+		template<typename F>
+		static void SubmitResourceFree(F&& func) { GetResourceFreeQueue().Push(GetFrameTimelineValue(), std::forward<F>(func)); }
+		static ResourceFreeQueue& GetResourceFreeQueue();				// ȡGPUʱֵӳͷŶ
+		static uint64_t GetFrameTimelineValue();						// ȡǰ֡ύʱʱֵǰ֡¼Ƶֵɺִ
 
 		struct AppSettings {
 			bool enableValidationLayers = true;
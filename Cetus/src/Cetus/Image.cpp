@@ -8,28 +8,19 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace Cetus {
 
 	namespace Utils {
 
-		static uint32_t GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits)
-		{
-			VkPhysicalDeviceMemoryProperties prop;
-			vkGetPhysicalDeviceMemoryProperties(Application::GetPhysicalDevice(), &prop);
-			for (uint32_t i = 0; i < prop.memoryTypeCount; i++)
-			{
-				if ((prop.memoryTypes[i].propertyFlags & properties) == properties && type_bits & (1 << i))
-					return i;
-			}
-			
-			return 0xffffffff;
-		}
-
 		static uint32_t BytesPerPixel(ImageFormat format)
 		{
 			switch (format)
 			{
 				case ImageFormat::RGBA:    return 4;
+				case ImageFormat::RGBA16F: return 8;
 				case ImageFormat::RGBA32F: return 16;
 			}
 			return 0;
@@ -40,6 +31,7 @@ namespace Cetus {
 			switch (format)
 			{
 				case ImageFormat::RGBA:    return VK_FORMAT_R8G8B8A8_UNORM;
+				case ImageFormat::RGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
 				case ImageFormat::RGBA32F: return VK_FORMAT_R32G32B32A32_SFLOAT;
 			}
 			return (VkFormat)0;
@@ -64,18 +56,18 @@ namespace Cetus {
 			m_Format = ImageFormat::RGBA;
 		}
 
-		m_Width = width;
-		m_Height = height;
+		m_Width = m_CapacityWidth = width;
+		m_Height = m_CapacityHeight = height;
 		
-		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
-		SetData(data);
+		AllocateMemory(true);	// file contents are uploaded once
+		SetData(data, Application::GetUploadContext());	// batched with other loads, submitted at the latest with the next frame
 		stbi_image_free(data);
 	}
 
 	Image::Image(uint32_t width, uint32_t height, ImageFormat format, const void* data)
-		: m_Width(width), m_Height(height), m_Format(format)
+		: m_Width(width), m_Height(height), m_CapacityWidth(width), m_CapacityHeight(height), m_Format(format)
 	{
-		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
+		AllocateMemory();
 		if (data)
 			SetData(data);
 	}
@@ -85,7 +77,7 @@ namespace Cetus {
 		Release();
 	}
 
-	void Image::AllocateMemory(uint64_t size)
+	void Image::AllocateMemory(bool writeOnce)
 	{
 		VkDevice device = Application::GetDevice();
 
@@ -93,34 +85,64 @@ namespace Cetus {
 		
 		VkFormat vulkanFormat = Utils::CetusFormatToVulkanFormat(m_Format);
 
+		// On ReBAR/UMA systems a write-once image can be a linear image in device-local host-visible memory that the CPU fills directly,
+		// as long as the device can sample the format with linear tiling at this size. Images that are updated repeatedly
+		// (e.g. the renderer's final image) stay optimal: later updates are staged copies anyway, and sampling linear tiling is slower
+		bool direct = false;
+		if (writeOnce && Application::GetVulkanDevice().directUploadSupported())
+		{
+			VkImageFormatProperties properties;
+			err = vkGetPhysicalDeviceImageFormatProperties(Application::GetPhysicalDevice(), vulkanFormat, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_LINEAR,
+				VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0, &properties);
+			direct = err == VK_SUCCESS && properties.maxExtent.width >= m_CapacityWidth && properties.maxExtent.height >= m_CapacityHeight;
+		}
+
 		// Create the Image
+		// When the BAR heap is exhausted the Dynamic intent fails or falls back to host memory, where a linear image would be
+		// sampled across the bus; the image is then recreated as an optimal image in plain device memory and filled by copies
+		MemoryAllocator& allocator = Application::GetMemoryAllocator();
+		const VkMemoryPropertyFlags mapped_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		for (;;)
 		{
 			VkImageCreateInfo info = {};
 			info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 			info.imageType = VK_IMAGE_TYPE_2D;
 			info.format = vulkanFormat;
-			info.extent.width = m_Width;
-			info.extent.height = m_Height;
+			info.extent.width = m_CapacityWidth;
+			info.extent.height = m_CapacityHeight;
 			info.extent.depth = 1;
 			info.mipLevels = 1;
 			info.arrayLayers = 1;
 			info.samples = VK_SAMPLE_COUNT_1_BIT;
-			info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			info.tiling = direct ? VK_IMAGE_TILING_LINEAR : VK_IMAGE_TILING_OPTIMAL;
 			info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 			info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			info.initialLayout = direct ? VK_IMAGE_LAYOUT_PREINITIALIZED : VK_IMAGE_LAYOUT_UNDEFINED;
 			err = vkCreateImage(device, &info, nullptr, &m_Image);
 			check_vk_result(err);
-			VkMemoryRequirements req;
-			vkGetImageMemoryRequirements(device, m_Image, &req);
-			VkMemoryAllocateInfo alloc_info = {};
-			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			alloc_info.allocationSize = req.size;
-			alloc_info.memoryTypeIndex = Utils::GetVulkanMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, req.memoryTypeBits);
-			err = vkAllocateMemory(device, &alloc_info, nullptr, &m_Memory);
-			check_vk_result(err);
-			err = vkBindImageMemory(device, m_Image, m_Memory, 0);
+			// Images share device memory blocks; very large ones get a dedicated allocation
+			err = allocator.allocateForImage(m_Image, direct ? MemoryUsage::Dynamic : MemoryUsage::GpuOnly, &m_Allocation, direct);
+			if (direct && (err != VK_SUCCESS || !m_Allocation.mapped ||
+				(allocator.getMemoryProperties().memoryTypes[m_Allocation.memoryType].propertyFlags & mapped_flags) != mapped_flags))
+			{
+				allocator.free(m_Allocation);
+				vkDestroyImage(device, m_Image, nullptr);
+				m_Image = VK_NULL_HANDLE;
+				direct = false;
+				continue;
+			}
 			check_vk_result(err);
+			break;
+		}
+
+		if (direct)
+		{
+			VkImageSubresource subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+			VkSubresourceLayout layout;
+			vkGetImageSubresourceLayout(device, m_Image, &subresource, &layout);
+			m_Mapped = (uint8_t*)m_Allocation.mapped + layout.offset;
+			m_RowPitch = layout.rowPitch;
+			m_Layout = VK_IMAGE_LAYOUT_PREINITIALIZED;
 		}
 
 		// Create the Image View:
@@ -137,7 +159,8 @@ namespace Cetus {
 			check_vk_result(err);
 		}
 
-		// Create sampler:
+		// Create sampler (kept across resizes):
+		if (!m_Sampler)
 		{
 			VkSamplerCreateInfo info = {};
 			info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -154,91 +177,209 @@ namespace Cetus {
 			check_vk_result(err);
 		}
 
-		// Create the Descriptor Set:
-		m_DescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(m_Sampler, m_ImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		// Register in the bindless table
+		if (BindlessTable* table = Application::GetBindlessTable())
+			m_BindlessIndex = table->registerTexture({ m_Sampler, m_ImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+	}
+
+	VkDescriptorSet Image::GetDescriptorSet() const
+	{
+		if (!m_DescriptorSet)
+			m_DescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(m_Sampler, m_ImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		return m_DescriptorSet;
 	}
 
 	void Image::Release()
 	{
-		Application::SubmitResourceFree([sampler = m_Sampler, imageView = m_ImageView, image = m_Image,
-			memory = m_Memory, stagingBuffer = m_StagingBuffer, stagingBufferMemory = m_StagingBufferMemory]()
+		ReleaseImage();
+
+		Application::SubmitResourceFree([sampler = m_Sampler]()
+		{
+			vkDestroySampler(Application::GetDevice(), sampler, nullptr);
+		});
+		m_Sampler = nullptr;
+	}
+
+	void Image::ReleaseImage()
+	{
+		// Frames in flight may still sample the bindless slot, so it is returned together with the view
+		Application::SubmitResourceFree([imageView = m_ImageView, image = m_Image, allocation = m_Allocation, descriptorSet = m_DescriptorSet, bindlessIndex = m_BindlessIndex]() mutable
 		{
 			VkDevice device = Application::GetDevice();
 
-			vkDestroySampler(device, sampler, nullptr);
+			if (descriptorSet)
+				ImGui_ImplVulkan_RemoveTexture(descriptorSet);
+			if (BindlessTable* table = Application::GetBindlessTable())
+				table->unregisterTexture(bindlessIndex);
+
 			vkDestroyImageView(device, imageView, nullptr);
 			vkDestroyImage(device, image, nullptr);
-			vkFreeMemory(device, memory, nullptr);
-			vkDestroyBuffer(device, stagingBuffer, nullptr);
-			vkFreeMemory(device, stagingBufferMemory, nullptr);
+			Application::GetMemoryAllocator().free(allocation);
 		});
 
-		m_Sampler = nullptr;
 		m_ImageView = nullptr;
 		m_Image = nullptr;
-		m_Memory = nullptr;
-		m_StagingBuffer = nullptr;
-		m_StagingBufferMemory = nullptr;
+		m_Allocation = Allocation();
+		m_DescriptorSet = nullptr;
+		m_BindlessIndex = BindlessTable::invalidIndex;
+		m_Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		m_Mapped = nullptr;
+		m_RowPitch = 0;
 	}
 
-	void Image::SetData(const void* data)
+	bool Image::WriteMapped(const void* data)
 	{
-		VkDevice device = Application::GetDevice();
+		// Only before the first upload: afterwards frames in flight may be sampling the memory, so updates go through a staged copy
+		if (!m_Mapped || m_Layout != VK_IMAGE_LAYOUT_PREINITIALIZED)
+			return false;
+
+		size_t row_size = (size_t)m_Width * Utils::BytesPerPixel(m_Format);
+		const uint8_t* source = (const uint8_t*)data;
+		if (row_size == m_RowPitch)
+			memcpy(m_Mapped, source, row_size * m_Height);
+		else
+		{
+			for (uint32_t y = 0; y < m_Height; y++)
+				memcpy(m_Mapped + y * m_RowPitch, source + y * row_size, row_size);
+		}
 
-		size_t upload_size = m_Width * m_Height * Utils::BytesPerPixel(m_Format);
+		MemoryAllocator& allocator = Application::GetMemoryAllocator();
+		if ((allocator.getMemoryProperties().memoryTypes[m_Allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+			allocator.flush(m_Allocation, 0, m_Allocation.size);
+		return true;
+	}
 
-		VkResult err;
+	void Image::SetData(const void* data, bool wait)
+	{
+		ImageRegion region;
+		region.Width = m_Width;
+		region.Height = m_Height;
+		Upload(data, &region, 1, wait);
+	}
 
-		if (!m_StagingBuffer)
+	void Image::SetData(const void* data, const ImageRegion& region)
+	{
+		Upload(data, &region, 1, false);
+	}
+
+	void Image::SetData(const void* data, const ImageRegion* regions, uint32_t regionCount)
+	{
+		Upload(data, regions, regionCount, false);
+	}
+
+	void Image::Upload(const void* data, const ImageRegion* regions, uint32_t regionCount, bool wait)
+	{
+		VkDevice device = Application::GetDevice();
+		uint32_t bytes_per_pixel = Utils::BytesPerPixel(m_Format);
+
+		// Clip the regions to the image and drop the empty ones; each remaining region is packed tightly in the staging memory
+		std::vector<VkBufferImageCopy> copies;
+		copies.reserve(regionCount);
+		VkDeviceSize upload_size = 0;
+		bool whole_image = false;
+		for (uint32_t i = 0; i < regionCount; i++)
 		{
-			// Create the Upload Buffer
-			{
-				VkBufferCreateInfo buffer_info = {};
-				buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-				buffer_info.size = upload_size;
-				buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-				buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-				err = vkCreateBuffer(device, &buffer_info, nullptr, &m_StagingBuffer);
-				check_vk_result(err);
-				VkMemoryRequirements req;
-				vkGetBufferMemoryRequirements(device, m_StagingBuffer, &req);
-				m_AlignedSize = req.size;
-				VkMemoryAllocateInfo alloc_info = {};
-				alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				alloc_info.allocationSize = req.size;
-				alloc_info.memoryTypeIndex = Utils::GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-				err = vkAllocateMemory(device, &alloc_info, nullptr, &m_StagingBufferMemory);
-				check_vk_result(err);
-				err = vkBindBufferMemory(device, m_StagingBuffer, m_StagingBufferMemory, 0);
-				check_vk_result(err);
-			}
+			const ImageRegion& region = regions[i];
+			if (region.X >= m_Width || region.Y >= m_Height)
+				continue;
+			uint32_t width = std::min(region.Width, m_Width - region.X);
+			uint32_t height = std::min(region.Height, m_Height - region.Y);
+			if (width == 0 || height == 0)
+				continue;
+
+			VkBufferImageCopy copy = {};
+			copy.bufferOffset = upload_size;
+			copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copy.imageSubresource.layerCount = 1;
+			copy.imageOffset = { (int32_t)region.X, (int32_t)region.Y, 0 };
+			copy.imageExtent = { width, height, 1 };
+			copies.push_back(copy);
+
+			upload_size += (VkDeviceSize)width * height * bytes_per_pixel;
+			whole_image |= width == m_Width && height == m_Height;
+		}
+		if (copies.empty())
+			return;
 
+		// The contents are undefined before the first upload, so the whole image can be written in place
+		if (WriteMapped(data))
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = m_Image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.layerCount = 1;
+			VkCommandBuffer command_buffer = wait ? Application::GetCommandBuffer(true) : Application::GetUploadCommandBuffer();
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+			if (wait)
+				Application::FlushCommandBuffer(command_buffer);
+			m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			return;
 		}
 
+		VkResult err;
+
 		// Upload to Buffer
+		// Prefer the shared persistently mapped ring, fall back to a one-off buffer when it is full or the upload is too large
+		StagingAllocation staging;
+		Allocation staging_allocation;
+		if (!Application::GetStagingRing().Allocate(upload_size, bytes_per_pixel, staging))
 		{
-			char* map = NULL;
-			err = vkMapMemory(device, m_StagingBufferMemory, 0, m_AlignedSize, 0, (void**)(&map));
+			VkBufferCreateInfo buffer_info = {};
+			buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			buffer_info.size = upload_size;
+			buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			err = vkCreateBuffer(device, &buffer_info, nullptr, &staging.Buffer);
 			check_vk_result(err);
-			memcpy(map, data, upload_size);
-			VkMappedMemoryRange range[1] = {};
-			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-			range[0].memory = m_StagingBufferMemory;
-			range[0].size = m_AlignedSize;
-			err = vkFlushMappedMemoryRanges(device, 1, range);
+			err = Application::GetMemoryAllocator().allocateForBuffer(staging.Buffer, MemoryUsage::Upload, &staging_allocation, false, MemoryCategory::Staging);
 			check_vk_result(err);
-			vkUnmapMemory(device, m_StagingBufferMemory);
+			staging.Mapped = staging_allocation.mapped;
+			staging.Offset = 0;
+			staging.Size = upload_size;
 		}
 
+		// data holds the whole image; gather the rows of each region
+		const uint8_t* source = (const uint8_t*)data;
+		uint8_t* destination = (uint8_t*)staging.Mapped;
+		size_t source_pitch = (size_t)m_Width * bytes_per_pixel;
+		for (VkBufferImageCopy& copy : copies)
+		{
+			size_t row_size = (size_t)copy.imageExtent.width * bytes_per_pixel;
+			const uint8_t* row = source + (size_t)copy.imageOffset.y * source_pitch + (size_t)copy.imageOffset.x * bytes_per_pixel;
+			uint8_t* target = destination + copy.bufferOffset;
+			if (row_size == source_pitch)
+				memcpy(target, row, row_size * copy.imageExtent.height);
+			else
+			{
+				for (uint32_t y = 0; y < copy.imageExtent.height; y++)
+					memcpy(target + y * row_size, row + y * source_pitch, row_size);
+			}
+			copy.bufferOffset += staging.Offset;
+		}
+		AppendEdgeCopies(copies);
+		if (staging_allocation.memory)
+			Application::GetMemoryAllocator().flush(staging_allocation, 0, upload_size);
 
 		// Copy to Image
 		{
-			VkCommandBuffer command_buffer = Application::GetCommandBuffer(true);
+			// The copy is recorded into the frame's upload command buffer, which is submitted ahead of the frame's draw commands.
+			// With wait it goes into a one-shot command buffer on the same graphics queue, behind every frame submitted so far
+			VkCommandBuffer command_buffer = wait ? Application::GetCommandBuffer(true) : Application::GetUploadCommandBuffer();
 
+			// A full overwrite may discard the old contents; a partial one has to keep the pixels outside the regions
 			VkImageMemoryBarrier copy_barrier = {};
 			copy_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			copy_barrier.srcAccessMask = whole_image ? 0 : VK_ACCESS_SHADER_READ_BIT;
 			copy_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			copy_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			copy_barrier.oldLayout = whole_image ? VK_IMAGE_LAYOUT_UNDEFINED : m_Layout;
 			copy_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 			copy_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 			copy_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -246,15 +387,10 @@ namespace Cetus {
 			copy_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			copy_barrier.subresourceRange.levelCount = 1;
 			copy_barrier.subresourceRange.layerCount = 1;
-			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &copy_barrier);
+			// A previous frame still in flight may be sampling the image, so the copy waits for fragment shading
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &copy_barrier);
 
-			VkBufferImageCopy region = {};
-			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.layerCount = 1;
-			region.imageExtent.width = m_Width;
-			region.imageExtent.height = m_Height;
-			region.imageExtent.depth = 1;
-			vkCmdCopyBufferToImage(command_buffer, m_StagingBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			vkCmdCopyBufferToImage(command_buffer, staging.Buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copies.size(), copies.data());
 
 			VkImageMemoryBarrier use_barrier = {};
 			use_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -270,7 +406,117 @@ namespace Cetus {
 			use_barrier.subresourceRange.layerCount = 1;
 			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &use_barrier);
 
-			Application::FlushCommandBuffer(command_buffer);
+			if (wait)
+				Application::FlushCommandBuffer(command_buffer);
+		}
+		m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		if (staging_allocation.memory)
+		{
+			Application::SubmitResourceFree([buffer = staging.Buffer, allocation = staging_allocation]() mutable
+			{
+				vkDestroyBuffer(Application::GetDevice(), buffer, nullptr);
+				Application::GetMemoryAllocator().free(allocation);
+			});
+		}
+	}
+
+	void Image::SetData(const void* data, UploadContext& uploadContext)
+	{
+		VkImageSubresourceRange range = {};
+		range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		range.levelCount = 1;
+		range.layerCount = 1;
+
+		// Written in place; only the layout transition (and the queue handover) is recorded
+		if (WriteMapped(data))
+		{
+			uploadContext.ReleaseImage(m_Image, range, VK_IMAGE_LAYOUT_PREINITIALIZED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			return;
+		}
+
+		VkDeviceSize upload_size = (VkDeviceSize)m_Width * m_Height * Utils::BytesPerPixel(m_Format);
+
+		// Upload to Buffer
+		StagingAllocation staging = uploadContext.AllocateStaging(upload_size, Utils::BytesPerPixel(m_Format));
+		memcpy(staging.Mapped, data, upload_size);
+
+		// Copy to Image
+		{
+			VkCommandBuffer command_buffer = uploadContext.GetCommandBuffer();
+
+			// The previous contents are discarded, so no ownership has to be acquired on the transfer queue
+			VkImageMemoryBarrier copy_barrier = {};
+			copy_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			copy_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			copy_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			copy_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			copy_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			copy_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			copy_barrier.image = m_Image;
+			copy_barrier.subresourceRange = range;
+			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &copy_barrier);
+
+			std::vector<VkBufferImageCopy> copies(1);
+			copies[0].bufferOffset = staging.Offset;
+			copies[0].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copies[0].imageSubresource.layerCount = 1;
+			copies[0].imageExtent.width = m_Width;
+			copies[0].imageExtent.height = m_Height;
+			copies[0].imageExtent.depth = 1;
+			AppendEdgeCopies(copies);
+			vkCmdCopyBufferToImage(command_buffer, staging.Buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copies.size(), copies.data());
+
+			// Hands the image over to the graphics queue (queue family ownership transfer on a dedicated transfer queue)
+			uploadContext.ReleaseImage(m_Image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+		}
+		m_Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	void Image::AppendEdgeCopies(std::vector<VkBufferImageCopy>& copies) const
+	{
+		bool right_slack = m_Width < m_CapacityWidth;
+		bool bottom_slack = m_Height < m_CapacityHeight;
+		if (!right_slack && !bottom_slack)
+			return;
+
+		// Each copy reads a tightly packed region; its last column / row is copied once more into the first slack texel beyond the image
+		VkDeviceSize bytes_per_pixel = Utils::BytesPerPixel(m_Format);
+		size_t count = copies.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			const VkBufferImageCopy copy = copies[i];
+			uint32_t width = copy.imageExtent.width;
+			uint32_t height = copy.imageExtent.height;
+			bool right = right_slack && copy.imageOffset.x + width == m_Width;
+			bool bottom = bottom_slack && copy.imageOffset.y + height == m_Height;
+
+			VkBufferImageCopy edge = copy;
+			edge.bufferRowLength = width;
+			if (right)
+			{
+				edge.bufferOffset = copy.bufferOffset + (width - 1) * bytes_per_pixel;
+				edge.imageOffset = { (int32_t)m_Width, copy.imageOffset.y, 0 };
+				edge.imageExtent = { 1, height, 1 };
+				copies.push_back(edge);
+			}
+			if (bottom)
+			{
+				edge.bufferOffset = copy.bufferOffset + (VkDeviceSize)(height - 1) * width * bytes_per_pixel;
+				edge.imageOffset = { copy.imageOffset.x, (int32_t)m_Height, 0 };
+				edge.imageExtent = { width, 1, 1 };
+				copies.push_back(edge);
+			}
+			if (right && bottom)
+			{
+				edge.bufferOffset = copy.bufferOffset + ((VkDeviceSize)height * width - 1) * bytes_per_pixel;
+				edge.imageOffset = { (int32_t)m_Width, (int32_t)m_Height, 0 };
+				edge.imageExtent = { 1, 1, 1 };
+				copies.push_back(edge);
+			}
 		}
 	}
 
@@ -279,13 +525,24 @@ namespace Cetus {
 		if (m_Image && m_Width == width && m_Height == height)
 			return;
 
-		// TODO: max size?
+		// Fits the current allocation and does not waste too much of it: only the visible sub-rectangle changes
+		uint64_t capacity = (uint64_t)m_CapacityWidth * m_CapacityHeight;
+		if (m_Image && width <= m_CapacityWidth && height <= m_CapacityHeight && (uint64_t)width * height * s_ShrinkFactor >= capacity)
+		{
+			m_Width = width;
+			m_Height = height;
+			return;
+		}
 
+		// Reallocate with some slack so that dragging the window edge does not hit this path every frame
+		auto with_slack = [](uint32_t size) { return (size + size / 4 + 63) & ~63u; };
 		m_Width = width;
 		m_Height = height;
+		m_CapacityWidth = with_slack(width);
+		m_CapacityHeight = with_slack(height);
 
-		Release();
-		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
+		ReleaseImage();
+		AllocateMemory();
 	}
 
 }
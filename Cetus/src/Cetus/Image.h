@@ -1,18 +1,50 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "vulkan/vulkan.h"
+#include "base/VulkanMemoryAllocator.h"
+
+#include <glm/glm.hpp>
 
 namespace Cetus {
 
+	class UploadContext;
+
 	enum class ImageFormat
 	{
 		None = 0,
 		RGBA,
+		RGBA16F,
 		RGBA32F
 	};
 
+	struct ImageRegion
+	{
+		uint32_t X = 0, Y = 0;
+		uint32_t Width = 0, Height = 0;
+	};
+
+	enum class Tonemap
+	{
+		None = 0,
+		Reinhard,
+		ACES
+	};
+
+	struct TonemapSettings
+	{
+		float Exposure = 1.0f;
+		Tonemap Operator = Tonemap::ACES;
+	};
+
+	// Resolves a linear float accumulation buffer (sum of sampleCount samples per pixel) for display.
+	// Divide by sample count, exposure, tonemap, sRGB encode, clamp and pack happen in one pass, in parallel over rows.
+	void ConvertToRGBA8(const glm::vec4* accumulation, uint32_t* output, uint32_t width, uint32_t height, uint32_t sampleCount, const TonemapSettings& settings = {});
+	// Same, but keeps the result linear and unclamped for an ImageFormat::RGBA16F image (half the upload size of RGBA32F).
+	void ConvertToRGBA16F(const glm::vec4* accumulation, uint16_t* output, uint32_t width, uint32_t height, uint32_t sampleCount, float exposure = 1.0f);
+
 	class Image
 	{
 	public:
@@ -20,33 +52,64 @@ namespace Cetus {
 		Image(uint32_t width, uint32_t height, ImageFormat format, const void* data = nullptr);
 		~Image();
 
-		void SetData(const void* data);
-
-		VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
-
+		// Copies data into the shared staging ring and records the upload into the current frame; the call does not block.
+		// Pass wait = true to submit immediately on the graphics queue and block until the copy has finished (one-shot loads).
+		// The copy waits for the fragment shading of every frame submitted before the call, so they never see it;
+		// draws of the current frame are submitted afterwards and sample the new contents even if recorded earlier.
+		// Do not combine it with SetData(data, uploadContext) on the same image before that batch's frame has been submitted.
+		void SetData(const void* data, bool wait = false);
+		// Uploads only the given regions of data (which still holds the whole image), each as its own buffer-to-image copy.
+		// The pixels outside the regions keep their previous contents.
+		void SetData(const void* data, const ImageRegion& region);
+		void SetData(const void* data, const ImageRegion* regions, uint32_t regionCount);
+		// Records the upload into the current batch of uploadContext; the image may be sampled once the batch's ticket has completed.
+		// Only for images that no frame in flight is sampling (freshly created images, scene loading).
+		void SetData(const void* data, UploadContext& uploadContext);
+
+		// The ImGui descriptor set is created on first use, so images only sampled through the bindless table never allocate one
+		VkDescriptorSet GetDescriptorSet() const;
+		// Slot in Application::GetBindlessTable(), or BindlessTable::invalidIndex when the device has no bindless support.
+		// A reallocating Resize moves the image to a new slot, like it gets a new descriptor set.
+		uint32_t GetBindlessIndex() const { return m_BindlessIndex; }
+
+		// Only reallocates when the new size exceeds the capacity or uses less than 1 / s_ShrinkFactor of it;
+		// otherwise the image keeps its allocation and just shows a smaller sub-rectangle.
 		void Resize(uint32_t width, uint32_t height);
 
 		uint32_t GetWidth() const { return m_Width; }
 		uint32_t GetHeight() const { return m_Height; }
+		// The part of the allocation holding the image, for the uv1 argument of ImGui::Image.
+		// Every upload replicates the last column and row into the slack, so linear filtering at the edge acts like clamp-to-edge.
+		glm::vec2 GetUVScale() const { return { (float)m_Width / (float)m_CapacityWidth, (float)m_Height / (float)m_CapacityHeight }; }
 	private:
-		void AllocateMemory(uint64_t size);
+		// writeOnce: the image gets its contents once and is never updated again (loaded from a file);
+		// only then may it live as a linear image in host-visible device memory, everything else stays optimal tiling
+		void AllocateMemory(bool writeOnce = false);
 		void Release();
+		void ReleaseImage();	// everything but the sampler
+		bool WriteMapped(const void* data);	// first upload into a host-visible linear image, skips the staging copy
+		// Records into the frame's upload command buffer, or with wait into a one-shot graphics command buffer that is flushed
+		void Upload(const void* data, const ImageRegion* regions, uint32_t regionCount, bool wait);
+		// Adds copies of the image's last column and row into the first texels of the slack, for copies touching those edges
+		void AppendEdgeCopies(std::vector<VkBufferImageCopy>& copies) const;
 	private:
+		static constexpr uint32_t s_ShrinkFactor = 4;
+
 		uint32_t m_Width = 0, m_Height = 0;
+		uint32_t m_CapacityWidth = 0, m_CapacityHeight = 0;	// extent of the VkImage
 
 		VkImage m_Image = nullptr;
 		VkImageView m_ImageView = nullptr;
-		VkDeviceMemory m_Memory = nullptr;
+		Allocation m_Allocation;	// sub-allocated from Application::GetMemoryAllocator()
 		VkSampler m_Sampler = nullptr;
 
 		ImageFormat m_Format = ImageFormat::None;
+		VkImageLayout m_Layout = VK_IMAGE_LAYOUT_UNDEFINED;	// layout after the last recorded upload
+		uint8_t* m_Mapped = nullptr;	// set when a write-once image lives in device-local host-visible memory (ReBAR/UMA)
+		VkDeviceSize m_RowPitch = 0;
 
-		VkBuffer m_StagingBuffer = nullptr;
-		VkDeviceMemory m_StagingBufferMemory = nullptr;
-
-		size_t m_AlignedSize = 0;
-
-		VkDescriptorSet m_DescriptorSet = nullptr;
+		mutable VkDescriptorSet m_DescriptorSet = nullptr;
+		uint32_t m_BindlessIndex = UINT32_MAX;
 
 		std::string m_Filepath;
 	};
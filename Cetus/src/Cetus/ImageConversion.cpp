@@ -0,0 +1,273 @@
+#include "Image.h"
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define CETUS_CONVERT_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CETUS_CONVERT_SSE2
+#endif
+
+// MSVC has no __F16C__; every AVX2 CPU supports F16C
+#if defined(CETUS_CONVERT_AVX2) && (defined(__F16C__) || defined(_MSC_VER))
+	#define CETUS_CONVERT_F16C
+#endif
+
+namespace Cetus {
+
+	namespace Utils {
+
+		static constexpr uint32_t s_SRGBTableSize = 16384;
+		static constexpr uint32_t s_RowsPerTask = 16;
+		static constexpr float s_MaxRadiance = 65504.0f;		// largest half; also keeps x * x in the tonemap curves finite
+
+		// Linear [0, 1] -> sRGB byte, indexed by value * (size - 1). 16K entries keep the error below
+		// half a step even near black where the sRGB curve is steepest. The padding lets AVX2 gather
+		// 32-bit words at byte granularity.
+		struct SRGBTable
+		{
+			uint8_t Values[s_SRGBTableSize + 3] = {};
+
+			SRGBTable()
+			{
+				for (uint32_t i = 0; i < s_SRGBTableSize; i++)
+				{
+					float linear = (float)i / (float)(s_SRGBTableSize - 1);
+					float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+					Values[i] = (uint8_t)std::min(255.0f, srgb * 255.0f + 0.5f);
+				}
+			}
+		};
+
+		static const SRGBTable& GetSRGBTable()
+		{
+			static SRGBTable table;
+			return table;
+		}
+
+		template<Tonemap Operator>
+		static inline float ApplyTonemap(float x)
+		{
+			if constexpr (Operator == Tonemap::Reinhard)
+				return x / (1.0f + x);
+			else if constexpr (Operator == Tonemap::ACES)	// Narkowicz's fit of the ACES filmic curve
+				return (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+			else
+				return x;
+		}
+
+		static inline float ClampRadiance(float x)
+		{
+			return x > 0.0f ? (x < s_MaxRadiance ? x : s_MaxRadiance) : 0.0f;	// NaN goes to 0
+		}
+
+		static inline float Saturate(float x)
+		{
+			return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;	// NaN goes to 0
+		}
+
+		static uint16_t FloatToHalf(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			uint32_t sign = (bits >> 16) & 0x8000;
+			uint32_t abs = bits & 0x7fffffff;
+
+			if (abs >= 0x7f800000)								// Inf / NaN
+				return (uint16_t)(sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0));
+			if (abs >= 0x477ff000)								// rounds above 65504
+				return (uint16_t)(sign | 0x7c00);
+			if (abs < 0x38800000)								// half subnormal
+			{
+				if (abs < 0x33000000)
+					return (uint16_t)sign;
+				uint32_t exponent = abs >> 23;
+				uint32_t mantissa = (abs & 0x007fffff) | 0x00800000;
+				uint32_t shift = 126 - exponent;
+				uint32_t half = mantissa >> shift;
+				uint32_t remainder = mantissa & ((1u << shift) - 1);
+				uint32_t halfway = 1u << (shift - 1);
+				if (remainder > halfway || (remainder == halfway && (half & 1)))
+					half++;
+				return (uint16_t)(sign | half);
+			}
+			// Rebias the exponent and round to nearest even; a carry out of the mantissa bumps the exponent as it should
+			abs += 0xc8000fff + ((abs >> 13) & 1);
+			return (uint16_t)(sign | (abs >> 13));
+		}
+
+		template<Tonemap Operator>
+		static void ConvertRowRGBA8(const glm::vec4* src, uint32_t* dst, uint32_t count, float colorScale, float alphaScale)
+		{
+			const uint8_t* table = GetSRGBTable().Values;
+			const float tableScale = (float)(s_SRGBTableSize - 1);
+			uint32_t i = 0;
+
+		#if defined(CETUS_CONVERT_AVX2)
+			// Two pixels per register, four per iteration
+			const __m256 scale = _mm256_setr_ps(colorScale, colorScale, colorScale, alphaScale, colorScale, colorScale, colorScale, alphaScale);
+			const __m256 quantize = _mm256_setr_ps(tableScale, tableScale, tableScale, 255.0f, tableScale, tableScale, tableScale, 255.0f);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 limit = _mm256_set1_ps(s_MaxRadiance);
+			const __m256 one = _mm256_set1_ps(1.0f);
+			const __m256 half = _mm256_set1_ps(0.5f);
+			const __m256i byteMask = _mm256_set1_epi32(0xff);
+			const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+			auto convert = [&](__m256 x)
+			{
+				x = _mm256_mul_ps(x, scale);
+				x = _mm256_min_ps(_mm256_max_ps(x, zero), limit);
+				__m256 mapped = x;
+				if constexpr (Operator == Tonemap::Reinhard)
+					mapped = _mm256_div_ps(x, _mm256_add_ps(one, x));
+				else if constexpr (Operator == Tonemap::ACES)
+				{
+					__m256 numerator = _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.51f)), _mm256_set1_ps(0.03f)));
+					__m256 denominator = _mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(2.43f)), _mm256_set1_ps(0.59f))), _mm256_set1_ps(0.14f));
+					mapped = _mm256_div_ps(numerator, denominator);
+				}
+				x = _mm256_blend_ps(mapped, x, 0x88);			// alpha is never tonemapped
+				x = _mm256_min_ps(x, one);
+				__m256i index = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(x, quantize), half));
+				__m256i encoded = _mm256_and_si256(_mm256_i32gather_epi32((const int*)table, index, 1), byteMask);
+				return _mm256_blend_epi32(encoded, index, 0x88);	// alpha stays linear
+			};
+
+			for (; i + 4 <= count; i += 4)
+			{
+				__m256i a = convert(_mm256_loadu_ps(&src[i].x));
+				__m256i b = convert(_mm256_loadu_ps(&src[i + 2].x));
+				__m256i packed = _mm256_packus_epi32(a, b);
+				packed = _mm256_packus_epi16(packed, packed);
+				packed = _mm256_permutevar8x32_epi32(packed, order);
+				_mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(packed));
+			}
+		#elif defined(CETUS_CONVERT_SSE2)
+			// One pixel per register; the table lookups stay scalar
+			const __m128 scale = _mm_setr_ps(colorScale, colorScale, colorScale, alphaScale);
+			const __m128 quantize = _mm_setr_ps(tableScale, tableScale, tableScale, 255.0f);
+			const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 limit = _mm_set1_ps(s_MaxRadiance);
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 half = _mm_set1_ps(0.5f);
+
+			for (; i < count; i++)
+			{
+				__m128 x = _mm_mul_ps(_mm_loadu_ps(&src[i].x), scale);
+				x = _mm_min_ps(_mm_max_ps(x, zero), limit);
+				__m128 mapped = x;
+				if constexpr (Operator == Tonemap::Reinhard)
+					mapped = _mm_div_ps(x, _mm_add_ps(one, x));
+				else if constexpr (Operator == Tonemap::ACES)
+				{
+					__m128 numerator = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+					__m128 denominator = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+					mapped = _mm_div_ps(numerator, denominator);
+				}
+				x = _mm_or_ps(_mm_and_ps(alphaMask, x), _mm_andnot_ps(alphaMask, mapped));
+				x = _mm_min_ps(x, one);
+
+				alignas(16) int32_t index[4];
+				_mm_store_si128((__m128i*)index, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(x, quantize), half)));
+				dst[i] = (uint32_t)table[index[0]] | ((uint32_t)table[index[1]] << 8) | ((uint32_t)table[index[2]] << 16) | ((uint32_t)index[3] << 24);
+			}
+		#endif
+
+			for (; i < count; i++)
+			{
+				const glm::vec4& color = src[i];
+				uint32_t r = table[(uint32_t)(Saturate(ApplyTonemap<Operator>(ClampRadiance(color.r * colorScale))) * tableScale + 0.5f)];
+				uint32_t g = table[(uint32_t)(Saturate(ApplyTonemap<Operator>(ClampRadiance(color.g * colorScale))) * tableScale + 0.5f)];
+				uint32_t b = table[(uint32_t)(Saturate(ApplyTonemap<Operator>(ClampRadiance(color.b * colorScale))) * tableScale + 0.5f)];
+				uint32_t a = (uint32_t)(Saturate(color.a * alphaScale) * 255.0f + 0.5f);
+				dst[i] = r | (g << 8) | (b << 16) | (a << 24);
+			}
+		}
+
+		static void ConvertRowRGBA16F(const glm::vec4* src, uint16_t* dst, uint32_t count, float colorScale, float alphaScale)
+		{
+			uint32_t i = 0;
+
+		#if defined(CETUS_CONVERT_F16C)
+			const __m256 scale = _mm256_setr_ps(colorScale, colorScale, colorScale, alphaScale, colorScale, colorScale, colorScale, alphaScale);
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 limit = _mm256_set1_ps(s_MaxRadiance);
+			for (; i + 2 <= count; i += 2)
+			{
+				__m256 x = _mm256_mul_ps(_mm256_loadu_ps(&src[i].x), scale);
+				x = _mm256_min_ps(_mm256_max_ps(x, zero), limit);
+				_mm_storeu_si128((__m128i*)(dst + i * 4), _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+			}
+		#endif
+
+			for (; i < count; i++)
+			{
+				const glm::vec4& color = src[i];
+				dst[i * 4 + 0] = FloatToHalf(ClampRadiance(color.r * colorScale));
+				dst[i * 4 + 1] = FloatToHalf(ClampRadiance(color.g * colorScale));
+				dst[i * 4 + 2] = FloatToHalf(ClampRadiance(color.b * colorScale));
+				dst[i * 4 + 3] = FloatToHalf(ClampRadiance(color.a * alphaScale));
+			}
+		}
+
+		template<typename F>
+		static void ForEachRowBlock(uint32_t height, F&& func)
+		{
+			uint32_t blocks = (height + s_RowsPerTask - 1) / s_RowsPerTask;
+			if (blocks <= 1)
+			{
+				func(0, height);
+				return;
+			}
+			TaskScheduler::Get().ParallelFor(blocks, [&](uint32_t block)
+			{
+				uint32_t begin = block * s_RowsPerTask;
+				func(begin, std::min(begin + s_RowsPerTask, height));
+			});
+		}
+
+	}
+
+	void ConvertToRGBA8(const glm::vec4* accumulation, uint32_t* output, uint32_t width, uint32_t height, uint32_t sampleCount, const TonemapSettings& settings)
+	{
+		float alphaScale = 1.0f / (float)std::max(sampleCount, 1u);
+		float colorScale = settings.Exposure * alphaScale;
+
+		auto convert = [&](auto rowFunc)
+		{
+			Utils::ForEachRowBlock(height, [&](uint32_t begin, uint32_t end)
+			{
+				size_t offset = (size_t)begin * width;
+				rowFunc(accumulation + offset, output + offset, (end - begin) * width, colorScale, alphaScale);
+			});
+		};
+
+		switch (settings.Operator)
+		{
+			case Tonemap::None:     convert(Utils::ConvertRowRGBA8<Tonemap::None>); break;
+			case Tonemap::Reinhard: convert(Utils::ConvertRowRGBA8<Tonemap::Reinhard>); break;
+			case Tonemap::ACES:     convert(Utils::ConvertRowRGBA8<Tonemap::ACES>); break;
+		}
+	}
+
+	void ConvertToRGBA16F(const glm::vec4* accumulation, uint16_t* output, uint32_t width, uint32_t height, uint32_t sampleCount, float exposure)
+	{
+		float alphaScale = 1.0f / (float)std::max(sampleCount, 1u);
+		float colorScale = exposure * alphaScale;
+
+		Utils::ForEachRowBlock(height, [&](uint32_t begin, uint32_t end)
+		{
+			size_t offset = (size_t)begin * width;
+			Utils::ConvertRowRGBA16F(accumulation + offset, output + offset * 4, (end - begin) * width, colorScale, alphaScale);
+		});
+	}
+
+}
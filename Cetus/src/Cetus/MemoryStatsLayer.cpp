@@ -0,0 +1,96 @@
+#include "MemoryStatsLayer.h"
+
+#include "Application.h"
+
+#include "imgui.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace Cetus {
+
+	namespace Utils {
+
+		static float ToMiB(VkDeviceSize bytes)
+		{
+			return (float)((double)bytes / (1024.0 * 1024.0));
+		}
+
+	}
+
+	void MemoryStatsLayer::OnAttach()
+	{
+		Refresh();
+	}
+
+	void MemoryStatsLayer::OnUpdate(float ts)
+	{
+		m_TimeSinceRefresh += ts;
+		if (m_TimeSinceRefresh >= s_RefreshInterval)
+			Refresh();
+	}
+
+	void MemoryStatsLayer::Refresh()
+	{
+		VulkanDevice& device = Application::GetVulkanDevice();
+		m_Heaps = device.getMemoryBudget();
+		m_Statistics = device.getMemoryStatistics();
+		m_BudgetSupported = device.memoryBudgetSupported && device.getPhysicalDeviceMemoryProperties2;
+		m_TimeSinceRefresh = 0.0f;
+	}
+
+	void MemoryStatsLayer::OnUIRender()
+	{
+		ImGui::Begin("Memory");
+
+		ImGui::Text("VkDeviceMemory objects: %u (%u blocks, %u dedicated)", m_Statistics.memoryObjectCount(), m_Statistics.blockCount, m_Statistics.dedicatedCount);
+		ImGui::Text("Sub-allocations: %u, %.1f / %.1f MiB of blocks in use", m_Statistics.allocationCount, Utils::ToMiB(m_Statistics.usedBytes), Utils::ToMiB(m_Statistics.blockBytes));
+		ImGui::Text("Allocated: %.1f MiB, peak %.1f MiB", Utils::ToMiB(m_Statistics.blockBytes + m_Statistics.dedicatedBytes), Utils::ToMiB(m_Statistics.peakBytes));
+		if (!m_BudgetSupported)
+			ImGui::TextDisabled("VK_EXT_memory_budget unavailable, budget estimated at 80%% of heap size");
+
+		ImGui::Separator();
+		for (size_t i = 0; i < m_Heaps.size(); i++)
+		{
+			const VulkanDevice::MemoryHeapBudget& heap = m_Heaps[i];
+			bool deviceLocal = heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+			float fraction = heap.budget ? (float)((double)heap.usage / (double)heap.budget) : 0.0f;
+
+			ImGui::Text("Heap %zu (%s, %.0f MiB)", i, deviceLocal ? "device local" : "host", Utils::ToMiB(heap.size));
+			char overlay[64];
+			snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", Utils::ToMiB(heap.usage), Utils::ToMiB(heap.budget));
+			if (fraction > 0.9f)
+				ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.9f, 0.3f, 0.2f, 1.0f));
+			ImGui::ProgressBar(std::min(fraction, 1.0f), ImVec2(-1.0f, 0.0f), overlay);
+			if (fraction > 0.9f)
+				ImGui::PopStyleColor();
+
+			// ﲻڷĲ֣ImGuiˡ֡ڲķ
+			if (m_BudgetSupported && heap.usage > m_Statistics.heapBytes[i])
+				ImGui::TextDisabled("  ImGui, swapchain and driver: %.1f MiB", Utils::ToMiB(heap.usage - m_Statistics.heapBytes[i]));
+		}
+
+		ImGui::Separator();
+		if (ImGui::BeginTable("Categories", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+		{
+			ImGui::TableSetupColumn("Category");
+			ImGui::TableSetupColumn("Count");
+			ImGui::TableSetupColumn("MiB");
+			ImGui::TableSetupColumn("Peak MiB");
+			ImGui::TableHeadersRow();
+			for (uint32_t c = 0; c < (uint32_t)MemoryCategory::Count; c++)
+			{
+				const MemoryAllocator::Statistics::Category& category = m_Statistics.categories[c];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(memoryCategoryName((MemoryCategory)c));
+				ImGui::TableNextColumn(); ImGui::Text("%u", category.count);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", Utils::ToMiB(category.bytes));
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", Utils::ToMiB(category.peakBytes));
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Layer.h"
+#include "base/VulkanDevice.h"
+
+#include <vector>
+
+namespace Cetus {
+
+	// Դͳ壺ÿѵԤ㡢ĴСͷֵVkDeviceMemory
+	class MemoryStatsLayer : public Layer
+	{
+	public:
+		virtual void OnAttach() override;
+		virtual void OnUpdate(float ts) override;
+		virtual void OnUIRender() override;
+	private:
+		void Refresh();
+	private:
+		static constexpr float s_RefreshInterval = 0.25f;	// ѯԤҪÿ֡
+
+		float m_TimeSinceRefresh = 0.0f;
+		std::vector<VulkanDevice::MemoryHeapBudget> m_Heaps;
+		MemoryAllocator::Statistics m_Statistics;
+		bool m_BudgetSupported = false;
+	};
+
+}
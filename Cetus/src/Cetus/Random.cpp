@@ -1,8 +1,191 @@
 #include "Random.h"
 
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define CETUS_RANDOM_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CETUS_RANDOM_SSE2
+#endif
+
 namespace Cetus {
 
-	std::mt19937 Random::s_RandomEngine;
-	std::uniform_int_distribution<std::mt19937::result_type> Random::s_Distribution;
+	std::atomic<uint64_t> Random::s_Seed = 0x853c49e6748fea9bULL;
+	std::atomic<uint64_t> Random::s_NextStream = 0;
+
+	namespace Utils {
+
+		static constexpr size_t s_Lanes = 8;
+
+		struct alignas(32) XoshiroLanes		// 8·xoshiro128+ţöӦһAVX2ĴSSEĴ
+		{
+			uint32_t S[4][s_Lanes];
+			bool Seeded = false;
+		};
+
+		static XoshiroLanes& GetLanes()
+		{
+			thread_local XoshiroLanes s_Lanes;
+			if (!s_Lanes.Seeded)
+			{
+				for (size_t i = 0; i < 4; i++)
+				{
+					for (size_t lane = 0; lane < Utils::s_Lanes; lane++)
+					{
+						uint32_t value;
+						do { value = Random::UInt(); } while (value == 0);	// ÿ״̬ȫΪ0
+						s_Lanes.S[i][lane] = value;
+					}
+				}
+				s_Lanes.Seeded = true;
+			}
+			return s_Lanes;
+		}
+
+		static inline uint32_t Rotl(uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		static inline void NextScalar(XoshiroLanes& lanes, uint32_t* out)	// 汾һΪ8һ
+		{
+			for (size_t lane = 0; lane < s_Lanes; lane++)
+			{
+				uint32_t* s0 = &lanes.S[0][lane];
+				uint32_t* s1 = &lanes.S[1][lane];
+				uint32_t* s2 = &lanes.S[2][lane];
+				uint32_t* s3 = &lanes.S[3][lane];
+				out[lane] = *s0 + *s3;
+				uint32_t t = *s1 << 9;
+				*s2 ^= *s0;
+				*s3 ^= *s1;
+				*s1 ^= *s2;
+				*s0 ^= *s3;
+				*s2 ^= t;
+				*s3 = Rotl(*s3, 11);
+			}
+		}
+
+		static inline float ToFloat(uint32_t x)	// 23λŽβõ[1, 2)ټ1
+		{
+			union { uint32_t u; float f; } bits;
+			bits.u = (x >> 9) | 0x3f800000u;
+			return bits.f - 1.0f;
+		}
+
+	#if defined(CETUS_RANDOM_AVX2)
+		static inline __m256i Next8(__m256i& s0, __m256i& s1, __m256i& s2, __m256i& s3)
+		{
+			__m256i result = _mm256_add_epi32(s0, s3);
+			__m256i t = _mm256_slli_epi32(s1, 9);
+			s2 = _mm256_xor_si256(s2, s0);
+			s3 = _mm256_xor_si256(s3, s1);
+			s1 = _mm256_xor_si256(s1, s2);
+			s0 = _mm256_xor_si256(s0, s3);
+			s2 = _mm256_xor_si256(s2, t);
+			s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+			return result;
+		}
+	#elif defined(CETUS_RANDOM_SSE2)
+		static inline __m128i Next4(__m128i& s0, __m128i& s1, __m128i& s2, __m128i& s3)
+		{
+			__m128i result = _mm_add_epi32(s0, s3);
+			__m128i t = _mm_slli_epi32(s1, 9);
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+			return result;
+		}
+	#endif
+
+		template<typename Convert>
+		static void Fill(uint32_t* out, size_t count, Convert&& convertTail)	// count32λ8βconvertTail
+		{
+			XoshiroLanes& lanes = GetLanes();
+			size_t i = 0;
+			size_t full = count / s_Lanes * s_Lanes;
+
+		#if defined(CETUS_RANDOM_AVX2)
+			__m256i s0 = _mm256_load_si256((const __m256i*)lanes.S[0]);
+			__m256i s1 = _mm256_load_si256((const __m256i*)lanes.S[1]);
+			__m256i s2 = _mm256_load_si256((const __m256i*)lanes.S[2]);
+			__m256i s3 = _mm256_load_si256((const __m256i*)lanes.S[3]);
+			for (; i < full; i += s_Lanes)
+				_mm256_storeu_si256((__m256i*)(out + i), Next8(s0, s1, s2, s3));
+			_mm256_store_si256((__m256i*)lanes.S[0], s0);
+			_mm256_store_si256((__m256i*)lanes.S[1], s1);
+			_mm256_store_si256((__m256i*)lanes.S[2], s2);
+			_mm256_store_si256((__m256i*)lanes.S[3], s3);
+		#elif defined(CETUS_RANDOM_SSE2)
+			// 8ɵ4͸4ֱƽ˳AVX2ͱ汾һ
+			__m128i lo0 = _mm_load_si128((const __m128i*)lanes.S[0]), hi0 = _mm_load_si128((const __m128i*)(lanes.S[0] + 4));
+			__m128i lo1 = _mm_load_si128((const __m128i*)lanes.S[1]), hi1 = _mm_load_si128((const __m128i*)(lanes.S[1] + 4));
+			__m128i lo2 = _mm_load_si128((const __m128i*)lanes.S[2]), hi2 = _mm_load_si128((const __m128i*)(lanes.S[2] + 4));
+			__m128i lo3 = _mm_load_si128((const __m128i*)lanes.S[3]), hi3 = _mm_load_si128((const __m128i*)(lanes.S[3] + 4));
+			for (; i < full; i += s_Lanes)
+			{
+				_mm_storeu_si128((__m128i*)(out + i), Next4(lo0, lo1, lo2, lo3));
+				_mm_storeu_si128((__m128i*)(out + i + 4), Next4(hi0, hi1, hi2, hi3));
+			}
+			_mm_store_si128((__m128i*)lanes.S[0], lo0); _mm_store_si128((__m128i*)(lanes.S[0] + 4), hi0);
+			_mm_store_si128((__m128i*)lanes.S[1], lo1); _mm_store_si128((__m128i*)(lanes.S[1] + 4), hi1);
+			_mm_store_si128((__m128i*)lanes.S[2], lo2); _mm_store_si128((__m128i*)(lanes.S[2] + 4), hi2);
+			_mm_store_si128((__m128i*)lanes.S[3], lo3); _mm_store_si128((__m128i*)(lanes.S[3] + 4), hi3);
+		#else
+			for (; i < full; i += s_Lanes)
+				NextScalar(lanes, out + i);
+		#endif
+
+			if (i < count)
+			{
+				uint32_t tail[s_Lanes];
+				NextScalar(lanes, tail);
+				convertTail(tail, count - i);
+			}
+		}
+
+	}
+
+	void Random::FillUInts(uint32_t* values, size_t count)
+	{
+		Utils::Fill(values, count, [&](const uint32_t* tail, size_t remaining)
+		{
+			for (size_t j = 0; j < remaining; j++)
+				values[count - remaining + j] = tail[j];
+		});
+	}
+
+	void Random::FillFloats(float* values, size_t count)
+	{
+		// Ȱλԭд飬ԭתɸ
+		uint32_t* bits = reinterpret_cast<uint32_t*>(values);
+		FillUInts(bits, count);
+
+		size_t i = 0;
+	#if defined(CETUS_RANDOM_AVX2)
+		const __m256i exponent = _mm256_set1_epi32(0x3f800000);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i x = _mm256_loadu_si256((const __m256i*)(bits + i));
+			x = _mm256_or_si256(_mm256_srli_epi32(x, 9), exponent);
+			_mm256_storeu_ps(values + i, _mm256_sub_ps(_mm256_castsi256_ps(x), one));
+		}
+	#elif defined(CETUS_RANDOM_SSE2)
+		const __m128i exponent = _mm_set1_epi32(0x3f800000);
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(bits + i));
+			x = _mm_or_si128(_mm_srli_epi32(x, 9), exponent);
+			_mm_storeu_ps(values + i, _mm_sub_ps(_mm_castsi128_ps(x), one));
+		}
+	#endif
+		for (; i < count; i++)
+			values[i] = Utils::ToFloat(bits[i]);
+	}
 
-}
\ No newline at end of file
+}
@@ -1,32 +1,84 @@
 #pragma once
 // ʹ#pragma onceָֹͷļظ #pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <random>
 
 #include <glm/glm.hpp>
 
 namespace Cetus {
 
+	struct PCG32		// PCG32(pcg-random.org)64λ״̬32λ״ֻ̬16ֽڣmt19937(Լ2.5KB)ö࣬ͳ
+	{
+		uint64_t State = 0x853c49e6748fea9bULL;
+		uint64_t Inc = 0xda3e39cb94b95bdbULL;	// кţͬкŸص
+
+		PCG32() = default;
+		PCG32(uint64_t seed, uint64_t stream) { Seed(seed, stream); }
+
+		void Seed(uint64_t seed, uint64_t stream)
+		{
+			State = 0;
+			Inc = (stream << 1u) | 1u;
+			Next();
+			State += seed;
+			Next();
+		}
+
+		uint32_t Next()
+		{
+			uint64_t old = State;
+			State = old * 6364136223846793005ULL + Inc;
+			uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+			uint32_t rot = (uint32_t)(old >> 59u);
+			return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+		}
+	};
+
+	// ÿ߳ӵԼthread_local߳ȾʱûݾҲû
 	class Random
 	{
 	public:
-		static void Init()		
-		{// һ̬ڳʼ棬ʹstd::random_deviceΪ
-			s_RandomEngine.seed(std::random_device()());
+		static void Init()
+		{// һ̬ڳʼӣʹstd::random_deviceΪ
+			std::random_device device;
+			Init(((uint64_t)device() << 32) | device());
 		}
 
-		static uint32_t UInt()	
-		{// һ̬һ޷͵ʹs_DistributionΪֲ
-			return s_Distribution(s_RandomEngine);
+		static void Init(uint64_t seed)
+		{// ȫӲ³ʼ̵߳߳ڵһʹʱӺ͸ԵкųʼӦ߳ǰ
+			s_Seed.store(seed, std::memory_order_relaxed);
+			Generator().Seed(seed, s_NextStream.fetch_add(1, std::memory_order_relaxed));
+		}
+
+		static uint32_t UInt()
+		{// һ̬һ޷͵
+			return Generator().Next();
 		}
 
 		static uint32_t UInt(uint32_t min, uint32_t max)
-		{// һ̬һ[min, max]Χڵ޷͵ʹs_DistributionΪֲԽȡģΪ{0,..,max-min}
-			return min + (s_Distribution(s_RandomEngine) % (max - min + 1));
+		{// һ[min, max]Χڵ޷ȡģýСֵøƵLemireĳ˷+ܾƫ
+			uint32_t range = max - min + 1;
+			if (range == 0)									// [0, UINT32_MAX]Χ
+				return UInt();
+			uint64_t m = (uint64_t)UInt() * range;
+			uint32_t low = (uint32_t)m;
+			if (low < range)
+			{
+				uint32_t threshold = (0u - range) % range;	// 2^32 mod range
+				while (low < threshold)
+				{
+					m = (uint64_t)UInt() * range;
+					low = (uint32_t)m;
+				}
+			}
+			return min + (uint32_t)(m >> 32);
 		}
 
 		static float Float()
-		{// һ̬һ͵ʹs_DistributionΪֲuint32_tֵʹ[0, 1]Χ
-			return (float)s_Distribution(s_RandomEngine) / (float)std::numeric_limits<uint32_t>::max();
+		{// һ[0, 1)Χڵĸȡ24λfloatβ
+			return (float)(UInt() >> 8) * (1.0f / 16777216.0f);
 		}
 
 		static glm::vec3 Vec3()
@@ -40,19 +92,55 @@ namespace Cetus {
 		}
 
 		static glm::vec3 InUnitSphere()
-		{// һ̬һڵλڵά͵ʹVec3(-1.0f, 1.0f)һ[-1, 1]Χڵйһ
-			return glm::normalize(Vec3(-1.0f, 1.0f));
+		{// ɵλھȷֲĵ㣺[-1, 1]ȡ㣬ȡƽ1.91Σ
+			while (true)
+			{
+				glm::vec3 p = Vec3(-1.0f, 1.0f);
+				if (glm::dot(p, p) < 1.0f)
+					return p;
+			}
+		}
+
+		static glm::vec3 UnitVector()
+		{// ɵλϾȷֲķz[-1, 1]ϾȷֲzĽǶ[0, 2)Ͼȷֲ
+			float z = Float() * 2.0f - 1.0f;
+			float phi = Float() * 6.28318530718f;
+			float r = glm::sqrt(glm::max(0.0f, 1.0f - z * z));
+			return glm::vec3(r * glm::cos(phi), r * glm::sin(phi), z);
+		}
+
+		// ڹϣ״̬ͬһ(, , ά)ǵõͬһ̵ֵ߳Ⱥ͵˳޹أȾԸ
+		static uint32_t At(uint32_t pixel, uint32_t sample, uint32_t dimension)
+		{
+			uint32_t seed = (uint32_t)s_Seed.load(std::memory_order_relaxed);
+			return Hash(dimension + Hash(sample + Hash(pixel + seed)));
+		}
+
+		static float FloatAt(uint32_t pixel, uint32_t sample, uint32_t dimension)
+		{
+			return (float)(At(pixel, sample, dimension) >> 8) * (1.0f / 16777216.0f);
+		}
+
+		static uint32_t Hash(uint32_t input)
+		{// PCGϣ(Jarzynski & Olano, "Hash Functions for GPU Rendering")һγ˼ӼһûѩЧ
+			uint32_t state = input * 747796405u + 2891336453u;
+			uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+			return (word >> 22u) ^ word;
+		}
+
+		// [0, 1)Χڵĸʹ8·еxoshiro128+AVX2ʱһ8SSE2ʱһ4ɣ
+		// ·Ľȫͬ״̬Ҳÿ̶߳ģӸ̵߳PCG32
+		static void FillFloats(float* values, size_t count);
+		static void FillUInts(uint32_t* values, size_t count);
+	private:
+		static PCG32& Generator()
+		{
+			thread_local PCG32 s_Generator(s_Seed.load(std::memory_order_relaxed), s_NextStream.fetch_add(1, std::memory_order_relaxed));
+			return s_Generator;
 		}
 	private:
-		static std::mt19937 s_RandomEngine;// һ̬棬ʹstd::mt19937Ϊ㷨
-		// mt19937Mersenne(÷ɭ) Twister㷨ġ
-		// Mersenne Twister㷨һֻMersenneα㷨Բ32λ64λ޷
-		// Mersenneһ2n-1nһ
-		// mt19937е19937ʾʹõMersenneָ2^(19937-1)һMersenne
-		// mt19937һ64λ汾mt19937_64ʹõ219937-1ĸ64λΪ
-		// mt19937mt19937_64C++׼еmersenne_twister_engineʵǿ<random>ͷļҵ
-		// һ̬ķֲʹstd::uniform_int_distributionΪͣɾȷֲ
-		static std::uniform_int_distribution<std::mt19937::result_type> s_Distribution;
+		static std::atomic<uint64_t> s_Seed;			// ȫ
+		static std::atomic<uint64_t> s_NextStream;		// һ߳ʹõк
 	};
 
 }
@@ -0,0 +1,358 @@
+#include "Renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace Cetus {
+
+	namespace Utils {
+
+		static uint32_t MortonCode(uint32_t x, uint32_t y)	// xyĶλ
+		{
+			auto part = [](uint32_t v)
+			{
+				v &= 0x0000ffff;
+				v = (v | (v << 8)) & 0x00ff00ff;
+				v = (v | (v << 4)) & 0x0f0f0f0f;
+				v = (v | (v << 2)) & 0x33333333;
+				v = (v | (v << 1)) & 0x55555555;
+				return v;
+			};
+			return part(x) | (part(y) << 1);
+		}
+
+		static uint32_t HilbertIndex(uint32_t n, uint32_t x, uint32_t y)	// (x, y)ڱ߳Ϊn2ݣHilbertϵλ
+		{
+			uint32_t d = 0;
+			for (uint32_t s = n / 2; s > 0; s /= 2)
+			{
+				uint32_t rx = (x & s) > 0;
+				uint32_t ry = (y & s) > 0;
+				d += s * s * ((3 * rx) ^ ry);
+				if (ry == 0)
+				{
+					if (rx == 1)
+					{
+						x = s - 1 - x;
+						y = s - 1 - y;
+					}
+					std::swap(x, y);
+				}
+			}
+			return d;
+		}
+
+		template<typename T>
+		static void AssignWithSlack(std::vector<T>& buffer, size_t count, const T& value)	// ʱһ룬϶ʱÿ֡·
+		{
+			if (count > buffer.capacity())
+				buffer.reserve(count + count / 2);
+			buffer.assign(count, value);
+		}
+
+		static float Luminance(const glm::vec4& color)
+		{
+			return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+		}
+
+		static float RelativeVariance(float mean, float m2, uint32_t count)	// ֵƵķԾֵƽ
+		{
+			if (count < 2)
+				return 1.0f;
+			float varianceOfMean = m2 / ((float)(count - 1) * (float)count);
+			return varianceOfMean / (mean * mean + 1e-4f);						// ӽɫذ0.01ľ
+		}
+
+	}
+
+	Renderer::~Renderer()
+	{
+		Cancel();
+	}
+
+	void Renderer::OnResize(uint32_t width, uint32_t height)
+	{
+		if (m_FinalImage && m_Width == width && m_Height == height && m_TileSize == m_Settings.TileSize && m_TileOrder == m_Settings.Order)
+			return;
+
+		Cancel();
+
+		if (m_FinalImage)
+			m_FinalImage->Resize(width, height);
+		else
+			m_FinalImage = std::make_shared<Image>(width, height, ImageFormat::RGBA);
+
+		m_Width = width;
+		m_Height = height;
+		Utils::AssignWithSlack(m_ImageData, (size_t)width * height, 0u);
+		Utils::AssignWithSlack(m_DisplayData, (size_t)width * height, 0u);
+		BuildTiles();
+	}
+
+	void Renderer::BuildTiles()
+	{
+		m_TileSize = std::max(m_Settings.TileSize, 1u);
+		m_TileOrder = m_Settings.Order;
+
+		uint32_t tilesX = (m_Width + m_TileSize - 1) / m_TileSize;
+		uint32_t tilesY = (m_Height + m_TileSize - 1) / m_TileSize;
+		uint32_t side = 1;												// HilbertҪȫͼ2ݱ߳
+		while (side < std::max(tilesX, tilesY))
+			side *= 2;
+
+		std::vector<std::pair<uint32_t, Tile>> keyed;
+		keyed.reserve((size_t)tilesX * tilesY);
+		for (uint32_t ty = 0; ty < tilesY; ty++)
+		{
+			for (uint32_t tx = 0; tx < tilesX; tx++)
+			{
+				Tile tile;
+				tile.X = tx * m_TileSize;
+				tile.Y = ty * m_TileSize;
+				tile.Width = std::min(m_TileSize, m_Width - tile.X);
+				tile.Height = std::min(m_TileSize, m_Height - tile.Y);
+
+				uint32_t key = ty * tilesX + tx;
+				if (m_TileOrder == TileOrder::Morton)
+					key = Utils::MortonCode(tx, ty);
+				else if (m_TileOrder == TileOrder::Hilbert)
+					key = Utils::HilbertIndex(side, tx, ty);
+				keyed.emplace_back(key, tile);
+			}
+		}
+		std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+		m_Tiles.clear();
+		m_Tiles.reserve(keyed.size());
+		for (const auto& [key, tile] : keyed)
+			m_Tiles.push_back(tile);
+		m_TileStates.clear();								// һֽʱ¿ʼۻ
+	}
+
+	void Renderer::Render(TileFunction func)
+	{
+		Cancel();
+		if (m_Tiles.empty())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			m_CompletedTiles.clear();
+		}
+
+		m_Task = TaskScheduler::Get().Dispatch((uint32_t)m_Tiles.size(), [this, func = std::move(func)](uint32_t index)
+		{
+			func(m_Tiles[index], m_ImageData.data(), m_Width);
+
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			m_CompletedTiles.push_back(index);
+		});
+	}
+
+	void Renderer::Cancel()
+	{
+		if (!m_Task)
+			return;
+		m_Task->Cancel();
+		m_Task->Wait();
+		m_Task.reset();
+
+		std::lock_guard<std::mutex> lock(m_CompletedMutex);
+		m_CompletedTiles.clear();
+	}
+
+	void Renderer::Wait()
+	{
+		if (m_Task)
+			m_Task->Wait();
+	}
+
+	uint32_t Renderer::UpdateImage()
+	{
+		std::vector<uint32_t> completed;
+		{
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			completed.swap(m_CompletedTiles);
+		}
+		if (completed.empty())
+			return 0;
+
+		// ֤ЩͼѾдֻ꣬ǣȾͼ鲻ᱻ
+		for (uint32_t index : completed)
+		{
+			const Tile& tile = m_Tiles[index];
+			for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++)
+			{
+				size_t offset = (size_t)y * m_Width + tile.X;
+				memcpy(m_DisplayData.data() + offset, m_ImageData.data() + offset, tile.Width * sizeof(uint32_t));
+			}
+		}
+
+		UploadTiles(completed);
+		return (uint32_t)completed.size();
+	}
+
+	void Renderer::UploadTiles(const std::vector<uint32_t>& tiles)
+	{
+		// ֻϴ仯ͼ飬ÿͼһرֲ
+		std::vector<ImageRegion> regions;
+		regions.reserve(tiles.size());
+		for (uint32_t index : tiles)
+		{
+			const Tile& tile = m_Tiles[index];
+			regions.push_back({ tile.X, tile.Y, tile.Width, tile.Height });
+		}
+		m_FinalImage->SetData(m_DisplayData.data(), regions.data(), (uint32_t)regions.size());
+	}
+
+	void Renderer::ResetAccumulation()
+	{
+		size_t pixelCount = (size_t)m_Width * m_Height;
+		Utils::AssignWithSlack(m_Accumulation, pixelCount, glm::vec4(0.0f));
+		Utils::AssignWithSlack(m_LuminanceM2, pixelCount, 0.0f);
+		Utils::AssignWithSlack(m_SampleCounts, pixelCount, 0u);
+
+		m_TileStates.resize(m_Tiles.size());
+		for (size_t i = 0; i < m_Tiles.size(); i++)
+		{
+			m_TileStates[i].Error = FLT_MAX;
+			m_TileStates[i].ActivePixels = m_Tiles[i].Width * m_Tiles[i].Height;
+		}
+		m_AccumulationPasses = 0;
+		m_ActivePixels = pixelCount;
+	}
+
+	void Renderer::RenderProgressive(const PixelFunction& func, uint64_t sceneHash)
+	{
+		if (m_Tiles.empty())
+			return;
+
+		// ۻաɫӳ仯ʾ屻첽Ⱦռùʱͼתϴ
+		bool fullUpdate = m_Task != nullptr;
+		Cancel();											// 첽Ⱦʾ
+		if (m_Accumulation.size() != (size_t)m_Width * m_Height || m_TileStates.size() != m_Tiles.size() || sceneHash != m_SceneHash)
+		{
+			m_SceneHash = sceneHash;
+			ResetAccumulation();
+			fullUpdate = true;
+		}
+		if (m_AppliedTonemap.Exposure != m_Settings.Tonemap.Exposure || m_AppliedTonemap.Operator != m_Settings.Tonemap.Operator)
+		{
+			m_AppliedTonemap = m_Settings.Tonemap;
+			fullUpdate = true;
+		}
+		if (IsConverged())
+		{
+			if (fullUpdate)
+			{
+				ConvertToRGBA8(m_Accumulation.data(), m_DisplayData.data(), m_Width, m_Height, 1, m_AppliedTonemap);
+				m_FinalImage->SetData(m_DisplayData.data());
+			}
+			return;
+		}
+
+		// ͼǰ
+		std::vector<uint32_t> pending;
+		pending.reserve(m_Tiles.size());
+		for (uint32_t i = 0; i < (uint32_t)m_Tiles.size(); i++)
+		{
+			if (m_TileStates[i].ActivePixels > 0)
+				pending.push_back(i);
+		}
+		std::sort(pending.begin(), pending.end(), [this](uint32_t a, uint32_t b)
+		{
+			if (m_TileStates[a].Error != m_TileStates[b].Error)
+				return m_TileStates[a].Error > m_TileStates[b].Error;
+			return a < b;
+		});
+
+		// ÿ̲߳λһӴСָͼ飨slotslot + slotCount
+		// ԤʱʣµĶСͼ飻з±
+		uint32_t count = (uint32_t)pending.size();
+		uint32_t slotCount = std::min(TaskScheduler::Get().GetWorkerCount() + 1, count);
+
+		// Ԥֻͼ飺ÿĵһͼ飬slotCountͼ鲻ֹʱ䣬ʹ̱߳ƳٵȻԤСÿһҲнչ
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((int64_t)(m_Settings.FrameBudget * 1000.0f));
+		TaskScheduler::Get().ParallelFor(slotCount, [&](uint32_t slot)
+		{
+			for (uint32_t i = slot; i < count; i += slotCount)
+			{
+				if (i != slot && std::chrono::steady_clock::now() >= deadline)	// Ԥ㣬һ֡
+					return;
+				AccumulateTile(pending[i], func);
+			}
+		});
+		m_AccumulationPasses++;
+
+		m_ActivePixels = 0;
+		for (const TileState& state : m_TileStates)
+			m_ActivePixels += state.ActivePixels;
+
+		std::vector<uint32_t> completed;
+		{
+			std::lock_guard<std::mutex> lock(m_CompletedMutex);
+			completed.swap(m_CompletedTiles);
+		}
+		if (fullUpdate)
+		{
+			ConvertToRGBA8(m_Accumulation.data(), m_DisplayData.data(), m_Width, m_Height, 1, m_AppliedTonemap);
+			m_FinalImage->SetData(m_DisplayData.data());
+		}
+		else if (!completed.empty())
+			UploadTiles(completed);
+	}
+
+	void Renderer::AccumulateTile(uint32_t tileIndex, const PixelFunction& func)
+	{
+		const Tile& tile = m_Tiles[tileIndex];
+		const uint32_t minSamples = std::max(m_Settings.MinSamples, 2u);
+		const uint32_t maxSamples = std::max(m_Settings.MaxSamples, minSamples);
+		const float threshold = m_Settings.NoiseThreshold * m_Settings.NoiseThreshold;
+
+		float error = 0.0f;
+		uint32_t activePixels = 0;
+		for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++)
+		{
+			for (uint32_t x = tile.X; x < tile.X + tile.Width; x++)
+			{
+				size_t pixel = (size_t)y * m_Width + x;
+				glm::vec4& mean = m_Accumulation[pixel];
+				float& m2 = m_LuminanceM2[pixel];
+				uint32_t& count = m_SampleCounts[pixel];
+
+				if (count >= maxSamples || (count >= minSamples && Utils::RelativeVariance(Utils::Luminance(mean), m2, count) <= threshold))
+					continue;										// 
+
+				// Welford߸£ֵƽͶΪʧ
+				glm::vec4 sample = func(x, y, count);
+				count++;
+				float previousLuminance = Utils::Luminance(mean);
+				mean += (sample - mean) / (float)count;
+				float luminance = Utils::Luminance(sample);
+				m2 += (luminance - previousLuminance) * (luminance - Utils::Luminance(mean));
+
+				float variance = Utils::RelativeVariance(Utils::Luminance(mean), m2, count);
+				if (count < maxSamples && (count < minSamples || variance > threshold))
+				{
+					activePixels++;
+					error += variance;
+				}
+			}
+		}
+
+		m_TileStates[tileIndex].Error = error;
+		m_TileStates[tileIndex].ActivePixels = activePixels;
+
+		// ݻڻͼתʾ
+		for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++)
+		{
+			size_t offset = (size_t)y * m_Width + tile.X;
+			ConvertToRGBA8(m_Accumulation.data() + offset, m_DisplayData.data() + offset, tile.Width, 1, 1, m_AppliedTonemap);
+		}
+
+		std::lock_guard<std::mutex> lock(m_CompletedMutex);
+		m_CompletedTiles.push_back(tileIndex);
+	}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Image.h"
+#include "TaskScheduler.h"
+
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Cetus {
+
+	struct Tile										// ӿеһͼ飬ұߺ±ߵͼܲTileSize
+	{
+		uint32_t X = 0, Y = 0;
+		uint32_t Width = 0, Height = 0;
+	};
+
+	enum class TileOrder							// ͼķַ˳MortonHilbert±ͼڿռҲڣͬһ̵߳ݸ
+	{
+		Scanline = 0,
+		Morton,
+		Hilbert
+	};
+
+	// ̷ֿ߳CPUȾӿгͼ飬ùȡָкȾ
+	// Ⱦ첽ģUpdateImageѾɵͼ齻Imageϴ֡ûȾʱҲܿ
+	// ģʽRenderProgressiveÿ֡ÿټһۻ㻺УѾزٲ
+	// ʱԤȻͼ
+	class Renderer
+	{
+	public:
+		struct Settings
+		{
+			uint32_t TileSize = 32;					// 32x32RGBA84KBһͼܷŽL1
+			TileOrder Order = TileOrder::Morton;
+
+			// ģʽ
+			float FrameBudget = 10.0f;				// ÿ֡ʱԤ㣨룩ʣµͼһ֡
+			uint32_t MinSamples = 8;				// ٲôβжǷ
+			uint32_t MaxSamples = 1024;
+			float NoiseThreshold = 0.02f;			// ȾֵԱ׼Ϊ
+			TonemapSettings Tonemap;
+		};
+
+		// Ⱦһͼ飺tileΧڵдimageDataRGBA8ÿwidthأڹ߳ϲ
+		using TileFunction = std::function<void(const Tile& tile, uint32_t* imageData, uint32_t width)>;
+		// Ϊ(x, y)sampleIndexɫڹ߳ϲ
+		using PixelFunction = std::function<glm::vec4(uint32_t x, uint32_t y, uint32_t sampleIndex)>;
+
+		Renderer() = default;
+		~Renderer();
+
+		void OnResize(uint32_t width, uint32_t height);	// ߴ仯ʱȡڽеȾ·仺
+		void Render(TileFunction func);				// 첽ʼȾһ֡һ֡ûʱȡ
+		void Cancel();								// ȡڽеȾȴ߳˳
+		void Wait();								// ֱǰȾ
+
+		bool IsRendering() const { return m_Task && !m_Task->IsDone(); }
+		uint32_t GetTileCount() const { return (uint32_t)m_Tiles.size(); }
+		uint32_t GetCompletedTileCount() const { return m_Task ? m_Task->GetCompletedCount() : 0; }
+		float GetProgress() const { return m_Tiles.empty() ? 0.0f : (float)GetCompletedTileCount() / (float)m_Tiles.size(); }
+
+		// UI߳ÿ֡ãɵͼ鿽ʾ岢ϴImageɵͼ
+		uint32_t UpdateImage();
+
+		// ִͬһֽFrameBudgetڷأȻۻɫӳϴImage
+		// sceneHashͳĹϣһֲͬʱԶۻߴ仯Ҳ
+		void RenderProgressive(const PixelFunction& func, uint64_t sceneHash = 0);
+		void ResetAccumulation();
+		bool IsConverged() const { return m_AccumulationPasses > 0 && m_ActivePixels == 0; }
+		uint32_t GetAccumulationPasses() const { return m_AccumulationPasses; }
+		uint64_t GetActivePixelCount() const { return m_ActivePixels; }	// û
+
+		std::shared_ptr<Image> GetFinalImage() const { return m_FinalImage; }
+		Settings& GetSettings() { return m_Settings; }
+	private:
+		void BuildTiles();							// Settingsзͼ鲢ź÷ַ˳
+		void AccumulateTile(uint32_t tileIndex, const PixelFunction& func);
+		void UploadTiles(const std::vector<uint32_t>& tiles);	// ʾЩͼϴImage
+	private:
+		Settings m_Settings;
+		uint32_t m_Width = 0, m_Height = 0;
+
+		std::shared_ptr<Image> m_FinalImage;
+		std::vector<uint32_t> m_ImageData;			// ߳дȾ
+		std::vector<uint32_t> m_DisplayData;		// ֻͼʾ壬UI̴߳ϴд
+		std::vector<Tile> m_Tiles;					// ַ˳
+		uint32_t m_TileSize = 0;
+		TileOrder m_TileOrder = TileOrder::Scanline;
+
+		std::shared_ptr<TaskGroup> m_Task;
+		std::mutex m_CompletedMutex;
+		std::vector<uint32_t> m_CompletedTiles;		// ɡûʾͼ±
+
+		struct TileState							// ģʽÿͼɴͼ߳д
+		{
+			float Error = FLT_MAX;					// δصԷ֮ͣһֵĴ˳
+			uint32_t ActivePixels = 0;
+		};
+
+		std::vector<glm::vec4> m_Accumulation;		// ÿľֵصͬԴֵܺͣ
+		std::vector<float> m_LuminanceM2;			// Welford㷨ȵƽͣƷ
+		std::vector<uint32_t> m_SampleCounts;
+		std::vector<TileState> m_TileStates;
+		uint64_t m_SceneHash = 0;
+		TonemapSettings m_AppliedTonemap;			// ʾеõɫӳ
+		uint32_t m_AccumulationPasses = 0;
+		uint64_t m_ActivePixels = 0;
+	};
+
+}
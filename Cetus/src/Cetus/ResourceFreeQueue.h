@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+namespace Cetus {
+
+	// ӳͷŶУÿͷŲһGPUʱֵGPUִֵӦύŻ
+	// ʱֵ˳룬ûλ尴Ƚȳ˳ռ
+	// ֱӹĿ洢УĿѭãȶʱѷ
+	class ResourceFreeQueue
+	{
+	public:
+		static constexpr size_t InlineStorageSize = 96;		// ͷŲֽܲ
+
+		ResourceFreeQueue() = default;
+		~ResourceFreeQueue() { Flush(); }
+
+		ResourceFreeQueue(const ResourceFreeQueue&) = delete;
+		ResourceFreeQueue& operator=(const ResourceFreeQueue&) = delete;
+
+		template<typename F>
+		void Push(uint64_t retireValue, F&& func)			// һͷŲretireValueʹøԴύʱֵ
+		{
+			using Func = std::decay_t<F>;
+			static_assert(sizeof(Func) <= InlineStorageSize, "Resource free callback captures too much state!");
+			static_assert(alignof(Func) <= alignof(std::max_align_t), "Resource free callback is over-aligned!");
+
+			if (m_Count == m_Entries.size())
+				Grow();
+
+			Entry& entry = m_Entries[(m_Head + m_Count) % m_Entries.size()];
+			new (entry.Storage) Func(std::forward<F>(func));
+			entry.Value = retireValue;
+			entry.Operations = &s_Ops<Func>;
+			m_Count++;
+		}
+
+		void Collect(uint64_t completedValue)				// ִʱֵcompletedValueͷŲ
+		{
+			while (m_Count > 0)
+			{
+				Entry& entry = m_Entries[m_Head];
+				if (entry.Value > completedValue)
+					break;
+				Retire(entry);
+			}
+		}
+
+		void Flush()										// ִȫͷŲǰ豣֤GPUѿ
+		{
+			while (m_Count > 0)
+				Retire(m_Entries[m_Head]);
+		}
+
+		size_t Size() const { return m_Count; }
+		bool Empty() const { return m_Count == 0; }
+	private:
+		struct Ops
+		{
+			void (*Invoke)(void* storage);
+			void (*Move)(void* dst, void* src);				// ʱѺƶµĿ
+			void (*Destroy)(void* storage);
+		};
+
+		template<typename Func>
+		static constexpr Ops s_Ops = {
+			[](void* storage) { (*static_cast<Func*>(storage))(); },
+			[](void* dst, void* src) { new (dst) Func(std::move(*static_cast<Func*>(src))); static_cast<Func*>(src)->~Func(); },
+			[](void* storage) { static_cast<Func*>(storage)->~Func(); }
+		};
+
+		struct Entry
+		{
+			uint64_t Value = 0;
+			const Ops* Operations = nullptr;
+			alignas(std::max_align_t) unsigned char Storage[InlineStorageSize];
+		};
+
+		void Retire(Entry& entry)
+		{
+			// ȰѺƳٵãͷŲٴμУܴݣҲǰȫ
+			const Ops* ops = entry.Operations;
+			alignas(std::max_align_t) unsigned char storage[InlineStorageSize];
+			ops->Move(storage, entry.Storage);
+			entry.Operations = nullptr;
+			m_Head = (m_Head + 1) % m_Entries.size();
+			m_Count--;
+			ops->Invoke(storage);
+			ops->Destroy(storage);
+		}
+
+		void Grow()
+		{
+			std::vector<Entry> entries(m_Entries.empty() ? 64 : m_Entries.size() * 2);
+			for (size_t i = 0; i < m_Count; i++)
+			{
+				Entry& src = m_Entries[(m_Head + i) % m_Entries.size()];
+				entries[i].Value = src.Value;
+				entries[i].Operations = src.Operations;
+				src.Operations->Move(entries[i].Storage, src.Storage);
+			}
+			m_Entries.swap(entries);
+			m_Head = 0;
+		}
+	private:
+		std::vector<Entry> m_Entries;		// λ壬ֻʱɱ
+		size_t m_Head = 0;					// Ŀ
+		size_t m_Count = 0;
+	};
+
+}
@@ -0,0 +1,87 @@
+#include "StagingRing.h"
+
+#include "base/VulkanDevice.h"
+
+#include <stdexcept>
+
+namespace Cetus {
+
+	void StagingRing::Init(VulkanDevice* device, VkDeviceSize capacity)
+	{
+		m_Device = device;
+		m_Capacity = capacity;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = capacity;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(m_Device->logicalDevice, &bufferInfo, nullptr, &m_Buffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create staging ring buffer!");
+		}
+
+		// 豸ڴϴͼ䣨һ¡ܿBARɼڴ鳣פӳ䣬ֱٶȡӳ
+		if (m_Device->memoryAllocator.allocateForBuffer(m_Buffer, MemoryUsage::Upload, &m_Allocation, false, MemoryCategory::Staging) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate staging ring memory!");
+		}
+		m_Mapped = (uint8_t*)m_Allocation.mapped;
+
+		m_Head = m_Tail = m_RetiredHead = 0;
+		m_Fences.clear();
+	}
+
+	void StagingRing::Shutdown()
+	{
+		if (!m_Device)
+			return;
+		vkDestroyBuffer(m_Device->logicalDevice, m_Buffer, nullptr);
+		m_Device->memoryAllocator.free(m_Allocation);
+
+		m_Mapped = nullptr;
+		m_Buffer = VK_NULL_HANDLE;
+		m_Device = nullptr;
+		m_Fences.clear();
+	}
+
+	bool StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation)
+	{
+		if (!m_Mapped || size == 0 || size > m_Capacity)
+			return false;
+
+		// ǻеʵƫƶƫƣһalignmentıƻ֮ƫƶ벻ʵƫƶ
+		if (alignment == 0)
+			alignment = 1;
+		uint64_t physical = m_Head % m_Capacity;
+		uint64_t aligned = (physical + alignment - 1) / alignment * alignment;
+		uint64_t offset = m_Head + (aligned - physical);
+		if (aligned + size > m_Capacity)	// Ųβͷƫ0Ƕģֽηһ
+			offset = m_Head + (m_Capacity - physical);
+		if (offset + size - m_Tail > m_Capacity)
+			return false;
+
+		allocation.Buffer = m_Buffer;
+		allocation.Offset = offset % m_Capacity;
+		allocation.Size = size;
+		allocation.Mapped = m_Mapped + allocation.Offset;
+		m_Head = offset + size;
+		return true;
+	}
+
+	void StagingRing::Retire(uint64_t timelineValue)
+	{
+		if (m_Head == m_RetiredHead)
+			return;
+		m_Fences.push_back({ timelineValue, m_Head });
+		m_RetiredHead = m_Head;
+	}
+
+	void StagingRing::Collect(uint64_t completedValue)
+	{
+		while (!m_Fences.empty() && m_Fences.front().TimelineValue <= completedValue)
+		{
+			m_Tail = m_Fences.front().Head;
+			m_Fences.pop_front();
+		}
+	}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+#include "vulkan/vulkan.h"
+#include "base/VulkanMemoryAllocator.h"
+
+namespace Cetus {
+
+	class VulkanDevice;
+
+	struct StagingAllocation							// ϴзһݴռ
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;				// õĻ
+		VkDeviceSize Offset = 0;						// οռڻеƫƣֱΪVkBufferImageCopy::bufferOffset
+		VkDeviceSize Size = 0;
+		void* Mapped = nullptr;							// ־ӳCPUַڴHOST_COHERENTģдflush
+	};
+
+	// Imageõϴһ־ӳɼ壬Ƚȳ˳
+	// ÿ֡ύһ֡Ŀռϸ֡ʱֵGPUԽֵռ䱻
+	class StagingRing
+	{
+	public:
+		void Init(VulkanDevice* device, VkDeviceSize capacity);
+		void Shutdown();
+
+		// sizeֽڡƫưalignmentĿռ䣻ʣռ䲻㣨GPUڶȡ󳬹ʱfalse
+		bool Allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation);
+
+		void Retire(uint64_t timelineValue);			// ϴRetireĿռ佻timelineValueӦύ
+		void Collect(uint64_t completedValue);			// GPUѾɵύʹõĿռ
+
+		VkDeviceSize GetCapacity() const { return m_Capacity; }
+		VkDeviceSize GetUsedSize() const { return m_Head - m_Tail; }
+	private:
+		struct Fence
+		{
+			uint64_t TimelineValue;
+			uint64_t Head;								// ύʱдλãύɺȡλÿƽ
+		};
+
+		VulkanDevice* m_Device = nullptr;
+		VkBuffer m_Buffer = VK_NULL_HANDLE;
+		Allocation m_Allocation;
+		uint8_t* m_Mapped = nullptr;
+		VkDeviceSize m_Capacity = 0;
+
+		// дλúͶȡλöǵƫƣȡģõеʵƫƣ֮ʹõֽ
+		uint64_t m_Head = 0;
+		uint64_t m_Tail = 0;
+		uint64_t m_RetiredHead = 0;						// һRetireʱдλ
+		std::deque<Fence> m_Fences;
+	};
+
+}
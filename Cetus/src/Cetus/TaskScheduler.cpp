@@ -0,0 +1,198 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+namespace Cetus {
+
+	TaskGroup::TaskGroup(uint32_t count, uint32_t slotCount, std::function<void(uint32_t index)>&& func)
+		: m_Func(std::move(func)), m_Ranges(new Range[slotCount]), m_SlotCount(slotCount), m_Count(count), m_Remaining(count)
+	{
+		// ƽз֣ǰcount % slotCountλһ
+		uint32_t begin = 0;
+		for (uint32_t i = 0; i < slotCount; i++)
+		{
+			uint32_t size = count / slotCount + (i < count % slotCount ? 1 : 0);
+			m_Ranges[i].Begin = begin;
+			m_Ranges[i].End = begin + size;
+			begin += size;
+		}
+	}
+
+	bool TaskGroup::Pop(uint32_t slot, uint32_t& index)
+	{
+		Range& range = m_Ranges[slot];
+		std::lock_guard<std::mutex> lock(range.Mutex);
+		if (range.Begin == range.End)
+			return false;
+		index = range.Begin++;
+		return true;
+	}
+
+	bool TaskGroup::Steal(uint32_t slot, uint32_t& index)
+	{
+		// ʣĲλĺΣһ±ִУŽԼĲλ
+		while (true)
+		{
+			uint32_t victim = slot;
+			uint32_t victimSize = 0;
+			for (uint32_t i = 1; i < m_SlotCount; i++)
+			{
+				uint32_t candidate = (slot + i) % m_SlotCount;
+				Range& range = m_Ranges[candidate];
+				std::lock_guard<std::mutex> lock(range.Mutex);
+				if (range.End - range.Begin > victimSize)
+				{
+					victim = candidate;
+					victimSize = range.End - range.Begin;
+				}
+			}
+			if (victim == slot)
+				return false;
+
+			uint32_t begin, end;
+			{
+				Range& range = m_Ranges[victim];
+				std::lock_guard<std::mutex> lock(range.Mutex);
+				if (range.Begin == range.End)		// ֮󱻱ˣ
+					continue;
+				end = range.End;
+				begin = range.Begin + (range.End - range.Begin) / 2;
+				range.End = begin;
+			}
+
+			index = begin;
+			Range& own = m_Ranges[slot];
+			std::lock_guard<std::mutex> lock(own.Mutex);
+			own.Begin = begin + 1;
+			own.End = end;
+			return true;
+		}
+	}
+
+	bool TaskGroup::Execute(uint32_t slot, const std::atomic<uint32_t>* yield)
+	{
+		uint32_t index;
+		while (Pop(slot, index) || Steal(slot, index))
+		{
+			if (!IsCancelled())
+				m_Func(index);
+			if (m_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> lock(m_DoneMutex);
+				m_DoneCondition.notify_all();
+			}
+			if (yield && yield->load(std::memory_order_relaxed) != 0)	// Լλʣµ±ԭ򱻱ȡ
+				return false;
+		}
+		return true;
+	}
+
+	void TaskGroup::Wait()
+	{
+		// һλ߳
+		Execute(m_SlotCount - 1);
+
+		std::unique_lock<std::mutex> lock(m_DoneMutex);
+		m_DoneCondition.wait(lock, [this]() { return IsDone(); });
+	}
+
+	TaskScheduler::TaskScheduler(uint32_t workerCount)
+	{
+		if (workerCount == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Workers.emplace_back(&TaskScheduler::WorkerLoop, this, i);
+	}
+
+	TaskScheduler::~TaskScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_WakeCondition.notify_all();
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	TaskScheduler& TaskScheduler::Get()
+	{
+		static TaskScheduler s_Scheduler;
+		return s_Scheduler;
+	}
+
+	std::shared_ptr<TaskGroup> TaskScheduler::Dispatch(uint32_t count, std::function<void(uint32_t index)> func)
+	{
+		auto group = std::make_shared<TaskGroup>(count, GetWorkerCount() + 1, std::move(func));
+		if (count == 0)
+			return group;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Groups.push_back(group);
+		}
+		m_WakeCondition.notify_all();
+		return group;
+	}
+
+	void TaskScheduler::ParallelFor(uint32_t count, std::function<void(uint32_t index)> func)
+	{
+		if (count == 0)
+			return;
+
+		auto group = std::make_shared<TaskGroup>(count, GetWorkerCount() + 1, std::move(func));
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_SyncGroups.push_back(group);
+			m_SyncCount.store((uint32_t)m_SyncGroups.size(), std::memory_order_relaxed);
+		}
+		m_WakeCondition.notify_all();
+
+		group->Wait();
+
+		// ߳̿Լ±꣬߳ûлƳ
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Remove(group, true);
+	}
+
+	void TaskScheduler::Remove(const std::shared_ptr<TaskGroup>& group, bool sync)
+	{
+		std::deque<std::shared_ptr<TaskGroup>>& groups = sync ? m_SyncGroups : m_Groups;
+		auto it = std::find(groups.begin(), groups.end(), group);
+		if (it != groups.end())
+			groups.erase(it);
+		if (sync)
+			m_SyncCount.store((uint32_t)m_SyncGroups.size(), std::memory_order_relaxed);
+	}
+
+	void TaskScheduler::WorkerLoop(uint32_t slot)
+	{
+		while (true)
+		{
+			std::shared_ptr<TaskGroup> group;
+			bool sync;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_WakeCondition.wait(lock, [this]() { return m_Stop || !m_SyncGroups.empty() || !m_Groups.empty(); });
+				if (m_Stop)
+					return;
+				sync = !m_SyncGroups.empty();
+				group = sync ? m_SyncGroups.front() : m_Groups.front();
+			}
+
+			// 첽ParallelForȴʱọ́߳һȴParallelFor
+			if (!group->Execute(slot, sync ? nullptr : &m_SyncCount))
+				continue;
+
+			// Executetrue˵Ѿûпȡ±ִ꣨еĿܻûӶƳ
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Remove(group, sync);
+		}
+	}
+
+}
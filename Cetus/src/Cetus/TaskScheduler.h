@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Cetus {
+
+	// һβзַ[0, count)±ִָ߳funcѯȡȴɻȡ
+	class TaskGroup
+	{
+	public:
+		TaskGroup(uint32_t count, uint32_t slotCount, std::function<void(uint32_t index)>&& func);
+
+		bool IsDone() const { return m_Remaining.load(std::memory_order_acquire) == 0; }
+		uint32_t GetCount() const { return m_Count; }
+		uint32_t GetCompletedCount() const { return m_Count - m_Remaining.load(std::memory_order_acquire); }
+
+		void Cancel() { m_Cancelled.store(true, std::memory_order_relaxed); }	// ûʼ±겻ٵfuncԼΪ
+		bool IsCancelled() const { return m_Cancelled.load(std::memory_order_relaxed); }
+
+		void Wait();								// ߳ҲִУֱȫ±
+	private:
+		friend class TaskScheduler;
+
+		// ִԼλ±꣬λȡyieldʱ±֮ọ́߳falseʾ±δȡ
+		bool Execute(uint32_t slot, const std::atomic<uint32_t>* yield = nullptr);
+		bool Pop(uint32_t slot, uint32_t& index);
+		bool Steal(uint32_t slot, uint32_t& index);
+	private:
+		struct Range								// ÿ̲߳λһ±꣬ߴǰȡȡߺ
+		{
+			std::mutex Mutex;
+			uint32_t Begin = 0;
+			uint32_t End = 0;
+		};
+
+		std::function<void(uint32_t index)> m_Func;
+		std::unique_ptr<Range[]> m_Ranges;
+		uint32_t m_SlotCount;
+		uint32_t m_Count;
+		std::atomic<uint32_t> m_Remaining;
+		std::atomic<bool> m_Cancelled = false;
+
+		std::mutex m_DoneMutex;
+		std::condition_variable m_DoneCondition;
+	};
+
+	// ȡ̳߳ءÿηַ±갴߳гĶΣ±꣨ڵͼ飩ͬһִ߳У
+	// ĳ̵߳Ķִ󣬴߳ʣĶȡΡ
+	// ͬParallelFor첽飺ParallelForȴʱ߳첽±֮óȴ
+	class TaskScheduler
+	{
+	public:
+		explicit TaskScheduler(uint32_t workerCount = 0);	// 0ʾӲ߳һ߳Waitʱһ
+		~TaskScheduler();
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		static TaskScheduler& Get();						// ȫֹĵһʹʱ
+
+		uint32_t GetWorkerCount() const { return (uint32_t)m_Workers.size(); }
+
+		// 첽ַأַ̰߳˳
+		std::shared_ptr<TaskGroup> Dispatch(uint32_t count, std::function<void(uint32_t index)> func);
+		// ͬѭ߳ҲִУִе첽ǰ棬
+		void ParallelFor(uint32_t count, std::function<void(uint32_t index)> func);
+	private:
+		void WorkerLoop(uint32_t slot);
+		void Remove(const std::shared_ptr<TaskGroup>& group, bool sync);	// ǰҪסm_Mutex
+	private:
+		std::vector<std::thread> m_Workers;
+		std::deque<std::shared_ptr<TaskGroup>> m_Groups;	// ±δȡ첽
+		std::deque<std::shared_ptr<TaskGroup>> m_SyncGroups;	// ±δȡParallelFor飬ȴ
+		std::atomic<uint32_t> m_SyncCount = 0;				// m_SyncGroupsĴС첽ִʱó߳
+		std::mutex m_Mutex;
+		std::condition_variable m_WakeCondition;
+		bool m_Stop = false;
+	};
+
+}
@@ -0,0 +1,359 @@
+#include "UploadContext.h"
+
+#include "base/VulkanDevice.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Cetus {
+
+	static constexpr VkDeviceSize s_StagingBlockSize = 8 * 1024 * 1024;	// ݴÿСС
+
+	void FencePool::Shutdown()
+	{
+		for (VkFence fence : m_AllFences)
+			vkDestroyFence(m_Device, fence, nullptr);
+		m_AllFences.clear();
+		m_Fences.clear();
+	}
+
+	VkFence FencePool::Acquire()
+	{
+		if (!m_Fences.empty())
+		{
+			VkFence fence = m_Fences.back();
+			m_Fences.pop_back();
+			return fence;
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		VkFence fence;
+		if (vkCreateFence(m_Device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create fence!");
+		}
+		m_AllFences.push_back(fence);
+		return fence;
+	}
+
+	void FencePool::Release(VkFence fence)
+	{
+		vkResetFences(m_Device, 1, &fence);
+		m_Fences.push_back(fence);
+	}
+
+	void UploadContext::Init(VulkanDevice* device, FencePool* fencePool, VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily)
+	{
+		m_Device = device;
+		m_FencePool = fencePool;
+		m_TransferQueue = transferQueue;
+		m_TransferFamily = transferFamily;
+		m_GraphicsQueue = graphicsQueue;
+		m_GraphicsFamily = graphicsFamily;
+	}
+
+	void UploadContext::Shutdown()
+	{
+		// ǰ豸Ѿ
+		if (m_Recording)
+		{
+			vkEndCommandBuffer(m_Current.CommandBuffer);
+			DestroyBatch(m_Current);
+			m_Recording = false;
+		}
+		for (Batch& batch : m_InFlight)
+			DestroyBatch(batch);
+		for (Batch& batch : m_FreeBatches)
+			DestroyBatch(batch);
+		m_InFlight.clear();
+		m_FreeBatches.clear();
+
+		for (VkSemaphore semaphore : m_AllSemaphores)
+			vkDestroySemaphore(m_Device->logicalDevice, semaphore, nullptr);
+		m_AllSemaphores.clear();
+		m_FreeSemaphores.clear();
+		m_PendingSemaphores.clear();
+		m_PendingAcquires.clear();
+		m_CurrentAcquires.clear();
+	}
+
+	UploadContext::Batch UploadContext::CreateBatch()
+	{
+		Batch batch;
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = m_TransferFamily;
+		if (vkCreateCommandPool(m_Device->logicalDevice, &poolInfo, nullptr, &batch.CommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = batch.CommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(m_Device->logicalDevice, &allocInfo, &batch.CommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+		return batch;
+	}
+
+	void UploadContext::DestroyBatch(Batch& batch)
+	{
+		for (StagingBlock& block : batch.Staging)
+		{
+			vkDestroyBuffer(m_Device->logicalDevice, block.Buffer, nullptr);
+			m_Device->memoryAllocator.free(block.Memory);
+		}
+		batch.Staging.clear();
+		if (batch.Fence)
+			m_FencePool->Release(batch.Fence);
+		vkDestroyCommandPool(m_Device->logicalDevice, batch.CommandPool, nullptr);
+		batch = Batch();
+	}
+
+	void UploadContext::RecycleBatch(Batch& batch)
+	{
+		// ֻһݴżĴϴһֱռڴ
+		for (size_t i = 1; i < batch.Staging.size(); i++)
+		{
+			StagingBlock& block = batch.Staging[i];
+			vkDestroyBuffer(m_Device->logicalDevice, block.Buffer, nullptr);
+			m_Device->memoryAllocator.free(block.Memory);
+		}
+		if (batch.Staging.size() > 1)
+			batch.Staging.resize(1);
+		for (StagingBlock& block : batch.Staging)
+			block.Used = 0;
+
+		m_FencePool->Release(batch.Fence);
+		batch.Fence = VK_NULL_HANDLE;
+		vkResetCommandPool(m_Device->logicalDevice, batch.CommandPool, 0);
+		m_FreeBatches.push_back(std::move(batch));
+	}
+
+	VkSemaphore UploadContext::AcquireSemaphore()
+	{
+		if (!m_FreeSemaphores.empty())
+		{
+			VkSemaphore semaphore = m_FreeSemaphores.back();
+			m_FreeSemaphores.pop_back();
+			return semaphore;
+		}
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		VkSemaphore semaphore;
+		if (vkCreateSemaphore(m_Device->logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload semaphore!");
+		}
+		m_AllSemaphores.push_back(semaphore);
+		return semaphore;
+	}
+
+	VkCommandBuffer UploadContext::GetCommandBuffer()
+	{
+		if (!m_Recording)
+		{
+			if (!m_FreeBatches.empty())
+			{
+				m_Current = std::move(m_FreeBatches.back());
+				m_FreeBatches.pop_back();
+			}
+			else
+			{
+				m_Current = CreateBatch();
+			}
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			if (vkBeginCommandBuffer(m_Current.CommandBuffer, &beginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("failed to begin upload command buffer!");
+			}
+			m_Current.Value = m_NextValue;
+			m_Recording = true;
+		}
+		return m_Current.CommandBuffer;
+	}
+
+	StagingAllocation UploadContext::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		GetCommandBuffer();
+
+		StagingBlock* block = nullptr;
+		VkDeviceSize offset = 0;
+		if (!m_Current.Staging.empty())
+		{
+			StagingBlock& last = m_Current.Staging.back();
+			offset = (last.Used + alignment - 1) / alignment * alignment;
+			if (offset + size <= last.Size)
+				block = &last;
+		}
+
+		if (!block)
+		{
+			StagingBlock newBlock;
+			newBlock.Size = std::max(size, s_StagingBlockSize);
+
+			VkBufferCreateInfo bufferInfo = {};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = newBlock.Size;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if (vkCreateBuffer(m_Device->logicalDevice, &bufferInfo, nullptr, &newBlock.Buffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create upload staging buffer!");
+			}
+			if (m_Device->memoryAllocator.allocateForBuffer(newBlock.Buffer, MemoryUsage::Upload, &newBlock.Memory, false, MemoryCategory::Staging) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate upload staging memory!");
+			}
+			newBlock.Mapped = (uint8_t*)newBlock.Memory.mapped;
+
+			m_Current.Staging.push_back(newBlock);
+			block = &m_Current.Staging.back();
+			offset = 0;
+		}
+
+		StagingAllocation allocation;
+		allocation.Buffer = block->Buffer;
+		allocation.Offset = offset;
+		allocation.Size = size;
+		allocation.Mapped = block->Mapped + offset;
+		block->Used = offset + size;
+		return allocation;
+	}
+
+	void UploadContext::ReleaseImage(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+	{
+		VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = range;
+
+		if (!IsDedicatedQueue())
+		{
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+			return;
+		}
+
+		// ͷϣֻдĿԺͲתdstAccessMaskͷŶ˱
+		barrier.srcQueueFamilyIndex = m_TransferFamily;
+		barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		// ȡϣֺͶͷȫһ£srcAccessMaskڻȡ˱
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = dstAccessMask;
+		m_CurrentAcquires.push_back(barrier);
+		m_CurrentAcquireStages |= dstStageMask;
+	}
+
+	UploadTicket UploadContext::Submit()
+	{
+		if (!m_Recording)
+			return { m_NextValue - 1 };
+
+		if (vkEndCommandBuffer(m_Current.CommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record upload command buffer!");
+		}
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &m_Current.CommandBuffer;
+
+		// ͷͼȨηһźһ֡ͼζϵȴִлȡ
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		if (!m_CurrentAcquires.empty())
+		{
+			semaphore = AcquireSemaphore();
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &semaphore;
+		}
+
+		m_Current.Fence = m_FencePool->Acquire();
+		if (vkQueueSubmit(m_TransferQueue, 1, &submitInfo, m_Current.Fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit upload command buffer!");
+		}
+
+		if (semaphore)
+		{
+			m_PendingSemaphores.push_back(semaphore);
+			m_PendingAcquires.insert(m_PendingAcquires.end(), m_CurrentAcquires.begin(), m_CurrentAcquires.end());
+			m_PendingAcquireStages |= m_CurrentAcquireStages;
+			m_CurrentAcquires.clear();
+			m_CurrentAcquireStages = 0;
+		}
+
+		UploadTicket ticket = { m_Current.Value };
+		m_InFlight.push_back(std::move(m_Current));
+		m_Current = Batch();
+		m_Recording = false;
+		m_NextValue++;
+		return ticket;
+	}
+
+	bool UploadContext::IsComplete(UploadTicket ticket)
+	{
+		if (ticket.Value <= m_CompletedValue)
+			return true;
+		Collect();
+		return ticket.Value <= m_CompletedValue;
+	}
+
+	void UploadContext::Wait(UploadTicket ticket)
+	{
+		if (m_Recording && ticket.Value >= m_Current.Value)
+			Submit();
+
+		while (!m_InFlight.empty() && m_InFlight.front().Value <= ticket.Value)
+		{
+			Batch& batch = m_InFlight.front();
+			vkWaitForFences(m_Device->logicalDevice, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+			m_CompletedValue = batch.Value;
+			RecycleBatch(batch);
+			m_InFlight.pop_front();
+		}
+	}
+
+	void UploadContext::Collect()
+	{
+		// ͬһϵΰύ˳ɣһδɵľͿֹͣ
+		while (!m_InFlight.empty())
+		{
+			Batch& batch = m_InFlight.front();
+			if (vkGetFenceStatus(m_Device->logicalDevice, batch.Fence) != VK_SUCCESS)
+				break;
+			m_CompletedValue = batch.Value;
+			RecycleBatch(batch);
+			m_InFlight.pop_front();
+		}
+	}
+
+	bool UploadContext::TakePendingAcquires(std::vector<VkImageMemoryBarrier>& barriers, VkPipelineStageFlags& dstStageMask, std::vector<VkSemaphore>& semaphores)
+	{
+		if (m_PendingSemaphores.empty())
+			return false;
+
+		barriers.insert(barriers.end(), m_PendingAcquires.begin(), m_PendingAcquires.end());
+		semaphores.insert(semaphores.end(), m_PendingSemaphores.begin(), m_PendingSemaphores.end());
+		dstStageMask |= m_PendingAcquireStages;
+		m_PendingAcquires.clear();
+		m_PendingSemaphores.clear();
+		m_PendingAcquireStages = 0;
+		return true;
+	}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "StagingRing.h"
+
+namespace Cetus {
+
+	class VulkanDevice;
+
+	class FencePool									// դأդúŻسиãÿύդ
+	{
+	public:
+		void Init(VkDevice device) { m_Device = device; }
+		void Shutdown();
+
+		VkFence Acquire();							// ȡһδդ
+		void Release(VkFence fence);				// 黹դǰդѾδύ
+	private:
+		VkDevice m_Device = VK_NULL_HANDLE;
+		std::vector<VkFence> m_Fences;				// еդ
+		std::vector<VkFence> m_AllFences;			// ȫդShutdownʱͳһ
+	};
+
+	struct UploadTicket								// һϴƱݣԲѯȴGPU
+	{
+		uint64_t Value = 0;							// ţ0ʾƱݣΪѾ
+	};
+
+	// ϴģഫ¼ͬһһύƱݲѯ
+	// 豸жĴʱڴִУͼͨȨתƽͼζУ
+	// ¼ͷϲźһ֡ύȴź֡ϴ¼ӦĻȡ
+	// ûʽύλһ֡ύǰApplicationԶύ
+	// ϴֻʺϵǰûб֡Դ½ͼ񡢼سÿ֡µͼӦʹImage::SetData(data)
+	class UploadContext
+	{
+	public:
+		void Init(VulkanDevice* device, FencePool* fencePool, VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily);
+		void Shutdown();
+
+		VkCommandBuffer GetCommandBuffer();			// ȡǰε壨ѿʼ¼ҪԼύ
+		// ӵǰεݴռ䣬ɺաݴǳ־ӳHOST_COHERENTģдflush
+		StagingAllocation AllocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+		// ͼĴд¼ϣתͼζʹõĲ֣ʹöʱ¼ͷϣȡһ֡
+		void ReleaseImage(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout,
+			VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+		UploadTicket Submit();						// ύǰβƱݣǰΪʱһύƱ
+		bool IsComplete(UploadTicket ticket);		// زѯƱǷ
+		void Wait(UploadTicket ticket);				// ֱƱɣƱݶӦδύʱύ
+		void Collect();								// ѾɵΣÿ֡ʼʱ
+
+		bool IsDedicatedQueue() const { return m_TransferFamily != m_GraphicsFamily; }
+
+		// Application֡ύǰãȡȴͼζлȡͼϺҪȴź
+		// źڵȴύɺͨRecycleSemaphore黹
+		bool TakePendingAcquires(std::vector<VkImageMemoryBarrier>& barriers, VkPipelineStageFlags& dstStageMask, std::vector<VkSemaphore>& semaphores);
+		void RecycleSemaphore(VkSemaphore semaphore) { m_FreeSemaphores.push_back(semaphore); }
+	private:
+		struct StagingBlock
+		{
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			Allocation Memory;
+			uint8_t* Mapped = nullptr;
+			VkDeviceSize Size = 0;
+			VkDeviceSize Used = 0;
+		};
+
+		struct Batch
+		{
+			VkCommandPool CommandPool = VK_NULL_HANDLE;		// ÿһأʱ
+			VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+			VkFence Fence = VK_NULL_HANDLE;					// ύʱդȡɺ黹
+			uint64_t Value = 0;
+			std::vector<StagingBlock> Staging;				// רõݴպһ鹩´ʹ
+		};
+
+		Batch CreateBatch();
+		void DestroyBatch(Batch& batch);
+		void RecycleBatch(Batch& batch);
+		VkSemaphore AcquireSemaphore();
+	private:
+		VulkanDevice* m_Device = nullptr;
+		FencePool* m_FencePool = nullptr;
+		VkQueue m_TransferQueue = VK_NULL_HANDLE;
+		VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
+		uint32_t m_TransferFamily = 0;
+		uint32_t m_GraphicsFamily = 0;
+
+		Batch m_Current;									// ڼ¼
+		bool m_Recording = false;
+		std::deque<Batch> m_InFlight;						// ύŵе
+		std::vector<Batch> m_FreeBatches;					// ɡԸõ
+		uint64_t m_NextValue = 1;
+		uint64_t m_CompletedValue = 0;
+
+		std::vector<VkImageMemoryBarrier> m_CurrentAcquires;	// ǰͷŵͼӦĻȡ
+		VkPipelineStageFlags m_CurrentAcquireStages = 0;
+		std::vector<VkImageMemoryBarrier> m_PendingAcquires;	// ύȴһ֡ȡ
+		VkPipelineStageFlags m_PendingAcquireStages = 0;
+		std::vector<VkSemaphore> m_PendingSemaphores;
+		std::vector<VkSemaphore> m_FreeSemaphores;
+		std::vector<VkSemaphore> m_AllSemaphores;
+	};
+
+}
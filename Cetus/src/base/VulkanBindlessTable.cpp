@@ -0,0 +1,169 @@
+#include "VulkanBindlessTable.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Cetus
+{
+	bool BindlessTable::querySupport(VkInstance instance, VkPhysicalDevice physicalDevice, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& enabledFeatures, uint32_t& maxTextures)
+	{
+		enabledFeatures = {};
+		enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		maxTextures = 0;
+
+		PFN_vkGetPhysicalDeviceFeatures2KHR getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+		PFN_vkGetPhysicalDeviceProperties2KHR getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
+		if (!getFeatures2 || !getProperties2)
+			return false;
+
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2KHR features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features2.pNext = &supported;
+		getFeatures2(physicalDevice, &features2);
+
+		// ÷һ±ʡ󶨺¡ְ󶨡ʱС飬ȱһ
+		if (!supported.shaderSampledImageArrayNonUniformIndexing || !supported.descriptorBindingSampledImageUpdateAfterBind ||
+			!supported.descriptorBindingUpdateUnusedWhilePending || !supported.descriptorBindingPartiallyBound || !supported.runtimeDescriptorArray)
+			return false;
+
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2KHR properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+		properties2.pNext = &indexingProperties;
+		getProperties2(physicalDevice, &properties2);
+		maxTextures = std::min(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+		maxTextures = std::min(maxTextures, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers);
+
+		enabledFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		enabledFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		enabledFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		enabledFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+		enabledFeatures.runtimeDescriptorArray = VK_TRUE;
+		return maxTextures > 0;
+	}
+
+	VkResult BindlessTable::create(VkDevice device, uint32_t capacity)
+	{
+		assert(capacity > 0);
+		this->device = device;
+		this->capacity = capacity;
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = capacity;
+		binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+		// ûдԪزܱʵԴڣѰ󶨵ļûʹõԪؿʱ
+		VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+		VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+		bindingFlagsInfo.bindingCount = 1;
+		bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.pNext = &bindingFlagsInfo;
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		VkResult result = vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout);
+		if (result != VK_SUCCESS)
+			return result;
+
+		// UPDATE_AFTER_BINDļֻܴӴͬ־ĳط䣬ԲDescriptorAllocatorĳ
+		VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity };
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		result = vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool);
+		if (result != VK_SUCCESS)
+		{
+			destroy();
+			return result;
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+		result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+		if (result != VK_SUCCESS)
+			destroy();
+		return result;
+	}
+
+	void BindlessTable::destroy()
+	{
+		if (!device)
+			return;
+		if (pool)
+			vkDestroyDescriptorPool(device, pool, nullptr);	// һͷ
+		if (layout)
+			vkDestroyDescriptorSetLayout(device, layout, nullptr);
+		pool = VK_NULL_HANDLE;
+		layout = VK_NULL_HANDLE;
+		descriptorSet = VK_NULL_HANDLE;
+		freeIndices.clear();
+		next = 0;
+		capacity = 0;
+		device = VK_NULL_HANDLE;
+	}
+
+	uint32_t BindlessTable::registerTexture(const VkDescriptorImageInfo& imageInfo)
+	{
+		uint32_t index;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!freeIndices.empty())
+			{
+				index = freeIndices.back();
+				freeIndices.pop_back();
+			}
+			else if (next < capacity)
+				index = next++;
+			else
+				return invalidIndex;
+		}
+		updateTexture(index, imageInfo);
+		return index;
+	}
+
+	void BindlessTable::updateTexture(uint32_t index, const VkDescriptorImageInfo& imageInfo)
+	{
+		assert(index < capacity);
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = descriptorSet;
+		write.dstBinding = 0;
+		write.dstArrayElement = index;
+		write.descriptorCount = 1;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.pImageInfo = &imageInfo;
+		std::lock_guard<std::mutex> lock(mutex);
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+
+	void BindlessTable::unregisterTexture(uint32_t index)
+	{
+		if (index == invalidIndex || !device)
+			return;
+		// գPARTIALLY_BOUNDûɫ±Ͳ
+		std::lock_guard<std::mutex> lock(mutex);
+		assert(index < next);
+		freeIndices.push_back(index);
+	}
+
+	uint32_t BindlessTable::getUsedCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return next - static_cast<uint32_t>(freeIndices.size());
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace Cetus
+{
+	// ްһȫbinding 0һܴCOMBINED_IMAGE_SAMPLER飬UPDATE_AFTER_BINDPARTIALLY_BOUND־
+	// ǼǺõһ±꣬ɫͨͳSSBO±ֱ飬ʱٰͼԪл
+	// ҲǼӻƺGPUƵǰᡣҪVK_EXT_descriptor_indexingVulkan 1.2ģquerySupport
+	class BindlessTable
+	{
+	public:
+		static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		uint32_t capacity = 0;
+
+		// ѯ豸Ƿ֧ް֧ʱҪ豸ϢԽṹ壨pNextɵã
+		// maxTextures豸ޡҪʵVK_KHR_get_physical_device_properties2
+		static bool querySupport(VkInstance instance, VkPhysicalDevice physicalDevice, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& enabledFeatures, uint32_t& maxTextures);
+
+		VkResult	create(VkDevice device, uint32_t capacity);
+		void		destroy();
+		bool		isCreated() const { return descriptorSet != VK_NULL_HANDLE; }
+
+		// ռһ±겢дʱinvalidIndexڰϵִڼ
+		uint32_t	registerTexture(const VkDescriptorImageInfo& imageInfo);
+		void		updateTexture(uint32_t index, const VkDescriptorImageInfo& imageInfo);
+		// 黹±꣺߱뱣ִ֤еٷŽӳͷŶ
+		void		unregisterTexture(uint32_t index);
+
+		uint32_t	getUsedCount();
+	private:
+		VkDevice device = VK_NULL_HANDLE;
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		std::mutex mutex;						// vkUpdateDescriptorSetsͬһҪⲿͬ
+		std::vector<uint32_t> freeIndices;		// 黹±꣬
+		uint32_t next = 0;						// δʹùĵһ±
+	};
+}
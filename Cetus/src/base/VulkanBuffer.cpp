@@ -5,6 +5,11 @@ namespace Cetus
 	// mapڽһֻȫӳ䵽ڴ(һڴ)
 	VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset)
 	{
+		if (allocation.mapped)				// ӷڴѾפӳ䣬ֱӷƫƺĵַ
+		{
+			mapped = (uint8_t*)allocation.mapped + offset;
+			return VK_SUCCESS;
+		}
 		return vkMapMemory(device, memory, offset, size, 0, &mapped);
 	}
 
@@ -13,7 +18,8 @@ namespace Cetus
 	{
 		if (mapped)							// ӳڴ治Ϊ
 		{
-			vkUnmapMemory(device, memory);	// Vulkan APIvkUnmapMemory豸ڴȡӳ
+			if (!allocation.mapped)			// פӳڴɷӳ
+				vkUnmapMemory(device, memory);	// Vulkan APIvkUnmapMemory豸ڴȡӳ
 			mapped = nullptr;				// ӳڴָΪ
 		}
 	}
@@ -21,7 +27,7 @@ namespace Cetus
 	// bindڽ󶨵豸ڴָƫ
 	VkResult Buffer::bind(VkDeviceSize offset)
 	{
-		return vkBindBufferMemory(device, buffer, memory, offset);
+		return vkBindBufferMemory(device, buffer, memory, allocation.offset + offset);
 	}
 
 	// setupDescriptorûϢָĴСƫ
@@ -42,6 +48,8 @@ namespace Cetus
 	// flushڽӳڴˢµ豸ڴ
 	VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset)
 	{
+		if (allocator && allocation.valid())	// ӷķΧҪڴеƫƣnonCoherentAtomSize
+			return allocator->flush(allocation, offset, size);
 		VkMappedMemoryRange mappedRange = {};
 		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 		mappedRange.memory = memory;		// ṹڴΪǰڴ
@@ -53,6 +61,8 @@ namespace Cetus
 	// invalidateڽ豸ڴʧЧʹӳڴܹȡµ
 	VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
 	{
+		if (allocator && allocation.valid())
+			return allocator->invalidate(allocation, offset, size);
 		VkMappedMemoryRange mappedRange = {};
 		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 		mappedRange.memory = memory;
@@ -68,9 +78,16 @@ namespace Cetus
 		{
 			vkDestroyBuffer(device, buffer, nullptr);
 		}
-		if (memory)							// ڴ治Ϊ
+		if (allocator && allocation.valid())// ӷڴ滹
+		{
+			allocator->free(allocation);
+		}
+		else if (memory)					// ڴ治Ϊ
 		{
 			vkFreeMemory(device, memory, nullptr);
 		}
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+		mapped = nullptr;
 	}
 };
@@ -4,6 +4,7 @@
 
 #include "vulkan/vulkan.h"
 #include "VulkanTools.h"	// assert,VK_CHECK_RESULTҪ
+#include "VulkanMemoryAllocator.h"
 
 namespace Cetus
 {	
@@ -18,6 +19,8 @@ namespace Cetus
 		void* mapped = nullptr;
 		VkBufferUsageFlags usageFlags;
 		VkMemoryPropertyFlags memoryPropertyFlags;
+		Allocation allocation;					// VulkanDevice::createBufferӷʱЧmemoryڵڴ
+		MemoryAllocator* allocator = nullptr;
 
 		VkResult	map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		void		unmap();
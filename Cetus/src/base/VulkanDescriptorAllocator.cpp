@@ -0,0 +1,409 @@
+#include "VulkanDescriptorAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Cetus
+{
+	static constexpr uint32_t maxSetsPerPool = 4096;
+
+	template<typename T>
+	static uint64_t handleKey(T handle)
+	{
+		return (uint64_t)handle;	// 64λ·Ƿɾָ룬32λuint64_tCתֶ
+	}
+
+	size_t DescriptorAllocator::KeyHash::operator()(const std::vector<uint64_t>& key) const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (uint64_t value : key)
+		{
+			hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+		}
+		return (size_t)hash;
+	}
+
+	void DescriptorAllocator::init(VkDevice device)
+	{
+		this->device = device;
+		frames.resize(1);
+		currentFrame = 0;
+	}
+
+	void DescriptorAllocator::destroy()
+	{
+		if (!device)
+			return;
+		for (Pool& pool : pools)
+			vkDestroyDescriptorPool(device, pool.pool, nullptr);
+		for (Frame& frame : frames)
+		{
+			for (Pool& pool : frame.pools)
+				vkDestroyDescriptorPool(device, pool.pool, nullptr);
+		}
+		for (Pool& pool : externalPools)
+			vkDestroyDescriptorPool(device, pool.pool, nullptr);
+		for (auto& entry : layoutCache)
+			vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+		for (VkDescriptorSetLayout layout : uncachedLayouts)
+			vkDestroyDescriptorSetLayout(device, layout, nullptr);
+
+		pools.clear();
+		setPools.clear();
+		frames.clear();
+		externalPools.clear();
+		layoutCache.clear();
+		uncachedLayouts.clear();
+		layouts.clear();
+		device = VK_NULL_HANDLE;
+	}
+
+	VkDescriptorSetLayout DescriptorAllocator::createLayout(const VkDescriptorSetLayoutCreateInfo& createInfo)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Counts counts;
+		for (uint32_t i = 0; i < createInfo.bindingCount; i++)
+		{
+			const VkDescriptorSetLayoutBinding& binding = createInfo.pBindings[i];
+			if (binding.descriptorType < descriptorTypeCount)
+				counts.count[binding.descriptorType] += binding.descriptorCount;
+		}
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if (createInfo.pNext != nullptr)
+		{
+			// չṹ޷ͨõعϣֲֲ
+			if (vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &layout) != VK_SUCCESS)
+				return VK_NULL_HANDLE;
+			uncachedLayouts.push_back(layout);
+			layouts[layout] = counts;
+			return layout;
+		}
+
+		// ־Ȼǰ󶨺ÿ󶨵ȫݣɱ
+		std::vector<const VkDescriptorSetLayoutBinding*> bindings(createInfo.bindingCount);
+		for (uint32_t i = 0; i < createInfo.bindingCount; i++)
+			bindings[i] = &createInfo.pBindings[i];
+		std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding* a, const VkDescriptorSetLayoutBinding* b) { return a->binding < b->binding; });
+		std::vector<uint64_t> key;
+		key.reserve(1 + createInfo.bindingCount * 4);
+		key.push_back(createInfo.flags);
+		for (const VkDescriptorSetLayoutBinding* binding : bindings)
+		{
+			key.push_back(((uint64_t)binding->binding << 32) | binding->descriptorType);
+			key.push_back(((uint64_t)binding->descriptorCount << 32) | binding->stageFlags);
+			key.push_back(binding->pImmutableSamplers != nullptr);
+			if (binding->pImmutableSamplers)
+			{
+				for (uint32_t i = 0; i < binding->descriptorCount; i++)
+					key.push_back(handleKey(binding->pImmutableSamplers[i]));
+			}
+		}
+
+		auto it = layoutCache.find(key);
+		if (it != layoutCache.end())
+			return it->second;
+
+		if (vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &layout) != VK_SUCCESS)
+			return VK_NULL_HANDLE;
+		layoutCache.emplace(std::move(key), layout);
+		layouts[layout] = counts;
+		return layout;
+	}
+
+	VkDescriptorSetLayout DescriptorAllocator::createLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, VkDescriptorSetLayoutCreateFlags flags)
+	{
+		VkDescriptorSetLayoutCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		createInfo.flags = flags;
+		createInfo.bindingCount = bindingCount;
+		createInfo.pBindings = bindings;
+		return createLayout(createInfo);
+	}
+
+	void DescriptorAllocator::registerLayout(VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Counts counts;
+		for (uint32_t i = 0; i < bindingCount; i++)
+		{
+			if (bindings[i].descriptorType < descriptorTypeCount)
+				counts.count[bindings[i].descriptorType] += bindings[i].descriptorCount;
+		}
+		layouts[layout] = counts;
+	}
+
+	const DescriptorAllocator::Counts& DescriptorAllocator::layoutCounts(VkDescriptorSetLayout layout) const
+	{
+		static const Counts unknown;
+		auto it = layouts.find(layout);
+		return it != layouts.end() ? it->second : unknown;
+	}
+
+	void DescriptorAllocator::recordUsage(const Counts& counts)
+	{
+		usedSets++;
+		for (uint32_t type = 0; type < descriptorTypeCount; type++)
+			usedDescriptors[type] += counts.count[type];
+	}
+
+	VkResult DescriptorAllocator::createPool(const Counts& required, bool freeable, Pool& pool)
+	{
+		pool.maxSets = setsPerPool;
+		setsPerPool = std::min(setsPerPool * 2, maxSetsPerPool);
+
+		// ͵ =   ĿǰΪֹƽÿõĸûͳʱϹ
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (uint32_t type = 0; type < descriptorTypeCount; type++)
+		{
+			uint64_t count = 0;
+			if (usedSets > 0)
+				count = (usedDescriptors[type] * pool.maxSets + usedSets - 1) / usedSets;
+			else if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+				count = pool.maxSets;
+			else if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+				count = pool.maxSets / 4;
+			// صǴηһҪŵ
+			count = std::max<uint64_t>(count, required.count[type]);
+			pool.capacity.count[type] = (uint32_t)count;
+			if (count > 0)
+				poolSizes.push_back({ (VkDescriptorType)type, (uint32_t)count });
+		}
+		if (poolSizes.empty())
+			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_SAMPLER, 1 });
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = freeable ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+		poolInfo.maxSets = pool.maxSets;
+		poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+		poolInfo.pPoolSizes = poolSizes.data();
+		return vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool.pool);
+	}
+
+	VkDescriptorPool DescriptorAllocator::createExternalPool(const VkDescriptorPoolSize* poolSizes, uint32_t poolSizeCount, uint32_t maxSets, VkDescriptorPoolCreateFlags flags)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Pool pool;
+		pool.maxSets = maxSets;
+		for (uint32_t i = 0; i < poolSizeCount; i++)
+		{
+			if (poolSizes[i].type < descriptorTypeCount)
+				pool.capacity.count[poolSizes[i].type] += poolSizes[i].descriptorCount;
+		}
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = flags;
+		poolInfo.maxSets = maxSets;
+		poolInfo.poolSizeCount = poolSizeCount;
+		poolInfo.pPoolSizes = poolSizes;
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool.pool) != VK_SUCCESS)
+			return VK_NULL_HANDLE;
+		externalPools.push_back(pool);
+		return pool.pool;
+	}
+
+	VkResult DescriptorAllocator::allocateFromPool(Pool& pool, VkDescriptorSetLayout layout, VkDescriptorSet* set)
+	{
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = pool.pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, set);
+		if (result == VK_SUCCESS)
+			pool.liveSets++;
+		return result;
+	}
+
+	static bool poolExhausted(VkResult result)
+	{
+		return result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL;
+	}
+
+	VkResult DescriptorAllocator::allocate(VkDescriptorSetLayout layout, VkDescriptorSet* set)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const Counts& counts = layoutCounts(layout);
+		recordUsage(counts);
+
+		// ԵǰأͷŹϵľɳأʱһ³
+		VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+		uint32_t index = currentPool;
+		if (index < pools.size())
+			result = allocateFromPool(pools[index], layout, set);
+		for (uint32_t i = 0; poolExhausted(result) && i < pools.size(); i++)
+		{
+			if (i == currentPool || !pools[i].freed)
+				continue;
+			result = allocateFromPool(pools[i], layout, set);
+			if (poolExhausted(result))
+				pools[i].freed = false;
+			else
+				index = i;
+		}
+		if (poolExhausted(result))
+		{
+			Pool pool;
+			result = createPool(counts, true, pool);
+			if (result != VK_SUCCESS)
+				return result;
+			pools.push_back(pool);
+			currentPool = index = (uint32_t)pools.size() - 1;
+			result = allocateFromPool(pools[index], layout, set);
+		}
+		if (result == VK_SUCCESS)
+			setPools[*set] = index;
+		return result;
+	}
+
+	void DescriptorAllocator::free(VkDescriptorSet set)
+	{
+		if (set == VK_NULL_HANDLE)
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = setPools.find(set);
+		assert(it != setPools.end() && "DescriptorAllocator::free: set was not allocated with allocate()");
+		if (it == setPools.end())
+			return;
+		Pool& pool = pools[it->second];
+		vkFreeDescriptorSets(device, pool.pool, 1, &set);
+		pool.liveSets--;
+		pool.freed = true;
+		setPools.erase(it);
+	}
+
+	void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (frameIndex >= frames.size())
+			frames.resize(frameIndex + 1);
+		currentFrame = frameIndex;
+
+		// ãһһ֡ļȫ
+		Frame& frame = frames[frameIndex];
+		for (Pool& pool : frame.pools)
+		{
+			vkResetDescriptorPool(device, pool.pool, 0);
+			pool.liveSets = 0;
+		}
+		frame.current = 0;
+		frame.sets.clear();
+	}
+
+	VkResult DescriptorAllocator::allocateFrameLocked(VkDescriptorSetLayout layout, VkDescriptorSet* set)
+	{
+		const Counts& counts = layoutCounts(layout);
+		recordUsage(counts);
+
+		Frame& frame = frames[currentFrame];
+		while (frame.current < frame.pools.size())
+		{
+			VkResult result = allocateFromPool(frame.pools[frame.current], layout, set);
+			if (!poolExhausted(result))
+				return result;
+			frame.current++;
+		}
+		Pool pool;
+		VkResult result = createPool(counts, false, pool);
+		if (result != VK_SUCCESS)
+			return result;
+		frame.pools.push_back(pool);
+		frame.current = (uint32_t)frame.pools.size() - 1;
+		return allocateFromPool(frame.pools[frame.current], layout, set);
+	}
+
+	VkResult DescriptorAllocator::allocateFrame(VkDescriptorSetLayout layout, VkDescriptorSet* set)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return allocateFrameLocked(layout, set);
+	}
+
+	VkDescriptorSet DescriptorAllocator::getFrameSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount)
+	{
+		// ֺÿдȫ
+		std::vector<uint64_t> key;
+		key.push_back(handleKey(layout));
+		for (uint32_t w = 0; w < writeCount; w++)
+		{
+			const VkWriteDescriptorSet& write = writes[w];
+			key.push_back(((uint64_t)write.dstBinding << 32) | write.dstArrayElement);
+			key.push_back(((uint64_t)write.descriptorType << 32) | write.descriptorCount);
+			for (uint32_t i = 0; i < write.descriptorCount; i++)
+			{
+				switch (write.descriptorType)
+				{
+					case VK_DESCRIPTOR_TYPE_SAMPLER:
+					case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+					case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+					case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+					case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+						key.push_back(handleKey(write.pImageInfo[i].sampler));
+						key.push_back(handleKey(write.pImageInfo[i].imageView));
+						key.push_back(write.pImageInfo[i].imageLayout);
+						break;
+					case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+					case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+						key.push_back(handleKey(write.pTexelBufferView[i]));
+						break;
+					default:
+						key.push_back(handleKey(write.pBufferInfo[i].buffer));
+						key.push_back(write.pBufferInfo[i].offset);
+						key.push_back(write.pBufferInfo[i].range);
+						break;
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		Frame& frame = frames[currentFrame];
+		auto it = frame.sets.find(key);
+		if (it != frame.sets.end())
+		{
+			frameSetCacheHits++;
+			return it->second;
+		}
+
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		if (allocateFrameLocked(layout, &set) != VK_SUCCESS)
+			return VK_NULL_HANDLE;
+		std::vector<VkWriteDescriptorSet> setWrites(writes, writes + writeCount);
+		for (VkWriteDescriptorSet& write : setWrites)
+			write.dstSet = set;
+		vkUpdateDescriptorSets(device, writeCount, setWrites.data(), 0, nullptr);
+		frame.sets.emplace(std::move(key), set);
+		return set;
+	}
+
+	DescriptorAllocator::Statistics DescriptorAllocator::getStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Statistics statistics;
+		auto addPool = [&statistics](const Pool& pool)
+		{
+			for (uint32_t type = 0; type < descriptorTypeCount; type++)
+				statistics.capacity[type] += pool.capacity.count[type];
+		};
+		statistics.persistentPools = (uint32_t)pools.size();
+		for (const Pool& pool : pools)
+		{
+			statistics.liveSets += pool.liveSets;
+			addPool(pool);
+		}
+		for (const Frame& frame : frames)
+		{
+			statistics.framePools += (uint32_t)frame.pools.size();
+			for (const Pool& pool : frame.pools)
+				addPool(pool);
+		}
+		statistics.externalPools = (uint32_t)externalPools.size();
+		for (const Pool& pool : externalPools)
+			addPool(pool);
+		statistics.cachedLayouts = (uint32_t)(layoutCache.size() + uncachedLayouts.size());
+		statistics.frameSetCacheHits = frameSetCacheHits;
+		return statistics;
+	}
+}
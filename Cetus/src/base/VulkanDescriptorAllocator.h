@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace Cetus
+{
+	// ذʽ³صĸѾ۲쵽ʹñȷ
+	// ԤΪÿ͸1000䣺
+	//   פϣӴFREE_DESCRIPTOR_SET_BITĳз䣬ͷ
+	//   ÿ֡ϣӸ֡Լĳз䣬֡ʼʱãͷţͬļͬһֻ֡һ
+	// Ҳݻ棬ͬİֻһVkDescriptorSetLayout
+	class DescriptorAllocator
+	{
+	public:
+		static constexpr uint32_t descriptorTypeCount = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;	// ĵ11
+
+		struct Statistics
+		{
+			uint32_t persistentPools = 0;
+			uint32_t framePools = 0;
+			uint32_t externalPools = 0;
+			uint32_t liveSets = 0;					// ǰڵĳפ
+			uint32_t cachedLayouts = 0;
+			uint64_t frameSetCacheHits = 0;			// ÿ֡ݻۼƴ
+			uint32_t capacity[descriptorTypeCount] = {};	// ги͵
+		};
+
+		void		init(VkDevice device);
+		void		destroy();
+
+		// ݻĲ֣ɷУdestroyʱͳһ٣pNext󶨱־Ĳֲ뻺棬ͬɷ
+		VkDescriptorSetLayout createLayout(const VkDescriptorSetLayoutCreateInfo& createInfo);
+		VkDescriptorSetLayout createLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount, VkDescriptorSetLayoutCreateFlags flags = 0);
+		// ǼⲿĲְͳʹñδǼǵĲֻ뼯
+		void		registerLayout(VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+
+		// ܽⲿ루ImGuiˣһĹ̶СĳأɷУdestroyʱͳһٲͳ
+		VkDescriptorPool createExternalPool(const VkDescriptorPoolSize* poolSizes, uint32_t poolSizeCount, uint32_t maxSets, VkDescriptorPoolCreateFlags flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+
+		VkResult	allocate(VkDescriptorSetLayout layout, VkDescriptorSet* set);
+		void		free(VkDescriptorSet set);
+
+		// ʼframeIndexÿ֡أ߱Ѿȵ֡һύ
+		void		beginFrame(uint32_t frameIndex);
+		VkResult	allocateFrame(VkDescriptorSetLayout layout, VkDescriptorSet* set);
+		// һwrites¹ÿ֡ϣͬһ֡ڲֺݶͬ󷵻ͬһϡwritesеdstSet
+		VkDescriptorSet getFrameSet(VkDescriptorSetLayout layout, const VkWriteDescriptorSet* writes, uint32_t writeCount);
+
+		Statistics	getStatistics();
+	private:
+		struct Counts
+		{
+			uint32_t count[descriptorTypeCount] = {};
+		};
+		struct Pool
+		{
+			VkDescriptorPool pool = VK_NULL_HANDLE;
+			uint32_t maxSets = 0;
+			uint32_t liveSets = 0;
+			Counts capacity;
+			bool freed = false;						// ͷŹϣпõĿռ
+		};
+		struct KeyHash
+		{
+			size_t operator()(const std::vector<uint64_t>& key) const;
+		};
+		struct Frame
+		{
+			std::vector<Pool> pools;
+			uint32_t current = 0;					// ڷĳأǰĳѾ
+			std::unordered_map<std::vector<uint64_t>, VkDescriptorSet, KeyHash> sets;
+		};
+
+		VkResult	createPool(const Counts& required, bool freeable, Pool& pool);
+		VkResult	allocateFromPool(Pool& pool, VkDescriptorSetLayout layout, VkDescriptorSet* set);
+		VkResult	allocateFrameLocked(VkDescriptorSetLayout layout, VkDescriptorSet* set);
+		const Counts& layoutCounts(VkDescriptorSetLayout layout) const;
+		void		recordUsage(const Counts& counts);
+
+		VkDevice device = VK_NULL_HANDLE;
+		std::mutex mutex;
+
+		std::vector<Pool> pools;					// פ
+		uint32_t currentPool = 0;
+		std::unordered_map<VkDescriptorSet, uint32_t> setPools;	// פڵĳ
+		std::vector<Frame> frames;
+		std::vector<Pool> externalPools;
+		uint32_t currentFrame = 0;
+
+		std::unordered_map<std::vector<uint64_t>, VkDescriptorSetLayout, KeyHash> layoutCache;
+		std::vector<VkDescriptorSetLayout> uncachedLayouts;
+		std::unordered_map<VkDescriptorSetLayout, Counts> layouts;
+
+		// ۲쵽ʹÿһۼĸ³ذ
+		uint64_t usedSets = 0;
+		uint64_t usedDescriptors[descriptorTypeCount] = {};
+		uint32_t setsPerPool = 64;					// ÿ³صļÿһطֱmaxSetsPerPool
+		uint64_t frameSetCacheHits = 0;
+	};
+}
@@ -2,7 +2,28 @@
 #include <unordered_set>
 
 namespace Cetus
-{	
+{
+	// ;ֻ࣬ڴͳ
+	static Cetus::MemoryCategory bufferMemoryCategory(VkBufferUsageFlags usageFlags)
+	{
+		if (usageFlags & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+			return Cetus::MemoryCategory::VertexIndex;
+		if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+			return Cetus::MemoryCategory::Uniform;
+		if (usageFlags == VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+			return Cetus::MemoryCategory::Staging;
+		return Cetus::MemoryCategory::Other;
+	}
+	
+
+	// dataдפӳӷ䣬һµڴдҪˢ
+	static void writeAllocation(Cetus::MemoryAllocator& allocator, const Cetus::Allocation& allocation, const void* data, VkDeviceSize size)
+	{
+		assert(allocation.mapped);
+		memcpy(allocation.mapped, data, size);
+		if ((allocator.getMemoryProperties().memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0)
+			allocator.flush(allocation, 0, size);
+	}
 
 	VulkanDevice::VulkanDevice(VkPhysicalDevice physicalDevice)
 	{
@@ -48,6 +69,9 @@ namespace Cetus
 		}
 		if (logicalDevice)
 		{
+			bindlessTable.destroy();
+			descriptorAllocator.destroy();
+			memoryAllocator.destroy();	// ڴҪ߼豸֮ǰͷ
 			vkDestroyDevice(logicalDevice, nullptr);
 		}
 	}
@@ -254,6 +278,12 @@ namespace Cetus
 			return result;
 		}
 
+		// ʼ豸ڴӷ֮Ļͼڴ涼ڴз
+		memoryAllocator.init(physicalDevice, logicalDevice);
+		descriptorAllocator.init(logicalDevice);
+		memoryBudgetSupported = std::find_if(deviceExtensions.begin(), deviceExtensions.end(),
+			[](const char* extension) { return strcmp(extension, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; }) != deviceExtensions.end();
+
 		// createCommandPoolͼζһأѽֵcommandPoolֶΣʾڷ
 		commandPool = createCommandPool(queueFamilyIndices.graphics);
 
@@ -337,6 +367,46 @@ namespace Cetus
 		return VK_SUCCESS;
 	}
 
+	VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags,
+		VkDeviceSize size, VkBuffer *buffer, Cetus::Allocation *allocation, void *data)
+	{
+		// һͬڴmemoryAllocatorӷ䣬ͷʱmemoryAllocator.free(*allocation)
+		VkBufferCreateInfo bufferCreateInfo = Cetus::initializers::bufferCreateInfo(usageFlags, size);
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, buffer));
+
+		bool deviceAddress = (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+		VK_CHECK_RESULT(memoryAllocator.allocateForBuffer(*buffer, memoryPropertyFlags, allocation, deviceAddress, bufferMemoryCategory(usageFlags)));
+
+		// ɼڴ鳣פӳ䣬ٵvkMapMemory
+		if (data != nullptr)
+			writeAllocation(memoryAllocator, *allocation, data, size);
+		return VK_SUCCESS;
+	}
+
+	VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, Cetus::MemoryUsage memoryUsage,
+		VkDeviceSize size, VkBuffer *buffer, Cetus::Allocation *allocation, void *data)
+	{
+		VkBufferCreateInfo bufferCreateInfo = Cetus::initializers::bufferCreateInfo(usageFlags, size);
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, buffer));
+
+		bool deviceAddress = (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+		VkResult result = memoryAllocator.allocateForBuffer(*buffer, memoryUsage, allocation, deviceAddress, bufferMemoryCategory(usageFlags));
+		if (result != VK_SUCCESS)
+		{
+			// ڴ治ʱߴ˻صͼ°Ʒ
+			memoryAllocator.free(*allocation);
+			vkDestroyBuffer(logicalDevice, *buffer, nullptr);
+			*buffer = VK_NULL_HANDLE;
+			return result;
+		}
+
+		if (data != nullptr)
+			writeAllocation(memoryAllocator, *allocation, data, size);
+		return VK_SUCCESS;
+	}
+
 	VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, Cetus::Buffer *buffer, VkDeviceSize size, void *data)
 	{
 		// û豸Ϊ߼豸 buffer->device = logicalDevice;
@@ -346,19 +416,13 @@ namespace Cetus
 		VkBufferCreateInfo bufferCreateInfo = Cetus::initializers::bufferCreateInfo(usageFlags, size);	//ϸȱһйģʽ
 		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, &buffer->buffer));
 
-		// ڴ
-		VkMemoryAllocateInfo memAlloc = Cetus::initializers::memoryAllocateInfo();
+		// ӷ仺ڴ棬ֻ䲻󶨣buffer->bind
 		VkMemoryRequirements memReqs;
 		vkGetBufferMemoryRequirements(logicalDevice, buffer->buffer, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-		VkMemoryAllocateFlagsInfoKHR allocFlagsInfo{};
-		if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
-			allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
-			allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
-			memAlloc.pNext = &allocFlagsInfo;
-		}
-		VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAlloc, nullptr, &buffer->memory));
+		bool deviceAddress = (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+		VK_CHECK_RESULT(memoryAllocator.allocate(memReqs, memoryPropertyFlags, Cetus::AllocationKind::Linear, &buffer->allocation, deviceAddress, bufferMemoryCategory(usageFlags)));
+		buffer->allocator = &memoryAllocator;
+		buffer->memory = buffer->allocation.memory;
 
 		buffer->alignment = memReqs.alignment;				// ĶΪڴṹĶ
 		buffer->size = size;								// ĴСΪĲsize
@@ -380,6 +444,32 @@ namespace Cetus
 		return buffer->bind();								// buffer->bindڴ󶨵󣬲ذ󶨽
 	}
 
+	VkResult VulkanDevice::createBuffer(VkBufferUsageFlags usageFlags, Cetus::MemoryUsage memoryUsage, Cetus::Buffer *buffer, VkDeviceSize size, void *data)
+	{
+		buffer->device = logicalDevice;
+
+		VkBufferCreateInfo bufferCreateInfo = Cetus::initializers::bufferCreateInfo(usageFlags, size);
+		VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, &buffer->buffer));
+
+		VkMemoryRequirements memReqs;
+		vkGetBufferMemoryRequirements(logicalDevice, buffer->buffer, &memReqs);
+		bool deviceAddress = (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0;
+		VK_CHECK_RESULT(memoryAllocator.allocate(memReqs, memoryUsage, Cetus::AllocationKind::Linear, &buffer->allocation, deviceAddress, bufferMemoryCategory(usageFlags)));
+		buffer->allocator = &memoryAllocator;
+		buffer->memory = buffer->allocation.memory;
+
+		buffer->alignment = memReqs.alignment;
+		buffer->size = size;
+		buffer->usageFlags = usageFlags;
+		buffer->memoryPropertyFlags = memoryProperties.memoryTypes[buffer->allocation.memoryType].propertyFlags;	// ʵѡеڴ͵
+
+		if (data != nullptr)
+			writeAllocation(memoryAllocator, buffer->allocation, data, size);
+
+		buffer->setupDescriptor();
+		return buffer->bind();
+	}
+
 	void VulkanDevice::copyBuffer(Cetus::Buffer *src, Cetus::Buffer *dst, VkQueue queue, VkBufferCopy *copyRegion)
 	{	// һĸ
 		// srcһָԴָ룬
@@ -495,6 +585,53 @@ namespace Cetus
 		return (std::find(supportedExtensions.begin(), supportedExtensions.end(), extension) != supportedExtensions.end());
 	}
 
+	std::vector<VulkanDevice::MemoryHeapBudget> VulkanDevice::getMemoryBudget()
+	{
+		std::vector<MemoryHeapBudget> heaps(memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			heaps[i].size = memoryProperties.memoryHeaps[i].size;
+			heaps[i].flags = memoryProperties.memoryHeaps[i].flags;
+		}
+
+		if (memoryBudgetSupported && getPhysicalDeviceMemoryProperties2)
+		{
+			// Ԥ̵ռñ仯ÿζ²ѯ
+			VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+			budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+			VkPhysicalDeviceMemoryProperties2KHR properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+			properties2.pNext = &budgetProperties;
+			getPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+			for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+			{
+				heaps[i].budget = budgetProperties.heapBudget[i];
+				heaps[i].usage = budgetProperties.heapUsage[i];
+			}
+		}
+		else
+		{
+			// ûչʱ÷ԼͳƣԤ㰴ѴС80%ƣ̣
+			Cetus::MemoryAllocator::Statistics statistics = memoryAllocator.getStatistics();
+			for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+			{
+				heaps[i].budget = heaps[i].size / 10 * 8;
+				heaps[i].usage = statistics.heapBytes[i];
+			}
+		}
+		return heaps;
+	}
+
+	VkDeviceSize VulkanDevice::getMemoryHeadroom(VkMemoryPropertyFlags properties)
+	{
+		// propertiesĵһڴڵĶѻʣԤ㣬ʽϴݴԾݴþԴ֮ǰ
+		uint32_t memoryType = memoryAllocator.getMemoryType(~0u, properties);
+		if (memoryType == UINT32_MAX)
+			return 0;
+		MemoryHeapBudget heap = getMemoryBudget()[memoryProperties.memoryTypes[memoryType].heapIndex];
+		return heap.budget > heap.usage ? heap.budget - heap.usage : 0;
+	}
+
 	VkFormat VulkanDevice::getSupportedDepthFormat(bool checkSamplingSupport)
 	{
 		// һһ
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "VulkanBuffer.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanBindlessTable.h"
 #include "VulkanTools.h"
 #include "vulkan/vulkan.h"
 #include <algorithm>
 #include <assert.h>
 #include <exception>
+#include <functional>
 
 namespace Cetus
 {
@@ -22,6 +26,25 @@ struct VulkanDevice
 
 	std::vector<std::string> supportedExtensions;
 	VkCommandPool commandPool = VK_NULL_HANDLE;
+	Cetus::MemoryAllocator memoryAllocator;	// 塢ͼ豸ڴ涼ӷ
+	Cetus::DescriptorAllocator descriptorAllocator;	// Ͳֶ䣬ذ
+	Cetus::BindlessTable bindlessTable;	// ްԺbindlessTable.create򱣳δ
+
+	// VK_EXT_memory_budgetչʱenabledExtensionsʵvkGetPhysicalDeviceMemoryProperties2KHR
+	bool memoryBudgetSupported = false;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getPhysicalDeviceMemoryProperties2 = nullptr;
+	// VK_KHR_draw_indirect_countչvkGetDeviceProcAddrãΪʱGPU޳ѹ
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+	// ӳͷţ֡ʱߵĴߣApplicationãѺŽͷŶУGPUִ굱ǰ֡ύŵã
+	// ΪʱdeferFreeãҪԼ֤豸ѾʹԴѾȴ豸У
+	std::function<void(std::function<void()>&&)> submitResourceFree;
+	struct MemoryHeapBudget
+	{
+		VkDeviceSize size = 0;
+		VkDeviceSize budget = 0;	// ϻõٶ½ʧ
+		VkDeviceSize usage = 0;		// ̵ǰϵͽķ䣩
+		VkMemoryHeapFlags flags = 0;
+	};
 	struct
 	{
 		uint32_t graphics;
@@ -35,10 +58,18 @@ struct VulkanDevice
 	explicit VulkanDevice(VkPhysicalDevice physicalDevice);
 	~VulkanDevice();
 	uint32_t        getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties, VkBool32 *memTypeFound = nullptr) const;
+	uint32_t        getMemoryType(uint32_t typeBits, Cetus::MemoryUsage usage) const { return memoryAllocator.getMemoryType(typeBits, usage); }
+	void            deferFree(std::function<void()> func) { if (submitResourceFree) submitResourceFree(std::move(func)); else func(); }
+	bool            directUploadSupported() const { return memoryAllocator.directUploadSupported(); }
 	uint32_t        getQueueFamilyIndex(VkQueueFlags queueFlags) const;
 	VkResult        createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatures, std::vector<const char *> enabledExtensions, void *pNextChain, bool useSwapChain = true, VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
 	VkResult        createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, void *data = nullptr);
+	VkResult        createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, Cetus::Allocation *allocation, void *data = nullptr);
 	VkResult        createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, Cetus::Buffer *buffer, VkDeviceSize size, void *data = nullptr);
+	// ʹͼѡڴ͵İ汾GpuOnly֮ͼ֤ɼֱӴdata
+	// һ汾ڴ治ʱشѴĻ壬߿Իһַʽ
+	VkResult        createBuffer(VkBufferUsageFlags usageFlags, Cetus::MemoryUsage memoryUsage, VkDeviceSize size, VkBuffer *buffer, Cetus::Allocation *allocation, void *data = nullptr);
+	VkResult        createBuffer(VkBufferUsageFlags usageFlags, Cetus::MemoryUsage memoryUsage, Cetus::Buffer *buffer, VkDeviceSize size, void *data = nullptr);
 	void            copyBuffer(Cetus::Buffer *src, Cetus::Buffer *dst, VkQueue queue, VkBufferCopy *copyRegion = nullptr);
 	VkCommandPool   createCommandPool(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags createFlags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 	VkCommandBuffer createCommandBuffer(VkCommandBufferLevel level, VkCommandPool pool, bool begin = false);
@@ -46,6 +77,9 @@ struct VulkanDevice
 	void            flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, VkCommandPool pool, bool free = true);
 	void            flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free = true);
 	bool            extensionSupported(std::string extension);
+	std::vector<MemoryHeapBudget> getMemoryBudget();
+	VkDeviceSize    getMemoryHeadroom(VkMemoryPropertyFlags properties);
+	Cetus::MemoryAllocator::Statistics getMemoryStatistics() { return memoryAllocator.getStatistics(); }
 	VkFormat        getSupportedDepthFormat(bool checkSamplingSupport);
 };
 }      
@@ -0,0 +1,343 @@
+#include "VulkanDrawCuller.h"
+
+#include "VulkanDevice.h"
+#include "VulkanInitializers.hpp"
+#include "frustum.hpp"
+
+namespace Cetus
+{
+	namespace
+	{
+		struct PyramidPushConstants
+		{
+			int32_t inputWidth;
+			int32_t inputHeight;
+			int32_t outputWidth;
+			int32_t outputHeight;
+		};
+
+		uint32_t previousPow2(uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result * 2 <= value)
+				result *= 2;
+			return result;
+		}
+	}
+
+	VkResult DrawCuller::create(VulkanDevice* device, const std::string& shadersPath, uint32_t framesInFlight, VkPipelineCache pipelineCache)
+	{
+		this->device = device;
+		this->pipelineCache = pipelineCache;
+		compact = device->cmdDrawIndexedIndirectCount != nullptr;
+
+		VkSamplerCreateInfo samplerInfo = initializers::samplerCreateInfo();
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		VkResult result = vkCreateSampler(device->logicalDevice, &samplerInfo, nullptr, &sampler);
+		if (result != VK_SUCCESS)
+			return result;
+
+		// binding 0һ㣨ͼbinding 1Ҫдһ
+		VkDescriptorSetLayoutBinding pyramidBindings[] = {
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		};
+		pyramidSetLayout = device->descriptorAllocator.createLayout(pyramidBindings, 2);
+		VkPushConstantRange pushConstantRange = initializers::pushConstantRange(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(PyramidPushConstants), 0);
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo = initializers::pipelineLayoutCreateInfo(&pyramidSetLayout, 1);
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		result = vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutInfo, nullptr, &pyramidPipelineLayout);
+		if (result != VK_SUCCESS)
+			return result;
+
+		// ޳0Դ 1ÿƵ 2һ» 3Χ 4 5 6Ƚ 7
+		VkDescriptorSetLayoutBinding cullBindings[] = {
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 5),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 6),
+			initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT, 7),
+		};
+		cullSetLayout = device->descriptorAllocator.createLayout(cullBindings, 8);
+		pipelineLayoutInfo = initializers::pipelineLayoutCreateInfo(&cullSetLayout, 1);
+		result = vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutInfo, nullptr, &cullPipelineLayout);
+		if (result != VK_SUCCESS)
+			return result;
+
+		result = createComputePipeline(shadersPath + "depthpyramid.comp.spv", pyramidPipelineLayout, &pyramidPipeline);
+		if (result != VK_SUCCESS)
+			return result;
+		result = createComputePipeline(shadersPath + "cull.comp.spv", cullPipelineLayout, &cullPipeline);
+		if (result != VK_SUCCESS)
+			return result;
+
+		// ÿ֡maxCullsPerFrame޳Ĳÿη䶼̬ƫƵĶȡ
+		VkDeviceSize paramsAlignment = std::max<VkDeviceSize>(device->properties.limits.minUniformBufferOffsetAlignment, 1);
+		VkDeviceSize paramsSize = (sizeof(CullParams) + paramsAlignment - 1) / paramsAlignment * paramsAlignment;
+		result = params.create(device, maxCullsPerFrame * paramsSize, framesInFlight);
+		if (result != VK_SUCCESS)
+			return result;
+
+		// Ƚһ1x1Ľ֤ЧĴСresizeDepthPyramid
+		return resizeDepthPyramid(1, 1);
+	}
+
+	void DrawCuller::destroy()
+	{
+		if (!device)
+			return;
+		VkDevice logicalDevice = device->logicalDevice;
+		destroyDepthPyramid();
+		params.destroy();
+		vkDestroyPipeline(logicalDevice, cullPipeline, nullptr);
+		vkDestroyPipeline(logicalDevice, pyramidPipeline, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, cullPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(logicalDevice, pyramidPipelineLayout, nullptr);
+		vkDestroySampler(logicalDevice, sampler, nullptr);
+		// Ļ
+		cullPipeline = pyramidPipeline = VK_NULL_HANDLE;
+		cullPipelineLayout = pyramidPipelineLayout = VK_NULL_HANDLE;
+		cullSetLayout = pyramidSetLayout = VK_NULL_HANDLE;
+		sampler = VK_NULL_HANDLE;
+		device = nullptr;
+	}
+
+	VkResult DrawCuller::createComputePipeline(const std::string& fileName, VkPipelineLayout layout, VkPipeline* pipeline)
+	{
+		VkPipelineShaderStageCreateInfo stage{};
+		stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		stage.module = tools::loadShader(fileName, device->logicalDevice);
+		stage.pName = "main";
+		if (stage.module == VK_NULL_HANDLE)
+			return VK_ERROR_INITIALIZATION_FAILED;
+
+		VkComputePipelineCreateInfo pipelineInfo = initializers::computePipelineCreateInfo(layout, 0);
+		pipelineInfo.stage = stage;
+		VkResult result = vkCreateComputePipelines(device->logicalDevice, pipelineCache, 1, &pipelineInfo, nullptr, pipeline);
+		vkDestroyShaderModule(device->logicalDevice, stage.module, nullptr);
+		return result;
+	}
+
+	void DrawCuller::beginFrame(uint32_t frameIndex)
+	{
+		params.beginFrame(frameIndex);
+		frameCullCount = 0;
+	}
+
+	VkResult DrawCuller::resizeDepthPyramid(uint32_t depthWidth, uint32_t depthHeight)
+	{
+		uint32_t width = previousPow2(std::max(depthWidth, 1u));
+		uint32_t height = previousPow2(std::max(depthHeight, 1u));
+		if (pyramid.image != VK_NULL_HANDLE && pyramid.width == width && pyramid.height == height)
+		{
+			pyramid.depthWidth = std::max(depthWidth, 1u);
+			pyramid.depthHeight = std::max(depthHeight, 1u);
+			return VK_SUCCESS;
+		}
+		destroyDepthPyramid();
+
+		pyramid.depthWidth = std::max(depthWidth, 1u);
+		pyramid.depthHeight = std::max(depthHeight, 1u);
+		pyramid.width = width;
+		pyramid.height = height;
+		pyramid.levels = 1;
+		while ((std::max(width, height) >> pyramid.levels) > 0)
+			pyramid.levels++;
+
+		VkImageCreateInfo imageInfo = initializers::imageCreateInfo();
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.extent = { width, height, 1 };
+		imageInfo.mipLevels = pyramid.levels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkResult result = vkCreateImage(device->logicalDevice, &imageInfo, nullptr, &pyramid.image);
+		if (result != VK_SUCCESS)
+			return result;
+		result = device->memoryAllocator.allocateForImage(pyramid.image, MemoryUsage::GpuOnly, &pyramid.allocation);
+		if (result != VK_SUCCESS)
+			return result;
+
+		VkImageViewCreateInfo viewInfo = initializers::imageViewCreateInfo();
+		viewInfo.image = pyramid.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid.levels, 0, 1 };
+		result = vkCreateImageView(device->logicalDevice, &viewInfo, nullptr, &pyramid.view);
+		if (result != VK_SUCCESS)
+			return result;
+		pyramid.levelViews.resize(pyramid.levels, VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < pyramid.levels; i++)
+		{
+			viewInfo.subresourceRange.baseMipLevel = i;
+			viewInfo.subresourceRange.levelCount = 1;
+			result = vkCreateImageView(device->logicalDevice, &viewInfo, nullptr, &pyramid.levelViews[i]);
+			if (result != VK_SUCCESS)
+				return result;
+		}
+
+		// 1ǽԼĲ㣬̶0ⲿͼÿ֡getFrameSet
+		pyramid.levelSets.resize(pyramid.levels, VK_NULL_HANDLE);
+		for (uint32_t i = 1; i < pyramid.levels; i++)
+		{
+			result = device->descriptorAllocator.allocate(pyramidSetLayout, &pyramid.levelSets[i]);
+			if (result != VK_SUCCESS)
+				return result;
+			VkDescriptorImageInfo input = { sampler, pyramid.levelViews[i - 1], VK_IMAGE_LAYOUT_GENERAL };
+			VkDescriptorImageInfo output = { VK_NULL_HANDLE, pyramid.levelViews[i], VK_IMAGE_LAYOUT_GENERAL };
+			VkWriteDescriptorSet writes[] = {
+				initializers::writeDescriptorSet(pyramid.levelSets[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &input),
+				initializers::writeDescriptorSet(pyramid.levelSets[i], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &output),
+			};
+			vkUpdateDescriptorSets(device->logicalDevice, 2, writes, 0, nullptr);
+		}
+
+		// ʼմGENERAL֣Ϊ洢ͼдҲΪͼ
+		VkCommandBuffer commandBuffer = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid.levels, 0, 1 };
+		tools::setImageLayout(commandBuffer, pyramid.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, range,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		VkQueue queue;
+		vkGetDeviceQueue(device->logicalDevice, device->queueFamilyIndices.graphics, 0, &queue);
+		device->flushCommandBuffer(commandBuffer, queue, true);
+		pyramid.valid = false;
+		return VK_SUCCESS;
+	}
+
+	void DrawCuller::destroyDepthPyramid()
+	{
+		VkDevice logicalDevice = device->logicalDevice;
+		for (VkDescriptorSet set : pyramid.levelSets)
+			if (set != VK_NULL_HANDLE)
+				device->descriptorAllocator.free(set);
+		for (VkImageView view : pyramid.levelViews)
+			vkDestroyImageView(logicalDevice, view, nullptr);
+		vkDestroyImageView(logicalDevice, pyramid.view, nullptr);
+		vkDestroyImage(logicalDevice, pyramid.image, nullptr);
+		device->memoryAllocator.free(pyramid.allocation);
+		pyramid = DepthPyramid();
+	}
+
+	void DrawCuller::buildDepthPyramid(VkCommandBuffer commandBuffer, VkImageView depthView, VkImageLayout depthLayout, const glm::mat4& viewProjection)
+	{
+		// һ޳ڶ
+		VkMemoryBarrier barrier = initializers::memoryBarrier();
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipeline);
+
+		uint32_t inputWidth = 0, inputHeight = 0;
+		for (uint32_t i = 0; i < pyramid.levels; i++)
+		{
+			VkDescriptorSet set = pyramid.levelSets[i];
+			if (i == 0)
+			{
+				VkDescriptorImageInfo input = { sampler, depthView, depthLayout };
+				VkDescriptorImageInfo output = { VK_NULL_HANDLE, pyramid.levelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+				VkWriteDescriptorSet writes[] = {
+					initializers::writeDescriptorSet(VK_NULL_HANDLE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &input),
+					initializers::writeDescriptorSet(VK_NULL_HANDLE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, &output),
+				};
+				set = device->descriptorAllocator.getFrameSet(pyramidSetLayout, writes, 2);
+				inputWidth = pyramid.depthWidth;
+				inputHeight = pyramid.depthHeight;
+			}
+			uint32_t outputWidth = std::max(pyramid.width >> i, 1u);
+			uint32_t outputHeight = std::max(pyramid.height >> i, 1u);
+			PyramidPushConstants constants = { (int32_t)inputWidth, (int32_t)inputHeight, (int32_t)outputWidth, (int32_t)outputHeight };
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pyramidPipelineLayout, 0, 1, &set, 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(commandBuffer, (outputWidth + 7) / 8, (outputHeight + 7) / 8, 1);
+
+			// һһ㣬޳
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			inputWidth = outputWidth;
+			inputHeight = outputHeight;
+		}
+		pyramid.viewProjection = viewProjection;
+		pyramid.valid = true;
+	}
+
+	bool DrawCuller::cull(VkCommandBuffer commandBuffer, const DrawSet& drawSet, const glm::mat4& viewProjection, uint32_t flags)
+	{
+		if (drawSet.drawCount == 0)
+			return true;
+		if (frameCullCount == maxCullsPerFrame)	// һ֡Ĳ
+			return false;
+		frameCullCount++;
+
+		CullParams cullParams{};
+		Frustum frustum;
+		frustum.update(viewProjection);
+		for (uint32_t i = 0; i < 6; i++)
+			cullParams.frustumPlanes[i] = frustum.planes[i];
+		cullParams.occlusionViewProjection = pyramid.viewProjection;
+		cullParams.pyramidSize = glm::vec2((float)pyramid.width, (float)pyramid.height);
+		cullParams.drawCount = drawSet.drawCount;
+		cullParams.flags = flags & (FrustumCulling | OcclusionCulling);
+		if (!pyramid.valid)
+			cullParams.flags &= ~OcclusionCulling;
+		if (compact)
+			cullParams.flags |= 0x4;			// ɫCOMPACT
+		cullParams.bucketFirst = glm::uvec4(drawSet.bucketFirst[0], drawSet.bucketFirst[1], drawSet.bucketFirst[2], 0);
+		UniformAllocation allocation = params.push(cullParams);
+		params.flush();
+
+		VkDescriptorBufferInfo bufferInfos[] = {
+			{ drawSet.commands, 0, VK_WHOLE_SIZE },
+			{ drawSet.drawData, 0, VK_WHOLE_SIZE },
+			{ drawSet.uniforms, 0, VK_WHOLE_SIZE },
+			{ drawSet.bounds, 0, VK_WHOLE_SIZE },
+			{ drawSet.culledCommands, 0, VK_WHOLE_SIZE },
+			{ drawSet.counts, 0, VK_WHOLE_SIZE },
+		};
+		VkDescriptorImageInfo pyramidInfo = { sampler, pyramid.view, VK_IMAGE_LAYOUT_GENERAL };
+		VkDescriptorBufferInfo paramsInfo = params.descriptor(sizeof(CullParams));
+		VkWriteDescriptorSet writes[8];
+		for (uint32_t i = 0; i < 6; i++)
+			writes[i] = initializers::writeDescriptorSet(VK_NULL_HANDLE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, i, &bufferInfos[i]);
+		writes[6] = initializers::writeDescriptorSet(VK_NULL_HANDLE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6, &pyramidInfo);
+		writes[7] = initializers::writeDescriptorSet(VK_NULL_HANDLE, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 7, &paramsInfo);
+		VkDescriptorSet set = device->descriptorAllocator.getFrameSet(cullSetLayout, writes, 8);
+
+		// һεļӻƻڶͼ
+		VkMemoryBarrier barrier = initializers::memoryBarrier();
+		barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		if (compact)
+		{
+			vkCmdFillBuffer(commandBuffer, drawSet.counts, 0, bucketCount * sizeof(uint32_t), 0);
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &set, 1, &allocation.offset);
+		vkCmdDispatch(commandBuffer, (drawSet.drawCount + 63) / 64, 1, 1);
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		return true;
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUniformAllocator.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace Cetus
+{
+	struct VulkanDevice;
+
+	// GPU޳ɫÿƵռΧ׶ԣһ֡ȽĲ㼶Zڵԣ
+	// ɼĻԭӼѹvkCmdDrawIndexedIndirectCountơ
+	// 豸ּ֧Ӽʱѹ޳instanceCountд0ԭӻ
+	class DrawCuller
+	{
+	public:
+		enum Flags
+		{
+			FrustumCulling = 0x1,
+			OcclusionCulling = 0x2,			// ȽûʱԶ
+		};
+
+		static constexpr uint32_t bucketCount = 3;
+		static constexpr uint32_t maxCullsPerFrame = 64;	// ÿ֡εcullټ¼
+
+		// һҪ޳ĻƣvkglTF::Model::IndirectDrawsһ£
+		//   commands		ÿһVkDrawIndexedIndirectCommandͰ
+		//   drawData		ÿƵuniformOffsetһ¿uniformsеƫƣvec4ƣ±Ͱ±
+		//   uniforms		һ»壬ÿһ¿鿪ͷ
+		//   bounds		ÿƵľֲռΧxyzģw뾶
+		//   culledCommands	СcommandsͬѹʱÿͰbucketFirstʼд
+		//   counts		ÿͰĿɼbucketCountuint32
+		struct DrawSet
+		{
+			VkBuffer commands = VK_NULL_HANDLE;
+			VkBuffer drawData = VK_NULL_HANDLE;
+			VkBuffer uniforms = VK_NULL_HANDLE;
+			VkBuffer bounds = VK_NULL_HANDLE;
+			VkBuffer culledCommands = VK_NULL_HANDLE;
+			VkBuffer counts = VK_NULL_HANDLE;
+			uint32_t drawCount = 0;
+			uint32_t bucketFirst[bucketCount] = {};
+		};
+
+		// shadersPathҪcull.comp.spvdepthpyramid.comp.spvframesInFlightֳɼ
+		VkResult	create(VulkanDevice* device, const std::string& shadersPath, uint32_t framesInFlight, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+		void		destroy();
+
+		// ʼframeIndexĲ䣻߱Ѿȵһ֡һύ
+		void		beginFrame(uint32_t frameIndex);
+
+		// ȻС仯ʱã߳ȡȻ2ݣ֤߱ʹ
+		VkResult	resizeDepthPyramid(uint32_t depthWidth, uint32_t depthHeight);
+		// ͼֻȷͼdepthLayoutдѾɣȡֵ
+		// viewProjectionȾͼʱľ֮ڵѰΧͶӰ
+		void		buildDepthPyramid(VkCommandBuffer commandBuffer, VkImageView depthView, VkImageLayout depthLayout, const glm::mat4& viewProjection);
+
+		// ¼޳֮drawSetculledCommandscountsڼӻƣѾ¼
+		// һ֡Ѿ޳maxCullsPerFrameʱʲôҲ¼false߸Ϊδ޳Դ
+		bool		cull(VkCommandBuffer commandBuffer, const DrawSet& drawSet, const glm::mat4& viewProjection, uint32_t flags = FrustumCulling | OcclusionCulling);
+
+		bool		compacting() const { return compact; }
+		VkImageView	getDepthPyramidView() const { return pyramid.view; }
+	private:
+		struct CullParams
+		{
+			glm::vec4 frustumPlanes[6];
+			glm::mat4 occlusionViewProjection;
+			glm::vec2 pyramidSize;
+			uint32_t drawCount;
+			uint32_t flags;
+			glm::uvec4 bucketFirst;
+		};
+		struct DepthPyramid
+		{
+			VkImage image = VK_NULL_HANDLE;
+			Allocation allocation;
+			VkImageView view = VK_NULL_HANDLE;		// ȫ㼶޳ʱ
+			std::vector<VkImageView> levelViews;		// ÿһһͼʱΪ洢ͼд
+			std::vector<VkDescriptorSet> levelSets;	// i㣨i >= 1ӵi - 1Լ
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t levels = 0;
+			uint32_t depthWidth = 0;					// 0ԼС
+			uint32_t depthHeight = 0;
+			bool valid = false;						// Ѿͼ
+			glm::mat4 viewProjection = glm::mat4(1.0f);
+		};
+
+		void		destroyDepthPyramid();
+		VkResult	createComputePipeline(const std::string& fileName, VkPipelineLayout layout, VkPipeline* pipeline);
+
+		VulkanDevice* device = nullptr;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		bool compact = false;						// 豸ּ֧Ӽ
+
+		VkSampler sampler = VK_NULL_HANDLE;			// Եض
+		VkDescriptorSetLayout pyramidSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout pyramidPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pyramidPipeline = VK_NULL_HANDLE;
+		VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline cullPipeline = VK_NULL_HANDLE;
+
+		UniformAllocator params;
+		uint32_t frameCullCount = 0;				// һ֡Ѿ¼޳maxCullsPerFrame
+		DepthPyramid pyramid;
+	};
+}
@@ -0,0 +1,492 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Cetus
+{
+	static constexpr uint32_t poolKinds = 3;	// ԡƽ̡豸ַ
+
+	const char* memoryCategoryName(MemoryCategory category)
+	{
+		switch (category)
+		{
+			case MemoryCategory::Image:			return "Images";
+			case MemoryCategory::VertexIndex:	return "Vertex/Index buffers";
+			case MemoryCategory::Uniform:		return "Uniform buffers";
+			case MemoryCategory::Staging:		return "Staging";
+			default:							return "Other";
+		}
+	}
+
+	MemoryAllocator::~MemoryAllocator()
+	{
+		destroy();
+	}
+
+	void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize)
+	{
+		this->device = device;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+		// Сȡ2ݣ㷨һֱ԰з
+		this->preferredBlockSize = minNodeSize;
+		while (this->preferredBlockSize < preferredBlockSize)
+			this->preferredBlockSize *= 2;
+
+		rankMemoryTypes();
+
+		pools.clear();
+		pools.resize(memoryProperties.memoryTypeCount * poolKinds);
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+		{
+			// СĶѣ256MBBARڴ棩СһЩĿ飬һ鲻ѵ1/8
+			VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[type].heapIndex].size;
+			VkDeviceSize blockSize = this->preferredBlockSize;
+			while (blockSize > minNodeSize * 1024 && blockSize > heapSize / 8)
+				blockSize /= 2;
+			uint32_t maxOrder = 0;
+			while ((minNodeSize << maxOrder) < blockSize)
+				maxOrder++;
+
+			for (uint32_t kind = 0; kind < poolKinds; kind++)
+			{
+				Pool& pool = pools[type * poolKinds + kind];
+				pool.memoryType = type;
+				pool.deviceAddress = kind == 2;
+				pool.blockSize = blockSize;
+				pool.maxOrder = maxOrder;
+			}
+		}
+	}
+
+	void MemoryAllocator::destroy()
+	{
+		if (!device)
+			return;
+		for (Pool& pool : pools)
+		{
+			for (std::unique_ptr<Block>& block : pool.blocks)
+			{
+				if (!block)
+					continue;
+				assert(block->allocationCount == 0 && "MemoryAllocator destroyed with live allocations");
+				vkFreeMemory(device, block->memory, nullptr);
+				trackMemory(pool.memoryType, -(int64_t)pool.blockSize);
+			}
+		}
+		pools.clear();
+		device = VK_NULL_HANDLE;
+	}
+
+	uint32_t MemoryAllocator::getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+				return i;
+		}
+		return UINT32_MAX;
+	}
+
+	void MemoryAllocator::rankMemoryTypes()
+	{
+		struct Intent
+		{
+			VkMemoryPropertyFlags required;		// Ͳ
+			VkMemoryPropertyFlags strong;		// ÿһ2
+			VkMemoryPropertyFlags preferred;	// ÿһ1
+			VkMemoryPropertyFlags avoided;		// ÿһ1
+		};
+		const VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		const VkMemoryPropertyFlags hostCoherent = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		const VkMemoryPropertyFlags hostCached = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		const VkMemoryPropertyFlags unusable = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT | VK_MEMORY_PROPERTY_PROTECTED_BIT;
+		const Intent intents[(size_t)MemoryUsage::Count] = {
+			{ 0,			deviceLocal,	0,				hostVisible },				// GpuOnlyûDEVICE_LOCALʱ˻
+			{ hostVisible,	hostCoherent,	0,				deviceLocal | hostCached },	// Upload
+			{ hostVisible,	hostCached,		hostCoherent,	0 },						// Readback
+			{ hostVisible,	deviceLocal,	hostCoherent,	hostCached },				// Dynamic
+		};
+		auto popcount = [](VkMemoryPropertyFlags flags) { int count = 0; for (; flags; flags &= flags - 1) count++; return count; };
+
+		for (uint32_t usage = 0; usage < (uint32_t)MemoryUsage::Count; usage++)
+		{
+			const Intent& intent = intents[usage];
+			std::vector<std::pair<int, uint32_t>> candidates;
+			for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+			{
+				VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[type].propertyFlags;
+				if ((flags & intent.required) != intent.required || (flags & unusable))
+					continue;
+				int score = 2 * popcount(flags & intent.strong) + popcount(flags & intent.preferred) - popcount(flags & intent.avoided);
+				candidates.push_back({ -score, type });
+			}
+			std::stable_sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+			memoryTypeRanking[usage].clear();
+			for (const auto& candidate : candidates)
+				memoryTypeRanking[usage].push_back(candidate.second);
+		}
+
+		// 256MBµBAR̫Сֻÿ֡µС壬ֱϴ̬
+		directUpload = false;
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+		{
+			VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[type].propertyFlags;
+			VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[type].heapIndex].size;
+			if ((flags & (deviceLocal | hostVisible)) == (deviceLocal | hostVisible) && heapSize > 256ull * 1024 * 1024)
+				directUpload = true;
+		}
+	}
+
+	uint32_t MemoryAllocator::getMemoryType(uint32_t typeBits, MemoryUsage usage) const
+	{
+		for (uint32_t type : memoryTypeRanking[(size_t)usage])
+		{
+			if (typeBits & (1u << type))
+				return type;
+		}
+		return UINT32_MAX;
+	}
+
+	bool MemoryAllocator::isHostVisible(uint32_t memoryType) const
+	{
+		return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+	}
+
+	uint32_t MemoryAllocator::poolIndex(uint32_t memoryType, AllocationKind kind, bool deviceAddress) const
+	{
+		uint32_t kindIndex = kind == AllocationKind::Optimal ? 1 : (deviceAddress ? 2 : 0);
+		return memoryType * poolKinds + kindIndex;
+	}
+
+	VkResult MemoryAllocator::allocateMemory(uint32_t memoryType, VkDeviceSize size, bool deviceAddress, VkDeviceMemory* memory, void** mapped)
+	{
+		VkMemoryAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.allocationSize = size;
+		allocateInfo.memoryTypeIndex = memoryType;
+		VkMemoryAllocateFlagsInfoKHR allocateFlagsInfo{};
+		if (deviceAddress)
+		{
+			allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO_KHR;
+			allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+			allocateInfo.pNext = &allocateFlagsInfo;
+		}
+		VkResult result = vkAllocateMemory(device, &allocateInfo, nullptr, memory);
+		if (result != VK_SUCCESS)
+			return result;
+		trackMemory(memoryType, (int64_t)size);
+
+		*mapped = nullptr;
+		if (isHostVisible(memoryType))
+		{
+			// һڴͬʱֻӳһΣ鳣פӳ䣬ӷֱʹƫƺָ
+			result = vkMapMemory(device, *memory, 0, VK_WHOLE_SIZE, 0, mapped);
+			if (result != VK_SUCCESS)
+			{
+				vkFreeMemory(device, *memory, nullptr);
+				trackMemory(memoryType, -(int64_t)size);
+				*memory = VK_NULL_HANDLE;
+			}
+		}
+		return result;
+	}
+
+	VkResult MemoryAllocator::allocateDedicated(uint32_t memoryType, VkDeviceSize size, bool deviceAddress, MemoryCategory category, Allocation* allocation)
+	{
+		size = (size + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize;
+		VkResult result = allocateMemory(memoryType, size, deviceAddress, &allocation->memory, &allocation->mapped);
+		if (result != VK_SUCCESS)
+			return result;
+		allocation->offset = 0;
+		allocation->size = size;
+		allocation->memoryType = memoryType;
+		allocation->pool = UINT32_MAX;
+		allocation->category = category;
+		dedicatedCount++;
+		dedicatedBytes += size;
+		trackAllocation(category, (int64_t)size);
+		return VK_SUCCESS;
+	}
+
+	bool MemoryAllocator::allocateFromBlock(Pool& pool, Block& block, uint32_t order, VkDeviceSize* offset)
+	{
+		// ҵСorderСǿսף԰зֱorderµҰ벿ַŻصһ׵Ŀ
+		uint32_t current = order;
+		while (current <= pool.maxOrder && block.freeLists[current].empty())
+			current++;
+		if (current > pool.maxOrder)
+			return false;
+
+		VkDeviceSize nodeOffset = *block.freeLists[current].begin();
+		block.freeLists[current].erase(block.freeLists[current].begin());
+		while (current > order)
+		{
+			current--;
+			block.freeLists[current].insert(nodeOffset + (minNodeSize << current));
+		}
+
+		*offset = nodeOffset;
+		block.allocationCount++;
+		block.usedBytes += minNodeSize << order;
+		return true;
+	}
+
+	void MemoryAllocator::freeToBlock(Pool& pool, Block& block, VkDeviceSize offset, uint32_t order)
+	{
+		block.allocationCount--;
+		block.usedBytes -= minNodeSize << order;
+
+		// Ҳʱϲɸһ׵Ŀ飬һֱϲ鱻ռΪֹ
+		while (order < pool.maxOrder)
+		{
+			VkDeviceSize buddy = offset ^ (minNodeSize << order);
+			auto it = block.freeLists[order].find(buddy);
+			if (it == block.freeLists[order].end())
+				break;
+			block.freeLists[order].erase(it);
+			offset = std::min(offset, buddy);
+			order++;
+		}
+		block.freeLists[order].insert(offset);
+	}
+
+	VkResult MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind, Allocation* allocation, bool deviceAddress, MemoryCategory category)
+	{
+		uint32_t memoryType = getMemoryType(requirements.memoryTypeBits, properties);
+		if (memoryType == UINT32_MAX)
+			return VK_ERROR_FEATURE_NOT_PRESENT;
+		return allocateFromType(requirements, memoryType, kind, allocation, deviceAddress, category);
+	}
+
+	VkResult MemoryAllocator::allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, AllocationKind kind, Allocation* allocation, bool deviceAddress, MemoryCategory category)
+	{
+		// γԣBAR֮Сʱ˻صһͼֻͣͶʧܲŷش
+		VkResult result = VK_ERROR_FEATURE_NOT_PRESENT;
+		for (uint32_t memoryType : memoryTypeRanking[(size_t)usage])
+		{
+			if (!(requirements.memoryTypeBits & (1u << memoryType)))
+				continue;
+			result = allocateFromType(requirements, memoryType, kind, allocation, deviceAddress, category);
+			if (result != VK_ERROR_OUT_OF_DEVICE_MEMORY && result != VK_ERROR_OUT_OF_HOST_MEMORY)
+				return result;
+		}
+		return result;
+	}
+
+	VkResult MemoryAllocator::allocateFromType(const VkMemoryRequirements& requirements, uint32_t memoryType, AllocationKind kind, Allocation* allocation, bool deviceAddress, MemoryCategory category)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Pool& pool = pools[poolIndex(memoryType, kind, deviceAddress)];
+
+		// Դ䣬һԴռ˷ѵһ
+		VkDeviceSize needed = std::max({ requirements.size, requirements.alignment, minNodeSize });
+		if (needed > pool.blockSize / 2)
+			return allocateDedicated(memoryType, requirements.size, deviceAddress, category, allocation);
+
+		// 鰴С룬鲻Сalignment2ݣʱҪȻ
+		uint32_t order = 0;
+		while ((minNodeSize << order) < needed)
+			order++;
+
+		VkDeviceSize offset = 0;
+		uint32_t blockIndex = UINT32_MAX;
+		for (uint32_t i = 0; i < (uint32_t)pool.blocks.size(); i++)
+		{
+			if (pool.blocks[i] && allocateFromBlock(pool, *pool.blocks[i], order, &offset))
+			{
+				blockIndex = i;
+				break;
+			}
+		}
+
+		if (blockIndex == UINT32_MAX)
+		{
+			auto block = std::make_unique<Block>();
+			VkResult result = allocateMemory(memoryType, pool.blockSize, deviceAddress, &block->memory, &block->mapped);
+			if (result != VK_SUCCESS)
+			{
+				// ѿʱܷʧܣ˻صֻĴС
+				return allocateDedicated(memoryType, requirements.size, deviceAddress, category, allocation);
+			}
+			block->freeLists.resize(pool.maxOrder + 1);
+			block->freeLists[pool.maxOrder].insert(0);
+
+			auto empty = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+			blockIndex = (uint32_t)(empty - pool.blocks.begin());
+			if (empty == pool.blocks.end())
+				pool.blocks.push_back(std::move(block));
+			else
+				*empty = std::move(block);
+
+			bool allocated = allocateFromBlock(pool, *pool.blocks[blockIndex], order, &offset);
+			assert(allocated);
+			(void)allocated;
+		}
+
+		Block& block = *pool.blocks[blockIndex];
+		allocation->memory = block.memory;
+		allocation->offset = offset;
+		allocation->size = minNodeSize << order;
+		allocation->mapped = block.mapped ? (uint8_t*)block.mapped + offset : nullptr;
+		allocation->memoryType = memoryType;
+		allocation->pool = poolIndex(memoryType, kind, deviceAddress);
+		allocation->block = blockIndex;
+		allocation->order = order;
+		allocation->category = category;
+		trackAllocation(category, (int64_t)allocation->size);
+		return VK_SUCCESS;
+	}
+
+	VkResult MemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Allocation* allocation, bool deviceAddress, MemoryCategory category)
+	{
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &requirements);
+		VkResult result = allocate(requirements, properties, AllocationKind::Linear, allocation, deviceAddress, category);
+		if (result != VK_SUCCESS)
+			return result;
+		return vkBindBufferMemory(device, buffer, allocation->memory, allocation->offset);
+	}
+
+	VkResult MemoryAllocator::allocateForBuffer(VkBuffer buffer, MemoryUsage usage, Allocation* allocation, bool deviceAddress, MemoryCategory category)
+	{
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &requirements);
+		VkResult result = allocate(requirements, usage, AllocationKind::Linear, allocation, deviceAddress, category);
+		if (result != VK_SUCCESS)
+			return result;
+		return vkBindBufferMemory(device, buffer, allocation->memory, allocation->offset);
+	}
+
+	VkResult MemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, Allocation* allocation, bool linearTiling)
+	{
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, image, &requirements);
+		VkResult result = allocate(requirements, properties, linearTiling ? AllocationKind::Linear : AllocationKind::Optimal, allocation, false, MemoryCategory::Image);
+		if (result != VK_SUCCESS)
+			return result;
+		return vkBindImageMemory(device, image, allocation->memory, allocation->offset);
+	}
+
+	VkResult MemoryAllocator::allocateForImage(VkImage image, MemoryUsage usage, Allocation* allocation, bool linearTiling)
+	{
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, image, &requirements);
+		VkResult result = allocate(requirements, usage, linearTiling ? AllocationKind::Linear : AllocationKind::Optimal, allocation, false, MemoryCategory::Image);
+		if (result != VK_SUCCESS)
+			return result;
+		return vkBindImageMemory(device, image, allocation->memory, allocation->offset);
+	}
+
+	void MemoryAllocator::free(Allocation& allocation)
+	{
+		if (!allocation.valid())
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		trackAllocation(allocation.category, -(int64_t)allocation.size);
+		if (allocation.pool == UINT32_MAX)
+		{
+			vkFreeMemory(device, allocation.memory, nullptr);
+			trackMemory(allocation.memoryType, -(int64_t)allocation.size);
+			dedicatedCount--;
+			dedicatedBytes -= allocation.size;
+		}
+		else
+		{
+			Pool& pool = pools[allocation.pool];
+			Block& block = *pool.blocks[allocation.block];
+			freeToBlock(pool, block, allocation.offset, allocation.order);
+
+			// һտ鱸ãĿտ黹
+			if (block.allocationCount == 0)
+			{
+				bool hasOtherEmpty = false;
+				for (uint32_t i = 0; i < (uint32_t)pool.blocks.size(); i++)
+					hasOtherEmpty |= i != allocation.block && pool.blocks[i] && pool.blocks[i]->allocationCount == 0;
+				if (hasOtherEmpty)
+				{
+					vkFreeMemory(device, block.memory, nullptr);
+					trackMemory(pool.memoryType, -(int64_t)pool.blockSize);
+					pool.blocks[allocation.block].reset();
+				}
+			}
+		}
+		allocation = Allocation();
+	}
+
+	VkMappedMemoryRange MemoryAllocator::mappedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		// ΧͳȶҪnonCoherentAtomSizeӷƫƺʹС㣬ֻҪ߸ķΧ
+		VkDeviceSize begin = allocation.offset + offset;
+		VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : std::min(begin + size, allocation.offset + allocation.size);
+		begin = begin / nonCoherentAtomSize * nonCoherentAtomSize;
+		end = (end + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize;
+
+		VkMappedMemoryRange range{};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.memory;
+		range.offset = begin;
+		range.size = end - begin;
+		return range;
+	}
+
+	VkResult MemoryAllocator::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+		return vkFlushMappedMemoryRanges(device, 1, &range);
+	}
+
+	VkResult MemoryAllocator::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+	{
+		VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+		return vkInvalidateMappedMemoryRanges(device, 1, &range);
+	}
+
+	MemoryAllocator::Statistics MemoryAllocator::getStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Statistics statistics;
+		for (const Pool& pool : pools)
+		{
+			for (const std::unique_ptr<Block>& block : pool.blocks)
+			{
+				if (!block)
+					continue;
+				statistics.blockCount++;
+				statistics.allocationCount += block->allocationCount;
+				statistics.blockBytes += pool.blockSize;
+				statistics.usedBytes += block->usedBytes;
+			}
+		}
+		statistics.dedicatedCount = dedicatedCount;
+		statistics.dedicatedBytes = dedicatedBytes;
+		statistics.peakBytes = peakBytes;
+		std::copy(std::begin(categories), std::end(categories), statistics.categories);
+		std::copy(std::begin(heapBytes), std::end(heapBytes), statistics.heapBytes);
+		return statistics;
+	}
+
+	void MemoryAllocator::trackMemory(uint32_t memoryType, int64_t bytes)
+	{
+		heapBytes[memoryProperties.memoryTypes[memoryType].heapIndex] += bytes;
+		totalBytes += bytes;
+		peakBytes = std::max(peakBytes, totalBytes);
+	}
+
+	void MemoryAllocator::trackAllocation(MemoryCategory category, int64_t bytes)
+	{
+		Statistics::Category& stats = categories[(size_t)category];
+		stats.count += bytes > 0 ? 1 : -1;
+		stats.bytes += bytes;
+		stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+	}
+}
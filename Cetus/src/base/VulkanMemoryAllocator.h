@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace Cetus
+{
+	// ;ֻͳ
+	enum class MemoryCategory : uint32_t
+	{
+		Image = 0,							// ͼ
+		VertexIndex,						// 㻺
+		Uniform,							// һ»
+		Staging,							// ϴõݴ滺
+		Other,
+		Count
+	};
+
+	const char* memoryCategoryName(MemoryCategory category);
+
+	// ʹͼͼڴ򣬶Ҫ߸ȷ
+	enum class MemoryUsage : uint32_t
+	{
+		GpuOnly = 0,						// ֻGPUʣDEVICE_LOCALռɼԴ棨BAR
+		Upload,								// ݴ滺壬CPU˳дһΣHOST_VISIBLE|HOST_COHERENTԴ
+		Readback,							// GPUдCPUHOST_VISIBLEHOST_CACHED
+		Dynamic,							// CPUÿ֡дGPUHOST_VISIBLEDEVICE_LOCALReBARͼԿϾԴ棩
+		Count
+	};
+
+	// һӷĽԴ󶨵memoryoffset
+	struct Allocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;				// ʵռõĴСĴССĴСnonCoherentAtomSize
+		void* mapped = nullptr;				// ɼڴӳַѾoffsetڴ鳣פӳ
+		uint32_t memoryType = UINT32_MAX;
+
+		uint32_t pool = UINT32_MAX;			// ڴأUINT32_MAXʾ
+		uint32_t block = 0;					// ڴеڴ±
+		uint32_t order = 0;					// Ľ
+		MemoryCategory category = MemoryCategory::Other;
+
+		bool valid() const { return memory != VK_NULL_HANDLE; }
+	};
+
+	// ͬһڴֻͬһԴ壨ԣƽͼԶڣbufferImageGranularityȻõ
+	enum class AllocationKind
+	{
+		Linear = 0,							// ƽ̵ͼ
+		Optimal								// ƽ̵ͼ
+	};
+
+	// 豸ڴӷÿڴ͡ÿԴһڴأеڴ飨Ĭ64MBû㷨з֣
+	// ܴԴʹöVkDeviceMemoryVkDeviceMemoryͿȣmaxMemoryAllocationCountЩֻ4096
+	// Ҳֻڿвңÿε
+	class MemoryAllocator
+	{
+	public:
+		struct Statistics
+		{
+			uint32_t blockCount = 0;		// ڴеVkDeviceMemory
+			uint32_t dedicatedCount = 0;	// VkDeviceMemory
+			uint32_t allocationCount = 0;	// ӷ
+			VkDeviceSize blockBytes = 0;	// ڴܴС
+			VkDeviceSize usedBytes = 0;		// ӷռõĴС
+			VkDeviceSize dedicatedBytes = 0;
+			VkDeviceSize peakBytes = 0;		// blockBytes + dedicatedBytesķֵ
+
+			struct Category
+			{
+				uint32_t count = 0;
+				VkDeviceSize bytes = 0;
+				VkDeviceSize peakBytes = 0;
+			} categories[(size_t)MemoryCategory::Count];
+
+			VkDeviceSize heapBytes[VK_MAX_MEMORY_HEAPS] = {};	// ÿϷVkDeviceMemoryܴС
+
+			uint32_t memoryObjectCount() const { return blockCount + dedicatedCount; }
+		};
+
+		MemoryAllocator() = default;
+		~MemoryAllocator();
+
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+		void		init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+		void		destroy();
+
+		// ֻ䲻󶨡deviceAddressʾڴҪVK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT䣨SHADER_DEVICE_ADDRESS;ʱ
+		// ͼʱǰڵĶ˻غͣԽһgetMemoryType(usage)ͣDynamicBAR䵽ϵͳڴ棩
+		VkResult	allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, AllocationKind kind, Allocation* allocation, bool deviceAddress = false, MemoryCategory category = MemoryCategory::Other);
+		VkResult	allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, AllocationKind kind, Allocation* allocation, bool deviceAddress = false, MemoryCategory category = MemoryCategory::Other);
+		// 䲢󶨵ͼ
+		VkResult	allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, Allocation* allocation, bool deviceAddress = false, MemoryCategory category = MemoryCategory::Other);
+		VkResult	allocateForBuffer(VkBuffer buffer, MemoryUsage usage, Allocation* allocation, bool deviceAddress = false, MemoryCategory category = MemoryCategory::Other);
+		VkResult	allocateForImage(VkImage image, VkMemoryPropertyFlags properties, Allocation* allocation, bool linearTiling = false);
+		VkResult	allocateForImage(VkImage image, MemoryUsage usage, Allocation* allocation, bool linearTiling = false);
+		void		free(Allocation& allocation);
+
+		// һڴˢºʧЧoffsetallocation
+		VkResult	flush(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+		VkResult	invalidate(const Allocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		Statistics	getStatistics();
+		uint32_t	getMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+		// typeBitsаͼѡʵһinitʱ
+		uint32_t	getMemoryType(uint32_t typeBits, MemoryUsage usage) const;
+		// дDEVICE_LOCAL|HOST_VISIBLEڴ棨ReBAR򼯳Կʱ̬ݿCPUֱдԴ棬ʡݴ͸
+		bool		directUploadSupported() const { return directUpload; }
+		const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+	private:
+		static constexpr VkDeviceSize minNodeSize = 256;	// СĻ飬ͬʱnonCoherentAtomSizeޣ256
+
+		struct Block
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+			std::vector<std::set<VkDeviceSize>> freeLists;	// ÿһ׵Ŀлƫ
+			uint32_t allocationCount = 0;
+			VkDeviceSize usedBytes = 0;
+		};
+
+		struct Pool
+		{
+			uint32_t memoryType = 0;
+			bool deviceAddress = false;
+			VkDeviceSize blockSize = 0;
+			uint32_t maxOrder = 0;							// blockSize = minNodeSize << maxOrder
+			std::vector<std::unique_ptr<Block>> blocks;		// ͷŵĿÿգ±걣ֲ
+		};
+
+		uint32_t	poolIndex(uint32_t memoryType, AllocationKind kind, bool deviceAddress) const;
+		VkResult	allocateMemory(uint32_t memoryType, VkDeviceSize size, bool deviceAddress, VkDeviceMemory* memory, void** mapped);
+		VkResult	allocateDedicated(uint32_t memoryType, VkDeviceSize size, bool deviceAddress, MemoryCategory category, Allocation* allocation);
+		bool		allocateFromBlock(Pool& pool, Block& block, uint32_t order, VkDeviceSize* offset);
+		void		freeToBlock(Pool& pool, Block& block, VkDeviceSize offset, uint32_t order);
+		bool		isHostVisible(uint32_t memoryType) const;
+		VkMappedMemoryRange mappedRange(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+		VkResult	allocateFromType(const VkMemoryRequirements& requirements, uint32_t memoryType, AllocationKind kind, Allocation* allocation, bool deviceAddress, MemoryCategory category);
+		void		rankMemoryTypes();
+		void		trackMemory(uint32_t memoryType, int64_t bytes);
+		void		trackAllocation(MemoryCategory category, int64_t bytes);
+	private:
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		VkDeviceSize preferredBlockSize = 0;
+		VkDeviceSize nonCoherentAtomSize = 1;
+		std::vector<Pool> pools;						// ±poolIndex
+		std::vector<uint32_t> memoryTypeRanking[(size_t)MemoryUsage::Count];	// ÿͼ¿õڴͣӺõ
+		bool directUpload = false;
+		std::mutex mutex;
+
+		uint32_t dedicatedCount = 0;
+		VkDeviceSize dedicatedBytes = 0;
+
+		// ͳƣmutex
+		VkDeviceSize heapBytes[VK_MAX_MEMORY_HEAPS] = {};
+		VkDeviceSize totalBytes = 0;
+		VkDeviceSize peakBytes = 0;
+		Statistics::Category categories[(size_t)MemoryCategory::Count];
+	};
+}
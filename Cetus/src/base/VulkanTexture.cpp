@@ -17,8 +17,11 @@ namespace Cetus
 		if (sampler)	// Ĳڣ
 		{
 			vkDestroySampler(device->logicalDevice, sampler, nullptr);
-		}				// ͷ豸ڴ
-		vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+		}				// ͷ豸ڴ棬ӷĻ
+		if (allocation.valid())
+			device->memoryAllocator.free(allocation);
+		else
+			vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
 	}
 
 	ktxResult Texture::loadKTXFile(std::string filename, ktxTexture **target)
@@ -108,11 +111,9 @@ namespace Cetus
 
 
 			// ͼ豸ڴ
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			// ӷͼڴ沢󶨣deviceMemory¼ڵڴ飬ͷżdestroy
+			VK_CHECK_RESULT(device->memoryAllocator.allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+			deviceMemory = allocation.memory;
 
 
 			// ݻͼĸ
@@ -317,13 +318,9 @@ namespace Cetus
 			imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 		}
 		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-		// ͼڴ
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		// ӷͼڴ沢󶨣deviceMemory¼ڵڴ飬ͷżdestroy
+		VK_CHECK_RESULT(device->memoryAllocator.allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+		deviceMemory = allocation.memory;
 
 
 		// ͼƣͼϢ
@@ -465,11 +462,9 @@ namespace Cetus
 
 
 		// ͼڴ
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		// ӷͼڴ沢󶨣deviceMemory¼ڵڴ飬ͷżdestroy
+		VK_CHECK_RESULT(device->memoryAllocator.allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+		deviceMemory = allocation.memory;
 
 
 		// ݴ滺ͼ
@@ -629,11 +624,9 @@ namespace Cetus
 
 
 		// ͼڴ
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		// ӷͼڴ沢󶨣deviceMemory¼ڵڴ飬ͷżdestroy
+		VK_CHECK_RESULT(device->memoryAllocator.allocateForImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+		deviceMemory = allocation.memory;
 
 
 		// ݴ滺ݵͼ
@@ -23,6 +23,7 @@ class Texture
 	VkImage               image;
 	VkImageLayout         imageLayout;
 	VkDeviceMemory        deviceMemory;
+	Cetus::Allocation     allocation;		// ӷʱЧƽ̵ֱӷdeviceMemory
 	VkImageView           view;
 
 	uint32_t              width, height;
@@ -366,6 +366,67 @@ namespace Cetus
 			return !f.fail();
 		}
 
+		MappedFile::MappedFile(MappedFile&& other) noexcept
+		{
+			*this = std::move(other);
+		}
+
+		MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+		{
+			if (this != &other)
+			{
+				close();
+				std::swap(data, other.data);
+				std::swap(size, other.size);
+				std::swap(writeTime, other.writeTime);
+				std::swap(file, other.file);
+				std::swap(mapping, other.mapping);
+			}
+			return *this;
+		}
+
+		bool MappedFile::open(const std::string& filename)
+		{
+			close();
+			file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+			{
+				close();
+				return false;
+			}
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping)
+				data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (!data)
+			{
+				close();
+				return false;
+			}
+			size = static_cast<size_t>(fileSize.QuadPart);
+			FILETIME lastWrite;
+			if (GetFileTime(file, nullptr, nullptr, &lastWrite))
+				writeTime = (uint64_t(lastWrite.dwHighDateTime) << 32) | lastWrite.dwLowDateTime;
+			return true;
+		}
+
+		void MappedFile::close()
+		{
+			if (data)
+				UnmapViewOfFile(data);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			data = nullptr;
+			size = 0;
+			writeTime = 0;
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+		}
+
 		uint32_t alignedSize(uint32_t value, uint32_t alignment)
         {
 	        return (value + alignment - 1) & ~(alignment - 1);
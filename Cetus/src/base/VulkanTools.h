@@ -91,6 +91,27 @@ namespace Cetus
 
 		bool fileExists(const std::string &filename);
 
+		// ֻڴӳļݰҳ룬Ƶ̵Ķϣʱӳ
+		struct MappedFile
+		{
+			const unsigned char* data = nullptr;
+			size_t size = 0;
+			uint64_t writeTime = 0;			// дʱ䣨FILETIME100Ϊλ
+
+			MappedFile() = default;
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+			MappedFile(MappedFile&& other) noexcept;
+			MappedFile& operator=(MappedFile&& other) noexcept;
+			~MappedFile() { close(); }
+
+			bool open(const std::string& filename);	// ļӳ䣬false
+			void close();
+		private:
+			HANDLE file = INVALID_HANDLE_VALUE;
+			HANDLE mapping = nullptr;
+		};
+
 		uint32_t alignedSize(uint32_t value, uint32_t alignment);
 	}
 }
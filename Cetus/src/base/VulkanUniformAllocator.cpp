@@ -0,0 +1,66 @@
+#include "VulkanUniformAllocator.h"
+
+#include "VulkanDevice.h"
+
+namespace Cetus
+{
+	VkResult UniformAllocator::create(VulkanDevice* device, VkDeviceSize frameSize, uint32_t frameCount)
+	{
+		assert(frameCount > 0);
+		this->device = device;
+		this->alignment = std::max<VkDeviceSize>(device->properties.limits.minUniformBufferOffsetAlignment, 1);
+		this->frameSize = (frameSize + alignment - 1) / alignment * alignment;
+		this->frameCount = frameCount;
+
+		// CPUÿ֡дGPUDynamicͼ䣬ReBARͼԿֱԴ
+		VkResult result = device->createBuffer(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MemoryUsage::Dynamic, this->frameSize * frameCount, &buffer, &allocation);
+		if (result != VK_SUCCESS)
+			return result;
+		mapped = (uint8_t*)allocation.mapped;
+		coherent = (device->memoryProperties.memoryTypes[allocation.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+		frameBase = 0;
+		head = 0;
+		return VK_SUCCESS;
+	}
+
+	void UniformAllocator::destroy()
+	{
+		if (!device)
+			return;
+		vkDestroyBuffer(device->logicalDevice, buffer, nullptr);
+		device->memoryAllocator.free(allocation);
+		buffer = VK_NULL_HANDLE;
+		mapped = nullptr;
+		device = nullptr;
+	}
+
+	void UniformAllocator::beginFrame(uint32_t frameIndex)
+	{
+		assert(frameIndex < frameCount);
+		frameBase = frameSize * frameIndex;
+		head = 0;
+	}
+
+	UniformAllocation UniformAllocator::allocate(VkDeviceSize size)
+	{
+		UniformAllocation result;
+		VkDeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+		if (head + alignedSize > frameSize)
+		{
+			assert(!"UniformAllocator: frame segment exhausted, increase frameSize");
+			return result;
+		}
+		result.mapped = mapped + frameBase + head;
+		result.offset = (uint32_t)(frameBase + head);
+		head += alignedSize;
+		return result;
+	}
+
+	VkResult UniformAllocator::flush()
+	{
+		if (coherent || head == 0)
+			return VK_SUCCESS;
+		return device->memoryAllocator.flush(allocation, frameBase, head);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstring>
+
+#include "vulkan/vulkan.h"
+#include "VulkanMemoryAllocator.h"
+
+namespace Cetus
+{
+	struct VulkanDevice;
+
+	// ÿ֡һ»廷зһοռ
+	struct UniformAllocation
+	{
+		void* mapped = nullptr;				// פӳCPUַ
+		uint32_t offset = 0;				// еƫƣΪVK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMICĶ̬ƫƴvkCmdBindDescriptorSets
+	};
+
+	// ÿ֡һ»ԷһפӳĻ尴֡гɵȴĶΣÿֻ֡ԼĶ˳䣬
+	// ƫưminUniformBufferOffsetAlignment롣жһݹһһ̬
+	// ʱֻ̬ƫƣΪÿ󴴽塢ڴ
+	class UniformAllocator
+	{
+	public:
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize alignment = 0;			// ̬ƫƵĶ룬minUniformBufferOffsetAlignment
+		VkDeviceSize frameSize = 0;			// ÿ֡ĶδСalignment
+		uint32_t frameCount = 0;
+
+		VkResult	create(VulkanDevice* device, VkDeviceSize frameSize, uint32_t frameCount);
+		void		destroy();
+
+		// ʼframeIndexĶ䣬ľݱ߱Ѿȵһһύդ
+		void		beginFrame(uint32_t frameIndex);
+		// ڵǰ֡ĶsizeֽڣʱmappedΪյķ
+		UniformAllocation allocate(VkDeviceSize size);
+		template<typename T>
+		UniformAllocation push(const T& data)
+		{
+			UniformAllocation allocation = allocate(sizeof(T));
+			if (allocation.mapped)
+				memcpy(allocation.mapped, &data, sizeof(T));
+			return allocation;
+		}
+		// ύǰãڴ治һµʱˢ±֡дķΧ
+		VkResult	flush();
+
+		// ̬һ»ĻϢrangeÿΰʱɫܿĴСһһ¿飩
+		VkDescriptorBufferInfo descriptor(VkDeviceSize range) const { return { buffer, 0, range }; }
+		VkDeviceSize getUsedSize() const { return head; }
+	private:
+		VulkanDevice* device = nullptr;
+		Allocation allocation;
+		uint8_t* mapped = nullptr;
+		bool coherent = true;
+		VkDeviceSize frameBase = 0;			// ǰ֡Ķڻе
+		VkDeviceSize head = 0;				// ǰ֡ѷֽ
+	};
+}
@@ -3,17 +3,42 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 
 #include "VulkanglTFModel.h"
+#include "Cetus/TaskScheduler.h"
+
+#include <atomic>
+#include <glm/gtc/packing.hpp>
 
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutImage = VK_NULL_HANDLE;
 VkDescriptorSetLayout vkglTF::descriptorSetLayoutUbo = VK_NULL_HANDLE;
+VkDescriptorSetLayout vkglTF::descriptorSetLayoutMaterials = VK_NULL_HANDLE;
+VkDescriptorSetLayout vkglTF::descriptorSetLayoutDraws = VK_NULL_HANDLE;
 VkMemoryPropertyFlags vkglTF::memoryPropertyFlags = 0;
 uint32_t vkglTF::descriptorBindingFlags = vkglTF::DescriptorBindingFlags::ImageBaseColor;
+uint32_t vkglTF::materialIndexPushConstantOffset = 0;
+VkShaderStageFlags vkglTF::materialIndexPushConstantStages = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+/*
+	Bytes of an image stored in a buffer view of a memory mapped buffer, see loadMappedFile
+*/
+struct MappedImage {
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
 
 /*
 	We use a custom image loading function with tinyglTF, so we can do custom stuff loading ktx textures
 */
 bool loadImageDataFunc(tinygltf::Image* image, const int imageIndex, std::string* error, std::string* warning, int req_width, int req_height, const unsigned char* bytes, int size, void* userData)
 {
+	// tinygltf only saw a placeholder for images in mapped buffers, the actual bytes are in the mapping
+	if (userData) {
+		const std::vector<MappedImage>& mappedImages = *static_cast<const std::vector<MappedImage>*>(userData);
+		if (imageIndex < static_cast<int>(mappedImages.size()) && mappedImages[imageIndex].data) {
+			bytes = mappedImages[imageIndex].data;
+			size = static_cast<int>(mappedImages[imageIndex].size);
+		}
+	}
+
 	// KTX files will be handled by our own code
 	if (image->uri.find_last_of(".") != std::string::npos) {
 		if (image->uri.substr(image->uri.find_last_of(".") + 1) == "ktx") {
@@ -21,7 +46,10 @@ bool loadImageDataFunc(tinygltf::Image* image, const int imageIndex, std::string
 		}
 	}
 
-	return tinygltf::LoadImageData(image, imageIndex, error, warning, req_width, req_height, bytes, size, userData);
+	// Only keep the encoded file here, Model::loadImages decodes all images in parallel
+	image->image.assign(bytes, bytes + size);
+	image->component = 0;
+	return true;
 }
 
 bool loadImageDataFuncEmpty(tinygltf::Image* image, const int imageIndex, std::string* error, std::string* warning, int req_width, int req_height, const unsigned char* bytes, int size, void* userData) 
@@ -31,6 +59,206 @@ bool loadImageDataFuncEmpty(tinygltf::Image* image, const int imageIndex, std::s
 }
 
 
+/*
+	Loads a .gltf or .glb file with the file itself and all external buffers memory mapped
+	tinygltf gets the JSON with every mapped buffer replaced by a one byte placeholder, so the binary data is never copied
+	into tinygltf::Buffer::data; bufferData receives the mapped address of each buffer (nullptr for data URIs tinygltf decoded)
+	Returns false with an empty error if the file can't be mapped, the caller then falls back to the regular tinygltf loaders
+*/
+static bool loadMappedFile(tinygltf::TinyGLTF& context, tinygltf::Model& model, const std::string& filename, const std::string& basePath, bool binary,
+	std::vector<Cetus::tools::MappedFile>& mappedFiles, std::vector<const unsigned char*>& bufferData, std::vector<MappedImage>& mappedImages, std::string& error, std::string& warning)
+{
+	Cetus::tools::MappedFile file;
+	if (!file.open(filename)) {
+		return false;
+	}
+	const unsigned char* json = file.data;
+	size_t jsonSize = file.size;
+	MappedImage binChunk;
+	if (binary) {
+		// 12 byte header (magic, version, total length), then (length, type, data) chunks padded to 4 bytes, the JSON chunk comes first
+		uint32_t chunkHeader[2];
+		if (file.size < 20 || memcmp(file.data, "glTF", 4) != 0) {
+			error = "Invalid glb header";
+			return false;
+		}
+		memcpy(chunkHeader, file.data + 12, sizeof(chunkHeader));
+		if (chunkHeader[1] != 0x4E4F534A || 20 + size_t(chunkHeader[0]) > file.size) {
+			error = "Invalid glb JSON chunk";
+			return false;
+		}
+		json = file.data + 20;
+		jsonSize = chunkHeader[0];
+		const size_t binOffset = 20 + ((size_t(chunkHeader[0]) + 3) & ~size_t(3));
+		if (binOffset + 8 <= file.size) {
+			memcpy(chunkHeader, file.data + binOffset, sizeof(chunkHeader));
+			if (chunkHeader[1] == 0x004E4942 && binOffset + 8 + chunkHeader[0] <= file.size) {
+				binChunk.data = file.data + binOffset + 8;
+				binChunk.size = chunkHeader[0];
+			}
+		}
+	}
+
+	nlohmann::json document = nlohmann::json::parse(json, json + jsonSize, nullptr, false);
+	if (document.is_discarded() || !document.is_object()) {
+		error = "Invalid glTF JSON";
+		return false;
+	}
+	mappedFiles.push_back(std::move(file));
+
+	const std::string placeholder = "data:application/octet-stream;base64,AA==";
+	bufferData.clear();
+	if (document.count("buffers")) {
+		for (auto& buffer : document["buffers"]) {
+			const size_t byteLength = buffer.value("byteLength", size_t(0));
+			const std::string uri = buffer.value("uri", std::string());
+			const unsigned char* data = nullptr;
+			if (uri.empty()) {
+				if (byteLength > binChunk.size) {
+					error = "Buffer exceeds the glb binary chunk";
+					return false;
+				}
+				data = binChunk.data;
+			}
+			else if (uri.compare(0, 5, "data:") != 0) {
+				Cetus::tools::MappedFile bufferFile;
+				if (!bufferFile.open(basePath + "/" + tinygltf::dlib::urldecode(uri)) || bufferFile.size < byteLength) {
+					error = "Could not map buffer " + uri;
+					return false;
+				}
+				data = bufferFile.data;
+				mappedFiles.push_back(std::move(bufferFile));
+			}
+			if (data) {
+				buffer["uri"] = placeholder;
+				buffer["byteLength"] = 1;
+			}
+			bufferData.push_back(data);
+		}
+	}
+	// tinygltf would read images stored in buffer views from the placeholders, hand them to loadImageDataFunc instead
+	mappedImages.clear();
+	if (document.count("images")) {
+		for (auto& image : document["images"]) {
+			MappedImage mappedImage;
+			const size_t viewIndex = image.value("bufferView", SIZE_MAX);
+			if (viewIndex != SIZE_MAX && document.count("bufferViews") && viewIndex < document["bufferViews"].size()) {
+				const nlohmann::json& view = document["bufferViews"][viewIndex];
+				const size_t buffer = view.value("buffer", SIZE_MAX);
+				if (buffer < bufferData.size() && bufferData[buffer]) {
+					mappedImage.data = bufferData[buffer] + view.value("byteOffset", size_t(0));
+					mappedImage.size = view.value("byteLength", size_t(0));
+					image.erase("bufferView");
+					image["uri"] = placeholder;
+				}
+			}
+			mappedImages.push_back(mappedImage);
+		}
+	}
+
+	const std::string text = document.dump();
+	return context.LoadASCIIFromString(&model, &error, &warning, text.c_str(), static_cast<unsigned int>(text.size()), basePath);
+}
+
+/*
+	Cooked mesh cache: the final vertex and index buffers of a model, after the PreTransformVertices, FlipY and
+	PreMultiplyVertexColors passes, stored next to the glTF file as <file>.meshcache
+	Later loads map the cache and upload it directly instead of decoding the accessors
+	Layout: MeshCacheHeader, vertexCount vertices in the model's VertexLayout, indexCount uint32_t indices, and with a position stream vertexCount vec3 positions
+*/
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;		// Size and last write time of the glTF file and all of its mapped buffers
+	uint32_t loadingFlags;		// Only the flags that change the vertices
+	float scale;
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t vertexLayout;		// VertexLayout::key
+	uint32_t positionStride;	// 0 without a position stream
+	uint32_t reserved;
+};
+
+static const uint32_t meshCacheVersion = 3;
+static const uint32_t meshCacheLoadingFlags = vkglTF::FileLoadingFlags::PreTransformVertices | vkglTF::FileLoadingFlags::PreMultiplyVertexColors | vkglTF::FileLoadingFlags::FlipY;
+
+/*
+	Builds the key a cache has to match, the counts are filled in when the cache is written
+	The source is identified by size and last write time instead of hashing its contents, so a cache hit doesn't read the whole file
+*/
+static MeshCacheHeader meshCacheKey(const std::vector<Cetus::tools::MappedFile>& sourceFiles, uint32_t fileLoadingFlags, float scale, const vkglTF::VertexLayout& vertexLayout)
+{
+	MeshCacheHeader key{};
+	memcpy(key.magic, "CMSH", 4);
+	key.version = meshCacheVersion;
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const Cetus::tools::MappedFile& file : sourceFiles) {
+		for (uint64_t value : { uint64_t(file.size), file.writeTime }) {
+			hash = (hash ^ value) * 0x100000001b3ull;
+			hash ^= hash >> 32;
+		}
+	}
+	key.sourceHash = hash;
+	key.loadingFlags = fileLoadingFlags & meshCacheLoadingFlags;
+	key.scale = scale;
+	key.vertexStride = vertexLayout.stride();
+	key.vertexLayout = vertexLayout.key();
+	key.positionStride = vertexLayout.positionStream ? sizeof(glm::vec3) : 0;
+	return key;
+}
+
+/*
+	Maps the cache file and checks it against the key, the mapping is closed again if it doesn't match
+*/
+static bool openMeshCache(const std::string& cacheFile, const MeshCacheHeader& key, Cetus::tools::MappedFile& cache)
+{
+	if (!cache.open(cacheFile)) {
+		return false;
+	}
+	MeshCacheHeader header;
+	if (cache.size >= sizeof(MeshCacheHeader)) {
+		memcpy(&header, cache.data, sizeof(MeshCacheHeader));
+		if (memcmp(header.magic, key.magic, 4) == 0 && header.version == key.version && header.sourceHash == key.sourceHash && header.loadingFlags == key.loadingFlags &&
+			header.scale == key.scale && header.vertexStride == key.vertexStride && header.vertexLayout == key.vertexLayout &&
+			header.positionStride == key.positionStride &&
+			cache.size == sizeof(MeshCacheHeader) + size_t(header.vertexCount) * (header.vertexStride + header.positionStride) + size_t(header.indexCount) * sizeof(uint32_t)) {
+			return true;
+		}
+	}
+	cache.close();
+	return false;
+}
+
+/*
+	Writes the cache to a temporary file first, so an interrupted write never leaves a cache that passes openMeshCache
+*/
+static void writeMeshCache(const std::string& cacheFile, MeshCacheHeader header, const void* vertexData, uint32_t vertexCount, const std::vector<uint32_t>& indexBuffer, const std::vector<glm::vec3>& positions)
+{
+	header.vertexCount = vertexCount;
+	header.indexCount = static_cast<uint32_t>(indexBuffer.size());
+	const std::string tempFile = cacheFile + ".tmp";
+	{
+		std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			return;
+		}
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(static_cast<const char*>(vertexData), size_t(vertexCount) * header.vertexStride);
+		stream.write(reinterpret_cast<const char*>(indexBuffer.data()), indexBuffer.size() * sizeof(uint32_t));
+		stream.write(reinterpret_cast<const char*>(positions.data()), positions.size() * sizeof(glm::vec3));
+		if (!stream.good()) {
+			stream.close();
+			std::remove(tempFile.c_str());
+			return;
+		}
+	}
+	std::remove(cacheFile.c_str());
+	if (std::rename(tempFile.c_str(), cacheFile.c_str()) != 0) {
+		std::remove(tempFile.c_str());
+	}
+}
+
 /*
 	glTF texture loading class
 */
@@ -46,331 +274,303 @@ void vkglTF::Texture::destroy()
 {
 	if (device)
 	{
-		vkDestroyImageView(device->logicalDevice, view, nullptr);
-		vkDestroyImage(device->logicalDevice, image, nullptr);
-		vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
-		vkDestroySampler(device->logicalDevice, sampler, nullptr);
+		// Frames still in flight may sample the texture through its bindless slot, so the slot is only handed back
+		// (and the image released) once the device's deferred free queue has seen those frames complete
+		device->deferFree([device = device, bindlessIndex = bindlessIndex, view = view, image = image, allocation = allocation, sampler = sampler]() mutable {
+			device->bindlessTable.unregisterTexture(bindlessIndex);
+			vkDestroyImageView(device->logicalDevice, view, nullptr);
+			vkDestroyImage(device->logicalDevice, image, nullptr);
+			device->memoryAllocator.free(allocation);
+			vkDestroySampler(device->logicalDevice, sampler, nullptr);
+		});
+		bindlessIndex = Cetus::BindlessTable::invalidIndex;
+		allocation = Cetus::Allocation();
 	}
 }
 
-void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path, Cetus::VulkanDevice *device, VkQueue copyQueue)
+/*
+	Pixel data of a glTF image on its way to the GPU, filled in parallel by loadTextures
+*/
+struct TextureSource {
+	const unsigned char* data = nullptr;
+	VkDeviceSize size = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipLevels = 1;
+	// Images decoded with stb upload their first level and blit the others, KTX files contain all levels
+	bool generateMips = false;
+	std::vector<VkDeviceSize> levelOffsets;
+	ktxTexture* ktx = nullptr;
+	std::vector<unsigned char> rgba;
+	VkDeviceSize stagingOffset = 0;
+};
+
+static bool isKtxImage(const tinygltf::Image& gltfimage)
 {
-	this->device = device;
+	const size_t extension = gltfimage.uri.find_last_of(".");
+	return extension != std::string::npos && gltfimage.uri.substr(extension + 1) == "ktx";
+}
 
-	bool isKtx = false;
-	// Image points to an external ktx file
-	if (gltfimage.uri.find_last_of(".") != std::string::npos) {
-		if (gltfimage.uri.substr(gltfimage.uri.find_last_of(".") + 1) == "ktx") {
-			isKtx = true;
+// Decodes or reads the image file, safe to run for different images at the same time
+static void readTextureSource(tinygltf::Image& gltfimage, uint32_t imageIndex, const std::string& path, TextureSource& source)
+{
+	if (isKtxImage(gltfimage)) {
+		// Texture is stored in an external ktx file
+		std::string filename = path + "/" + gltfimage.uri;
+		if (!Cetus::tools::fileExists(filename)) {
+			Cetus::tools::exitFatal("Could not load texture from " + filename + "\n\nMake sure the assets submodule has been checked out and is up-to-date.", -1);
+		}
+		ktxResult result = ktxTexture_CreateFromNamedFile(filename.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &source.ktx);
+		assert(result == KTX_SUCCESS);
+		source.width = source.ktx->baseWidth;
+		source.height = source.ktx->baseHeight;
+		source.mipLevels = source.ktx->numLevels;
+		source.data = ktxTexture_GetData(source.ktx);
+		source.size = ktxTexture_GetSize(source.ktx);
+		for (uint32_t i = 0; i < source.mipLevels; i++) {
+			ktx_size_t offset;
+			result = ktxTexture_GetImageOffset(source.ktx, i, 0, 0, &offset);
+			assert(result == KTX_SUCCESS);
+			source.levelOffsets.push_back(offset);
 		}
+		return;
 	}
 
-	VkFormat format;
+	// loadImageDataFunc only kept the encoded file, decode it here (stb always expands to RGBA)
+	if (gltfimage.component == 0 && !gltfimage.image.empty()) {
+		std::vector<unsigned char> encoded = std::move(gltfimage.image);
+		std::string error, warning;
+		if (!tinygltf::LoadImageData(&gltfimage, imageIndex, &error, &warning, 0, 0, encoded.data(), static_cast<int>(encoded.size()), nullptr)) {
+			Cetus::tools::exitFatal("Could not decode glTF image \"" + gltfimage.name + "\": " + error, -1);
+		}
+	}
 
-	if (!isKtx) {
-		// Texture was loaded using STB_Image
+	const size_t pixelCount = static_cast<size_t>(gltfimage.width) * gltfimage.height;
+	if (gltfimage.component == 3) {
+		// Most devices don't support RGB only on Vulkan so convert if necessary
+		// TODO: Check actual format support and transform only if required
+		source.rgba.resize(pixelCount * 4);
+		unsigned char* rgba = source.rgba.data();
+		const unsigned char* rgb = gltfimage.image.data();
+		for (size_t i = 0; i < pixelCount; ++i) {
+			memcpy(rgba, rgb, 3);
+			rgba[3] = 255;
+			rgba += 4;
+			rgb += 3;
+		}
+		source.data = source.rgba.data();
+		source.size = source.rgba.size();
+	}
+	else {
+		source.data = gltfimage.image.data();
+		source.size = gltfimage.image.size();
+	}
+	source.width = gltfimage.width;
+	source.height = gltfimage.height;
+	source.mipLevels = static_cast<uint32_t>(floor(log2(std::max(source.width, source.height))) + 1.0);
+	source.generateMips = true;
+}
 
-		unsigned char* buffer = nullptr;
-		VkDeviceSize bufferSize = 0;
-		bool deleteBuffer = false;
-		if (gltfimage.component == 3) {
-			// Most devices don't support RGB only on Vulkan so convert if necessary
-			// TODO: Check actual format support and transform only if required
-			bufferSize = gltfimage.width * gltfimage.height * 4;
-			buffer = new unsigned char[bufferSize];
-			unsigned char* rgba = buffer;
-			unsigned char* rgb = &gltfimage.image[0];
-			for (size_t i = 0; i < gltfimage.width * gltfimage.height; ++i) {
-				for (int32_t j = 0; j < 3; ++j) {
-					rgba[j] = rgb[j];
-				}
-				rgba += 4;
-				rgb += 3;
+/*
+	Loads a batch of glTF images: decoding runs on the task scheduler, the pixel data is packed into a shared staging buffer
+	and all copies and mip chain blits of a batch are recorded into one command buffer with a single submit
+	The staging buffer is capped at stagingBudget per batch (unless a single image is larger), so huge scenes are split into a few submits
+*/
+static void loadTextures(vkglTF::Texture* textures, tinygltf::Image* const* images, uint32_t count, const std::string& path, Cetus::VulkanDevice* device, VkQueue copyQueue)
+{
+	const VkDeviceSize stagingBudget = 256ull * 1024 * 1024;
+	const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	std::vector<TextureSource> sources(count);
+	Cetus::TaskScheduler::Get().ParallelFor(count, [&](uint32_t i) {
+		readTextureSource(*images[i], i, path, sources[i]);
+	});
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
+	assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT);
+	assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+
+	uint32_t batchBegin = 0;
+	while (batchBegin < count) {
+		// Pack as many images as fit into the budget, offsets are aligned for any texel size
+		VkDeviceSize stagingSize = 0;
+		uint32_t batchEnd = batchBegin;
+		while (batchEnd < count) {
+			const VkDeviceSize offset = (stagingSize + 15) & ~VkDeviceSize(15);
+			if (batchEnd > batchBegin && offset + sources[batchEnd].size > stagingBudget) {
+				break;
 			}
-			deleteBuffer = true;
-		}
-		else {
-			buffer = &gltfimage.image[0];
-			bufferSize = gltfimage.image.size();
+			sources[batchEnd].stagingOffset = offset;
+			stagingSize = offset + sources[batchEnd].size;
+			batchEnd++;
 		}
 
-		format = VK_FORMAT_R8G8B8A8_UNORM;
-
-		VkFormatProperties formatProperties;
-
-		width = gltfimage.width;
-		height = gltfimage.height;
-		mipLevels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1.0);
-
-		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
-		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT);
-		assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
-
-		VkMemoryAllocateInfo memAllocInfo{};
-		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		VkMemoryRequirements memReqs{};
-
 		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo{};
-		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferCreateInfo.size = bufferSize;
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, buffer, bufferSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-		VkImageCreateInfo imageCreateInfo{};
-		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = mipLevels;
-		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+		Cetus::Allocation stagingAllocation;
+		VK_CHECK_RESULT(device->createBuffer(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, Cetus::MemoryUsage::Upload, stagingSize, &stagingBuffer, &stagingAllocation));
+		uint8_t* staging = static_cast<uint8_t*>(stagingAllocation.mapped);
+		Cetus::TaskScheduler::Get().ParallelFor(batchEnd - batchBegin, [&](uint32_t i) {
+			const TextureSource& source = sources[batchBegin + i];
+			memcpy(staging + source.stagingOffset, source.data, source.size);
+		});
+		device->memoryAllocator.flush(stagingAllocation);
+
+		uint32_t maxMipLevels = 1;
+		std::vector<VkImageMemoryBarrier> barriers;
+		for (uint32_t i = batchBegin; i < batchEnd; i++) {
+			const TextureSource& source = sources[i];
+			vkglTF::Texture& texture = textures[i];
+			texture.device = device;
+			texture.width = source.width;
+			texture.height = source.height;
+			texture.mipLevels = source.mipLevels;
+			texture.layerCount = 1;
+
+			VkImageCreateInfo imageCreateInfo = Cetus::initializers::imageCreateInfo();
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = format;
+			imageCreateInfo.mipLevels = texture.mipLevels;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCreateInfo.extent = { texture.width, texture.height, 1 };
+			imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			if (source.generateMips) {
+				imageCreateInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			}
+			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &texture.image));
+			// Sub-allocate and bind the image memory, deviceMemory is the block it lives in
+			VK_CHECK_RESULT(device->memoryAllocator.allocateForImage(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texture.allocation));
+			texture.deviceMemory = texture.allocation.memory;
+			maxMipLevels = std::max(maxMipLevels, source.generateMips ? texture.mipLevels : 1u);
+
+			VkImageMemoryBarrier barrier = Cetus::initializers::imageMemoryBarrier();
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.image = texture.image;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, texture.mipLevels, 0, 1 };
+			barriers.push_back(barrier);
+		}
 
 		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
 
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.levelCount = 1;
-		subresourceRange.layerCount = 1;
-
-		VkImageMemoryBarrier imageMemoryBarrier{};
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = 0;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-		VkBufferImageCopy bufferCopyRegion = {};
-		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		bufferCopyRegion.imageSubresource.mipLevel = 0;
-		bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-		bufferCopyRegion.imageSubresource.layerCount = 1;
-		bufferCopyRegion.imageExtent.width = width;
-		bufferCopyRegion.imageExtent.height = height;
-		bufferCopyRegion.imageExtent.depth = 1;
-
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-  		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-		device->flushCommandBuffer(copyCmd, copyQueue, true);
-
-		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
-		// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
-		VkCommandBuffer blitCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		for (uint32_t i = 1; i < mipLevels; i++) {
-			VkImageBlit imageBlit{};
-
-			imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.srcSubresource.layerCount = 1;
-			imageBlit.srcSubresource.mipLevel = i - 1;
-			imageBlit.srcOffsets[1].x = int32_t(width >> (i - 1));
-			imageBlit.srcOffsets[1].y = int32_t(height >> (i - 1));
-			imageBlit.srcOffsets[1].z = 1;
-
-			imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			imageBlit.dstSubresource.layerCount = 1;
-			imageBlit.dstSubresource.mipLevel = i;
-			imageBlit.dstOffsets[1].x = int32_t(width >> i);
-			imageBlit.dstOffsets[1].y = int32_t(height >> i);
-			imageBlit.dstOffsets[1].z = 1;
-
-			VkImageSubresourceRange mipSubRange = {};
-			mipSubRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			mipSubRange.baseMipLevel = i;
-			mipSubRange.levelCount = 1;
-			mipSubRange.layerCount = 1;
-
-			{
-				VkImageMemoryBarrier imageMemoryBarrier{};
-				imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-				imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				imageMemoryBarrier.srcAccessMask = 0;
-				imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				imageMemoryBarrier.image = image;
-				imageMemoryBarrier.subresourceRange = mipSubRange;
-				vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+		std::vector<VkBufferImageCopy> bufferCopyRegions;
+		for (uint32_t i = batchBegin; i < batchEnd; i++) {
+			const TextureSource& source = sources[i];
+			// stb images only have their first level, KTX files all of them
+			const uint32_t levelCount = source.generateMips ? 1 : source.mipLevels;
+			bufferCopyRegions.clear();
+			for (uint32_t level = 0; level < levelCount; level++) {
+				VkBufferImageCopy bufferCopyRegion = {};
+				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopyRegion.imageSubresource.mipLevel = level;
+				bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+				bufferCopyRegion.imageSubresource.layerCount = 1;
+				bufferCopyRegion.imageExtent.width = std::max(1u, source.width >> level);
+				bufferCopyRegion.imageExtent.height = std::max(1u, source.height >> level);
+				bufferCopyRegion.imageExtent.depth = 1;
+				bufferCopyRegion.bufferOffset = source.stagingOffset + (source.generateMips ? 0 : source.levelOffsets[level]);
+				bufferCopyRegions.push_back(bufferCopyRegion);
 			}
+			vkCmdCopyBufferToImage(copyCmd, stagingBuffer, textures[i].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+		}
 
-			vkCmdBlitImage(blitCmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+		// Generate the mip chains (glTF uses jpg and png, so we need to create this manually)
+		// Level by level across all images, so each level needs only one barrier call for the whole batch
+		for (uint32_t level = 1; level < maxMipLevels; level++) {
+			barriers.clear();
+			for (uint32_t i = batchBegin; i < batchEnd; i++) {
+				if (sources[i].generateMips && level < sources[i].mipLevels) {
+					VkImageMemoryBarrier barrier = Cetus::initializers::imageMemoryBarrier();
+					barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+					barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+					barrier.image = textures[i].image;
+					barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1 };
+					barriers.push_back(barrier);
+				}
+			}
+			vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
 
-			{
-				VkImageMemoryBarrier imageMemoryBarrier{};
-				imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-				imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-				imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-				imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-				imageMemoryBarrier.image = image;
-				imageMemoryBarrier.subresourceRange = mipSubRange;
-				vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+			for (uint32_t i = batchBegin; i < batchEnd; i++) {
+				const TextureSource& source = sources[i];
+				if (!source.generateMips || level >= source.mipLevels) {
+					continue;
+				}
+				VkImageBlit imageBlit{};
+				imageBlit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				imageBlit.srcSubresource.layerCount = 1;
+				imageBlit.srcSubresource.mipLevel = level - 1;
+				imageBlit.srcOffsets[1].x = int32_t(std::max(1u, source.width >> (level - 1)));
+				imageBlit.srcOffsets[1].y = int32_t(std::max(1u, source.height >> (level - 1)));
+				imageBlit.srcOffsets[1].z = 1;
+				imageBlit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				imageBlit.dstSubresource.layerCount = 1;
+				imageBlit.dstSubresource.mipLevel = level;
+				imageBlit.dstOffsets[1].x = int32_t(std::max(1u, source.width >> level));
+				imageBlit.dstOffsets[1].y = int32_t(std::max(1u, source.height >> level));
+				imageBlit.dstOffsets[1].z = 1;
+				vkCmdBlitImage(copyCmd, textures[i].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, textures[i].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
 			}
 		}
 
-		subresourceRange.levelCount = mipLevels;
-		imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		imageMemoryBarrier.image = image;
-		imageMemoryBarrier.subresourceRange = subresourceRange;
-		vkCmdPipelineBarrier(blitCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-        if (deleteBuffer) {
-            delete[] buffer;
-        }
-
-		device->flushCommandBuffer(blitCmd, copyQueue, true);
-	}
-	else {
-		// Texture is stored in an external ktx file
-		std::string filename = path + "/" + gltfimage.uri;
-
-		ktxTexture* ktxTexture;
-
-		ktxResult result = KTX_SUCCESS;
-
-		if (!Cetus::tools::fileExists(filename)) {
-			Cetus::tools::exitFatal("Could not load texture from " + filename + "\n\nMake sure the assets submodule has been checked out and is up-to-date.", -1);
+		// Blitted images have every level but the last one in TRANSFER_SRC, everything else is still in TRANSFER_DST
+		barriers.clear();
+		for (uint32_t i = batchBegin; i < batchEnd; i++) {
+			const TextureSource& source = sources[i];
+			VkImageMemoryBarrier barrier = Cetus::initializers::imageMemoryBarrier();
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.image = textures[i].image;
+			if (source.generateMips && source.mipLevels > 1) {
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, source.mipLevels - 1, 0, 1 };
+				barriers.push_back(barrier);
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, source.mipLevels - 1, 1, 0, 1 };
+			}
+			else {
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, source.mipLevels, 0, 1 };
+			}
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers.push_back(barrier);
 		}
-		result = ktxTexture_CreateFromNamedFile(filename.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTexture);	
-		assert(result == KTX_SUCCESS);
-
-		this->device = device;
-		width = ktxTexture->baseWidth;
-		height = ktxTexture->baseHeight;
-		mipLevels = ktxTexture->numLevels;
-
-		ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
-		ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
-		// @todo: Use ktxTexture_GetVkFormat(ktxTexture)
-		format = VK_FORMAT_R8G8B8A8_UNORM;
-
-		// Get device properties for the requested texture format
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
-
-		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = Cetus::initializers::bufferCreateInfo();
-		bufferCreateInfo.size = ktxTextureSize;
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		VkMemoryAllocateInfo memAllocInfo = Cetus::initializers::memoryAllocateInfo();
-		VkMemoryRequirements memReqs;
-		vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-		uint8_t* data;
-		VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-		memcpy(data, ktxTextureData, ktxTextureSize);
-		vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-		std::vector<VkBufferImageCopy> bufferCopyRegions;
-		for (uint32_t i = 0; i < mipLevels; i++)
-		{
-			ktx_size_t offset;
-			KTX_error_code result = ktxTexture_GetImageOffset(ktxTexture, i, 0, 0, &offset);
-			assert(result == KTX_SUCCESS);
-			VkBufferImageCopy bufferCopyRegion = {};
-			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			bufferCopyRegion.imageSubresource.mipLevel = i;
-			bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-			bufferCopyRegion.imageSubresource.layerCount = 1;
-			bufferCopyRegion.imageExtent.width = std::max(1u, ktxTexture->baseWidth >> i);
-			bufferCopyRegion.imageExtent.height = std::max(1u, ktxTexture->baseHeight >> i);
-			bufferCopyRegion.imageExtent.depth = 1;
-			bufferCopyRegion.bufferOffset = offset;
-			bufferCopyRegions.push_back(bufferCopyRegion);
-		}
-
-		// Create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo = Cetus::initializers::imageCreateInfo();
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = mipLevels;
-		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { width, height, 1 };
-		imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-		VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
-
-		vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-		memAllocInfo.allocationSize = memReqs.size;
-		memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
-
-		VkImageSubresourceRange subresourceRange = {};
-		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subresourceRange.baseMipLevel = 0;
-		subresourceRange.levelCount = mipLevels;
-		subresourceRange.layerCount = 1;
-
-		Cetus::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-		vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
-		Cetus::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-		device->flushCommandBuffer(copyCmd, copyQueue);
-		this->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
 
+		device->flushCommandBuffer(copyCmd, copyQueue, true);
 		vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-		vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-
-		ktxTexture_Destroy(ktxTexture);
+		device->memoryAllocator.free(stagingAllocation);
+
+		// The pixel data is on the GPU now, release it before the next batch
+		for (uint32_t i = batchBegin; i < batchEnd; i++) {
+			textures[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			textures[i].createSamplerAndView(format);
+			if (sources[i].ktx) {
+				ktxTexture_Destroy(sources[i].ktx);
+			}
+			sources[i] = TextureSource();
+			std::vector<unsigned char>().swap(images[i]->image);
+		}
+		batchBegin = batchEnd;
 	}
+}
+
+void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path, Cetus::VulkanDevice *device, VkQueue copyQueue)
+{
+	tinygltf::Image* image = &gltfimage;
+	loadTextures(this, &image, 1, path, device, copyQueue);
+}
 
+void vkglTF::Texture::createSamplerAndView(VkFormat format)
+{
 	VkSamplerCreateInfo samplerInfo{};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 	samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -406,14 +606,9 @@ void vkglTF::Texture::fromglTfImage(tinygltf::Image &gltfimage, std::string path
 /*
 	glTF material
 */
-void vkglTF::Material::createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags)
+void vkglTF::Material::createDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags)
 {
-	VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
-	descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	descriptorSetAllocInfo.descriptorPool = descriptorPool;
-	descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
-	descriptorSetAllocInfo.descriptorSetCount = 1;
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &descriptorSet));
+	VK_CHECK_RESULT(device->descriptorAllocator.allocate(descriptorSetLayout, &descriptorSet));
 	std::vector<VkDescriptorImageInfo> imageDescriptors{};
 	std::vector<VkWriteDescriptorSet> writeDescriptorSets{};
 	if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
@@ -459,26 +654,80 @@ void vkglTF::Primitive::setDimensions(glm::vec3 min, glm::vec3 max) {
 vkglTF::Mesh::Mesh(Cetus::VulkanDevice *device, glm::mat4 matrix) {
 	this->device = device;
 	this->uniformBlock.matrix = matrix;
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uniformBlock),
-		&uniformBuffer.buffer,
-		&uniformBuffer.memory,
-		&uniformBlock));
-	VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, uniformBuffer.memory, 0, sizeof(uniformBlock), 0, &uniformBuffer.mapped));
-	uniformBuffer.descriptor = { uniformBuffer.buffer, 0, sizeof(uniformBlock) };
+	// The uniform buffer slot is assigned by Model::createMeshUniforms once all meshes are known
 };
 
 vkglTF::Mesh::~Mesh() {
-	vkDestroyBuffer(device->logicalDevice, uniformBuffer.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, uniformBuffer.memory, nullptr);
     for(auto primitive : primitives)
     {
         delete primitive;
     }
 }
 
+/*
+	glTF animation sampler
+*/
+bool vkglTF::AnimationSampler::valid() const {
+	const size_t outputCount = interpolation == CUBICSPLINE ? inputs.size() * 3 : inputs.size();
+	return !inputs.empty() && outputsVec4.size() >= outputCount;
+}
+
+uint32_t vkglTF::AnimationSampler::findInterval(float time, uint32_t cursor) const {
+	const uint32_t last = static_cast<uint32_t>(inputs.size()) - 2;
+	if (cursor <= last && inputs[cursor] <= time) {
+		if (time <= inputs[cursor + 1]) {
+			return cursor;
+		}
+		if (cursor < last && time <= inputs[cursor + 2]) {
+			return cursor + 1;
+		}
+	}
+	// Seek: the interval starts at the last key not after time
+	const uint32_t next = static_cast<uint32_t>(std::upper_bound(inputs.begin(), inputs.end(), time) - inputs.begin());
+	return std::min(std::max(next, 1u) - 1, last);
+}
+
+glm::vec4 vkglTF::AnimationSampler::sample(float time, uint32_t& cursor, bool rotation) const {
+	const bool cubic = interpolation == CUBICSPLINE;
+	auto value = [&](uint32_t key) { return cubic ? outputsVec4[key * 3 + 1] : outputsVec4[key]; };
+	const uint32_t keyCount = static_cast<uint32_t>(inputs.size());
+	if (keyCount == 1 || time <= inputs.front()) {
+		cursor = 0;
+		return value(0);
+	}
+	if (time >= inputs.back()) {
+		cursor = keyCount - 2;
+		return value(keyCount - 1);
+	}
+
+	cursor = findInterval(time, cursor);
+	const uint32_t i = cursor;
+	const float delta = inputs[i + 1] - inputs[i];
+	const float u = delta > 0.0f ? (time - inputs[i]) / delta : 0.0f;
+	switch (interpolation) {
+	case STEP:
+		return value(i);
+	case CUBICSPLINE: {
+		// Hermite spline, tangents are scaled by the interval length (glTF 2.0 spec, Appendix C)
+		const float u2 = u * u;
+		const float u3 = u2 * u;
+		const glm::vec4 outTangent = outputsVec4[i * 3 + 2] * delta;
+		const glm::vec4 inTangent = outputsVec4[(i + 1) * 3] * delta;
+		glm::vec4 result = (2.0f * u3 - 3.0f * u2 + 1.0f) * value(i) + (u3 - 2.0f * u2 + u) * outTangent + (-2.0f * u3 + 3.0f * u2) * value(i + 1) + (u3 - u2) * inTangent;
+		return rotation ? glm::normalize(result) : result;
+	}
+	default: {
+		if (rotation) {
+			const glm::vec4 v1 = value(i);
+			const glm::vec4 v2 = value(i + 1);
+			glm::quat q = glm::normalize(glm::slerp(glm::quat(v1.w, v1.x, v1.y, v1.z), glm::quat(v2.w, v2.x, v2.y, v2.z), u));
+			return glm::vec4(q.x, q.y, q.z, q.w);
+		}
+		return glm::mix(value(i), value(i + 1), u);
+	}
+	}
+}
+
 /*
 	glTF node
 */
@@ -496,28 +745,25 @@ glm::mat4 vkglTF::Node::getMatrix() {
 	return m;
 }
 
-void vkglTF::Node::update() {
-	if (mesh) {
-		glm::mat4 m = getMatrix();
-		if (skin) {
-			mesh->uniformBlock.matrix = m;
-			// Update join matrices
-			glm::mat4 inverseTransform = glm::inverse(m);
-			for (size_t i = 0; i < skin->joints.size(); i++) {
-				vkglTF::Node *jointNode = skin->joints[i];
-				glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
-				jointMat = inverseTransform * jointMat;
-				mesh->uniformBlock.jointMatrix[i] = jointMat;
-			}
-			mesh->uniformBlock.jointcount = (float)skin->joints.size();
-			memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
-		} else {
-			memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
-		}
+void vkglTF::Node::update(const NodeHierarchy& hierarchy) {
+	if (!mesh) {
+		return;
 	}
-
-	for (auto& child : children) {
-		child->update();
+	const glm::mat4& m = hierarchy.worldMatrices[hierarchyIndex];
+	mesh->uniformBlock.matrix = m;
+	if (skin) {
+		// Update join matrices
+		glm::mat4 inverseTransform = glm::inverse(m);
+		for (size_t i = 0; i < skin->joints.size(); i++) {
+			vkglTF::Node *jointNode = skin->joints[i];
+			glm::mat4 jointMat = hierarchy.worldMatrices[jointNode->hierarchyIndex] * skin->inverseBindMatrices[i];
+			jointMat = inverseTransform * jointMat;
+			mesh->uniformBlock.jointMatrix[i] = jointMat;
+		}
+		mesh->uniformBlock.jointcount = (float)skin->joints.size();
+		memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
+	} else {
+		memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
 	}
 }
 
@@ -535,6 +781,7 @@ vkglTF::Node::~Node() {
 */
 
 VkVertexInputBindingDescription vkglTF::Vertex::vertexInputBindingDescription;
+std::vector<VkVertexInputBindingDescription> vkglTF::Vertex::vertexInputBindingDescriptions;
 std::vector<VkVertexInputAttributeDescription> vkglTF::Vertex::vertexInputAttributeDescriptions;
 VkPipelineVertexInputStateCreateInfo vkglTF::Vertex::pipelineVertexInputStateCreateInfo;
 
@@ -585,6 +832,206 @@ VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputStat
 	return &pipelineVertexInputStateCreateInfo;
 }
 
+VkPipelineVertexInputStateCreateInfo* vkglTF::Vertex::getPipelineVertexInputState(const VertexLayout& layout, bool positionsOnly) {
+	assert(layout.positionStream || !positionsOnly);
+	const std::vector<VertexComponent> allComponents = { VertexComponent::Position, VertexComponent::Normal, VertexComponent::UV, VertexComponent::Color, VertexComponent::Tangent, VertexComponent::Joint0, VertexComponent::Weight0 };
+	if (!layout.packed() && !layout.positionStream) {
+		return getPipelineVertexInputState(allComponents);
+	}
+	Vertex::vertexInputBindingDescriptions.clear();
+	Vertex::vertexInputAttributeDescriptions.clear();
+	// The vertex buffer is at binding 1 behind the position stream
+	uint32_t vertexBinding = 0;
+	if (layout.positionStream) {
+		Vertex::vertexInputBindingDescriptions.push_back({ 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX });
+		Vertex::vertexInputAttributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 });
+		vertexBinding = 1;
+	}
+	if (!positionsOnly) {
+		Vertex::vertexInputBindingDescriptions.push_back({ vertexBinding, layout.stride(), VK_VERTEX_INPUT_RATE_VERTEX });
+		uint32_t offset = 0;
+		for (VertexComponent component : (layout.packed() ? layout.components : allComponents)) {
+			const uint32_t location = static_cast<uint32_t>(Vertex::vertexInputAttributeDescriptions.size());
+			// Positions come from the position stream
+			if (component != VertexComponent::Position || !layout.positionStream) {
+				Vertex::vertexInputAttributeDescriptions.push_back(layout.packed() ?
+					VkVertexInputAttributeDescription({ location, vertexBinding, layout.format(component), offset }) :
+					Vertex::inputAttributeDescription(vertexBinding, location, component));
+			}
+			offset += layout.packed() ? layout.size(component) : 0;
+		}
+	}
+	pipelineVertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	pipelineVertexInputStateCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(Vertex::vertexInputBindingDescriptions.size());
+	pipelineVertexInputStateCreateInfo.pVertexBindingDescriptions = Vertex::vertexInputBindingDescriptions.data();
+	pipelineVertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(Vertex::vertexInputAttributeDescriptions.size());
+	pipelineVertexInputStateCreateInfo.pVertexAttributeDescriptions = Vertex::vertexInputAttributeDescriptions.data();
+	return &pipelineVertexInputStateCreateInfo;
+}
+
+VkFormat vkglTF::VertexLayout::format(VertexComponent component) const {
+	switch (component) {
+		case VertexComponent::Position:
+			return VK_FORMAT_R32G32B32_SFLOAT;
+		case VertexComponent::Normal:
+			return quantized ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+		case VertexComponent::UV:
+			return quantized ? VK_FORMAT_R16G16_SFLOAT : VK_FORMAT_R32G32_SFLOAT;
+		case VertexComponent::Color:
+			return quantized ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R32G32B32A32_SFLOAT;
+		case VertexComponent::Tangent:
+			return quantized ? VK_FORMAT_R16G16_SNORM : VK_FORMAT_R32G32B32A32_SFLOAT;
+		case VertexComponent::Joint0:
+			return quantized ? VK_FORMAT_R8G8B8A8_UINT : VK_FORMAT_R32G32B32A32_SFLOAT;
+		case VertexComponent::Weight0:
+			return quantized ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R32G32B32A32_SFLOAT;
+		default:
+			return VK_FORMAT_UNDEFINED;
+	}
+}
+
+uint32_t vkglTF::VertexLayout::size(VertexComponent component) const {
+	switch (format(component)) {
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+		case VK_FORMAT_R32G32B32_SFLOAT:
+			return 12;
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 8;
+		case VK_FORMAT_R16G16_SNORM:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_UINT:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+uint32_t vkglTF::VertexLayout::stride() const {
+	if (!packed()) {
+		return sizeof(Vertex);
+	}
+	uint32_t stride = 0;
+	for (VertexComponent component : components) {
+		stride += size(component);
+	}
+	return stride;
+}
+
+uint32_t vkglTF::VertexLayout::key() const {
+	// Three bits per component in layout order (0 marks the end), the quantized flag on top
+	uint32_t key = 0;
+	for (size_t i = 0; i < components.size() && i < 9; i++) {
+		key |= (static_cast<uint32_t>(components[i]) + 1) << (i * 3);
+	}
+	return key | (positionStream ? 0x40000000 : 0) | (quantized ? 0x80000000 : 0);
+}
+
+/*
+	Octahedral encoding of a direction: project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals
+	Zero length (or NaN, e.g. the normalized default of a missing normal) encodes +Z
+*/
+static glm::vec2 octEncode(const glm::vec3& direction)
+{
+	const float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (!(length > 0.0f)) {
+		return glm::vec2(0.0f);
+	}
+	const glm::vec3 n = direction / length;
+	if (n.z >= 0.0f) {
+		return glm::vec2(n.x, n.y);
+	}
+	return glm::vec2((1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+bool vkglTF::VertexLayout::pack(const Vertex* vertices, size_t count, unsigned char* dst) const {
+	if (!packed()) {
+		memcpy(dst, vertices, count * sizeof(Vertex));
+		return true;
+	}
+	const uint32_t vertexStride = stride();
+	std::atomic<bool> jointOverflow{ false };
+	const size_t blockSize = 4096;
+	const uint32_t blockCount = static_cast<uint32_t>((count + blockSize - 1) / blockSize);
+	Cetus::TaskScheduler::Get().ParallelFor(blockCount, [&](uint32_t block) {
+		const size_t end = std::min(count, (block + 1) * blockSize);
+		for (size_t v = block * blockSize; v < end; v++) {
+			const Vertex& vertex = vertices[v];
+			unsigned char* out = dst + v * vertexStride;
+			for (VertexComponent component : components) {
+				uint32_t packedValue = 0;
+				switch (component) {
+					case VertexComponent::Position:
+						memcpy(out, &vertex.pos, sizeof(vertex.pos));
+						break;
+					case VertexComponent::Normal:
+						if (quantized) {
+							packedValue = glm::packSnorm2x16(octEncode(vertex.normal));
+						}
+						else {
+							memcpy(out, &vertex.normal, sizeof(vertex.normal));
+						}
+						break;
+					case VertexComponent::UV:
+						if (quantized) {
+							packedValue = glm::packHalf2x16(vertex.uv);
+						}
+						else {
+							memcpy(out, &vertex.uv, sizeof(vertex.uv));
+						}
+						break;
+					case VertexComponent::Color:
+						if (quantized) {
+							packedValue = glm::packUnorm4x8(glm::clamp(vertex.color, 0.0f, 1.0f));
+						}
+						else {
+							memcpy(out, &vertex.color, sizeof(vertex.color));
+						}
+						break;
+					case VertexComponent::Tangent:
+						if (quantized) {
+							// y is remapped to [0, 1] and kept away from zero, so its sign can carry the bitangent handedness
+							glm::vec2 encoded = octEncode(glm::vec3(vertex.tangent));
+							encoded.y = std::max(encoded.y * 0.5f + 0.5f, 1.0f / 32767.0f) * (vertex.tangent.w < 0.0f ? -1.0f : 1.0f);
+							packedValue = glm::packSnorm2x16(encoded);
+						}
+						else {
+							memcpy(out, &vertex.tangent, sizeof(vertex.tangent));
+						}
+						break;
+					case VertexComponent::Joint0:
+						if (quantized) {
+							if (glm::any(glm::greaterThan(vertex.joint0, glm::vec4(255.0f)))) {
+								jointOverflow = true;
+							}
+							const glm::u8vec4 joints(glm::clamp(vertex.joint0, 0.0f, 255.0f));
+							memcpy(&packedValue, &joints, sizeof(joints));
+						}
+						else {
+							memcpy(out, &vertex.joint0, sizeof(vertex.joint0));
+						}
+						break;
+					case VertexComponent::Weight0:
+						if (quantized) {
+							packedValue = glm::packUnorm4x8(glm::clamp(vertex.weight0, 0.0f, 1.0f));
+						}
+						else {
+							memcpy(out, &vertex.weight0, sizeof(vertex.weight0));
+						}
+						break;
+				}
+				const uint32_t componentSize = size(component);
+				if (quantized && component != VertexComponent::Position) {
+					memcpy(out, &packedValue, componentSize);
+				}
+				out += componentSize;
+			}
+		}
+	});
+	return !jointOverflow;
+}
+
 vkglTF::Texture* vkglTF::Model::getTexture(uint32_t index)
 {
 
@@ -650,11 +1097,9 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 	imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 	VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &emptyTexture.image));
 
-	vkGetImageMemoryRequirements(device->logicalDevice, emptyTexture.image, &memReqs);
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &emptyTexture.deviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, emptyTexture.image, emptyTexture.deviceMemory, 0));
+	// Sub-allocate and bind the image memory, deviceMemory is the block it lives in
+	VK_CHECK_RESULT(device->memoryAllocator.allocateForImage(emptyTexture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &emptyTexture.allocation));
+	emptyTexture.deviceMemory = emptyTexture.allocation.memory;
 
 	VkImageSubresourceRange subresourceRange{};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -703,10 +1148,18 @@ void vkglTF::Model::createEmptyTexture(VkQueue transferQueue)
 vkglTF::Model::~Model()
 {
 	vkDestroyBuffer(device->logicalDevice, vertices.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, vertices.memory, nullptr);
+	device->memoryAllocator.free(vertices.allocation);
 	vkDestroyBuffer(device->logicalDevice, indices.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, indices.memory, nullptr);
-	for (auto texture : textures) {
+	device->memoryAllocator.free(indices.allocation);
+	if (positions.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, positions.buffer, nullptr);
+		device->memoryAllocator.free(positions.allocation);
+	}
+	if (uniforms.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device->logicalDevice, uniforms.buffer, nullptr);
+		device->memoryAllocator.free(uniforms.allocation);
+	}
+	for (auto& texture : textures) {
 		texture.destroy();
 	}
 	for (auto node : nodes) {
@@ -715,18 +1168,43 @@ vkglTF::Model::~Model()
     for (auto skin : skins) {
         delete skin;
     }
-	if (descriptorSetLayoutUbo != VK_NULL_HANDLE) {
-		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutUbo, nullptr);
-		descriptorSetLayoutUbo = VK_NULL_HANDLE;
+	// The layouts are owned by the descriptor allocator's cache; the sets go back to its pools
+	descriptorSetLayoutUbo = VK_NULL_HANDLE;
+	descriptorSetLayoutImage = VK_NULL_HANDLE;
+	device->descriptorAllocator.free(uniforms.descriptorSet);
+	for (auto& material : materials) {
+		device->descriptorAllocator.free(material.descriptorSet);
 	}
-	if (descriptorSetLayoutImage != VK_NULL_HANDLE) {
-		vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayoutImage, nullptr);
-		descriptorSetLayoutImage = VK_NULL_HANDLE;
+	if (materialTable.buffer != VK_NULL_HANDLE) {
+		device->descriptorAllocator.free(materialTable.descriptorSet);
+		vkDestroyBuffer(device->logicalDevice, materialTable.buffer, nullptr);
+		device->memoryAllocator.free(materialTable.allocation);
 	}
-	vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+	descriptorSetLayoutMaterials = VK_NULL_HANDLE;
+	if (indirect.commandBuffer != VK_NULL_HANDLE) {
+		device->descriptorAllocator.free(indirect.descriptorSet);
+		vkDestroyBuffer(device->logicalDevice, indirect.commandBuffer, nullptr);
+		device->memoryAllocator.free(indirect.commandAllocation);
+		vkDestroyBuffer(device->logicalDevice, indirect.drawDataBuffer, nullptr);
+		device->memoryAllocator.free(indirect.drawDataAllocation);
+		vkDestroyBuffer(device->logicalDevice, indirect.boundsBuffer, nullptr);
+		device->memoryAllocator.free(indirect.boundsAllocation);
+		vkDestroyBuffer(device->logicalDevice, indirect.culledCommandBuffer, nullptr);
+		device->memoryAllocator.free(indirect.culledCommandAllocation);
+		vkDestroyBuffer(device->logicalDevice, indirect.countBuffer, nullptr);
+		device->memoryAllocator.free(indirect.countAllocation);
+	}
+	descriptorSetLayoutDraws = VK_NULL_HANDLE;
 	emptyTexture.destroy();
 }
 
+const unsigned char* vkglTF::Model::accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const
+{
+	const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+	const unsigned char* base = (static_cast<size_t>(view.buffer) < bufferData.size() && bufferData[view.buffer]) ? bufferData[view.buffer] : model.buffers[view.buffer].data.data();
+	return base + view.byteOffset + accessor.byteOffset;
+}
+
 void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale)
 {
 	vkglTF::Node *newNode = new Node{};
@@ -776,8 +1254,10 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 			if (primitive.indices < 0) {
 				continue;
 			}
-			uint32_t indexStart = static_cast<uint32_t>(indexBuffer.size());
-			uint32_t vertexStart = static_cast<uint32_t>(vertexBuffer.size());
+			// With cooked geometry the final buffers come from the mesh cache, only the offsets are needed here
+			const bool cooked = cookedGeometry.loaded;
+			uint32_t indexStart = cooked ? cookedGeometry.indexCount : static_cast<uint32_t>(indexBuffer.size());
+			uint32_t vertexStart = cooked ? cookedGeometry.vertexCount : static_cast<uint32_t>(vertexBuffer.size());
 			uint32_t indexCount = 0;
 			uint32_t vertexCount = 0;
 			glm::vec3 posMin{};
@@ -798,118 +1278,109 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 				assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
 
 				const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-				const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-				bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
 				posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
 				posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
+				vertexCount = static_cast<uint32_t>(posAccessor.count);
 
-				if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-					const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
-					const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-					bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
-				}
-
-				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferTexCoords = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-				}
+				if (!cooked) {
+					bufferPos = reinterpret_cast<const float *>(accessorData(model, posAccessor));
 
-				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
-				{
-					const tinygltf::Accessor& colorAccessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
-					const tinygltf::BufferView& colorView = model.bufferViews[colorAccessor.bufferView];
-					// Color buffer are either of type vec3 or vec4
-					numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
-					bufferColors = reinterpret_cast<const float*>(&(model.buffers[colorView.buffer].data[colorAccessor.byteOffset + colorView.byteOffset]));
-				}
+					if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
+						const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
+						bufferNormals = reinterpret_cast<const float *>(accessorData(model, normAccessor));
+					}
 
-				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
-				{
-					const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
-					const tinygltf::BufferView &tangentView = model.bufferViews[tangentAccessor.bufferView];
-					bufferTangents = reinterpret_cast<const float *>(&(model.buffers[tangentView.buffer].data[tangentAccessor.byteOffset + tangentView.byteOffset]));
-				}
+					if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
+						const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
+						bufferTexCoords = reinterpret_cast<const float *>(accessorData(model, uvAccessor));
+					}
 
-				// Skinning
-				// Joints
-				if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
-					const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
-					bufferJoints = reinterpret_cast<const uint16_t *>(&(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
-				}
+					if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
+					{
+						const tinygltf::Accessor& colorAccessor = model.accessors[primitive.attributes.find("COLOR_0")->second];
+						// Color buffer are either of type vec3 or vec4
+						numColorComponents = colorAccessor.type == TINYGLTF_PARAMETER_TYPE_FLOAT_VEC3 ? 3 : 4;
+						bufferColors = reinterpret_cast<const float*>(accessorData(model, colorAccessor));
+					}
 
-				if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
-					const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
-					const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-					bufferWeights = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-				}
+					if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
+					{
+						const tinygltf::Accessor &tangentAccessor = model.accessors[primitive.attributes.find("TANGENT")->second];
+						bufferTangents = reinterpret_cast<const float *>(accessorData(model, tangentAccessor));
+					}
 
-				hasSkin = (bufferJoints && bufferWeights);
+					// Skinning
+					// Joints
+					if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
+						const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
+						bufferJoints = reinterpret_cast<const uint16_t *>(accessorData(model, jointAccessor));
+					}
 
-				vertexCount = static_cast<uint32_t>(posAccessor.count);
+					if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
+						const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
+						bufferWeights = reinterpret_cast<const float *>(accessorData(model, uvAccessor));
+					}
 
-				for (size_t v = 0; v < posAccessor.count; v++) {
-					Vertex vert{};
-					vert.pos = glm::vec4(glm::make_vec3(&bufferPos[v * 3]), 1.0f);
-					vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * 3]) : glm::vec3(0.0f)));
-					vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[v * 2]) : glm::vec3(0.0f);
-					if (bufferColors) {
-						switch (numColorComponents) {
-							case 3: 
-								vert.color = glm::vec4(glm::make_vec3(&bufferColors[v * 3]), 1.0f);
-							case 4:
-								vert.color = glm::make_vec4(&bufferColors[v * 4]);
+					hasSkin = (bufferJoints && bufferWeights);
+
+					for (size_t v = 0; v < posAccessor.count; v++) {
+						Vertex vert{};
+						vert.pos = glm::vec4(glm::make_vec3(&bufferPos[v * 3]), 1.0f);
+						vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * 3]) : glm::vec3(0.0f)));
+						vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[v * 2]) : glm::vec3(0.0f);
+						if (bufferColors) {
+							switch (numColorComponents) {
+								case 3: 
+									vert.color = glm::vec4(glm::make_vec3(&bufferColors[v * 3]), 1.0f);
+								case 4:
+									vert.color = glm::make_vec4(&bufferColors[v * 4]);
+							}
 						}
+						else {
+							vert.color = glm::vec4(1.0f);
+						}
+						vert.tangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
+						vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[v * 4])) : glm::vec4(0.0f);
+						vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * 4]) : glm::vec4(0.0f);
+						vertexBuffer.push_back(vert);
 					}
-					else {
-						vert.color = glm::vec4(1.0f);
-					}
-					vert.tangent = bufferTangents ? glm::vec4(glm::make_vec4(&bufferTangents[v * 4])) : glm::vec4(0.0f);
-					vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[v * 4])) : glm::vec4(0.0f);
-					vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * 4]) : glm::vec4(0.0f);
-					vertexBuffer.push_back(vert);
 				}
 			}
 			// Indices
 			{
 				const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-				const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+				const void* data = accessorData(model, accessor);
 
 				indexCount = static_cast<uint32_t>(accessor.count);
 
-				switch (accessor.componentType) {
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-					uint32_t *buf = new uint32_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
+				// Read straight from the buffer (or its memory mapping), no intermediate copy
+				if (!cooked) {
+					switch (accessor.componentType) {
+					case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
+						const uint32_t *buf = static_cast<const uint32_t*>(data);
+						for (size_t index = 0; index < accessor.count; index++) {
+							indexBuffer.push_back(buf[index] + vertexStart);
+						}
+						break;
 					}
-                    delete[] buf;
-					break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-					uint16_t *buf = new uint16_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
+					case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
+						const uint16_t *buf = static_cast<const uint16_t*>(data);
+						for (size_t index = 0; index < accessor.count; index++) {
+							indexBuffer.push_back(buf[index] + vertexStart);
+						}
+						break;
 					}
-                    delete[] buf;
-                    break;
-				}
-				case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-					uint8_t *buf = new uint8_t[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
-					for (size_t index = 0; index < accessor.count; index++) {
-						indexBuffer.push_back(buf[index] + vertexStart);
+					case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
+						const uint8_t *buf = static_cast<const uint8_t*>(data);
+						for (size_t index = 0; index < accessor.count; index++) {
+							indexBuffer.push_back(buf[index] + vertexStart);
+						}
+						break;
+					}
+					default:
+						std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
+						return;
 					}
-                    delete[] buf;
-                    break;
-				}
-				default:
-					std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
-					return;
 				}
 			}
 			Primitive *newPrimitive = new Primitive(indexStart, indexCount, primitive.material > -1 ? materials[primitive.material] : materials.back());
@@ -917,6 +1388,10 @@ void vkglTF::Model::loadNode(vkglTF::Node *parent, const tinygltf::Node &node, u
 			newPrimitive->vertexCount = vertexCount;
 			newPrimitive->setDimensions(posMin, posMax);
 			newMesh->primitives.push_back(newPrimitive);
+			if (cooked) {
+				cookedGeometry.vertexCount += vertexCount;
+				cookedGeometry.indexCount += indexCount;
+			}
 		}
 		newNode->mesh = newMesh;
 	}
@@ -950,10 +1425,8 @@ void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 		// Get inverse bind matrices from buffer
 		if (source.inverseBindMatrices > -1) {
 			const tinygltf::Accessor &accessor = gltfModel.accessors[source.inverseBindMatrices];
-			const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-			const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
 			newSkin->inverseBindMatrices.resize(accessor.count);
-			memcpy(newSkin->inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::mat4));
+			memcpy(newSkin->inverseBindMatrices.data(), accessorData(gltfModel, accessor), accessor.count * sizeof(glm::mat4));
 		}
 
 		skins.push_back(newSkin);
@@ -962,11 +1435,12 @@ void vkglTF::Model::loadSkins(tinygltf::Model &gltfModel)
 
 void vkglTF::Model::loadImages(tinygltf::Model &gltfModel, Cetus::VulkanDevice *device, VkQueue transferQueue)
 {
+	std::vector<tinygltf::Image*> images;
 	for (tinygltf::Image &image : gltfModel.images) {
-		vkglTF::Texture texture;
-		texture.fromglTfImage(image, path, device, transferQueue);
-		textures.push_back(texture);
+		images.push_back(&image);
 	}
+	textures.resize(images.size());
+	loadTextures(textures.data(), images.data(), static_cast<uint32_t>(images.size()), path, device, transferQueue);
 	// Create an empty texture to be used for empty material images
 	createEmptyTexture(transferQueue);
 }
@@ -975,6 +1449,7 @@ void vkglTF::Model::loadMaterials(tinygltf::Model &gltfModel)
 {
 	for (tinygltf::Material &mat : gltfModel.materials) {
 		vkglTF::Material material(device);
+		material.index = static_cast<uint32_t>(materials.size());
 		if (mat.values.find("baseColorTexture") != mat.values.end()) {
 			material.baseColorTexture = getTexture(gltfModel.textures[mat.values["baseColorTexture"].TextureIndex()].source);
 		}
@@ -1019,6 +1494,7 @@ void vkglTF::Model::loadMaterials(tinygltf::Model &gltfModel)
 	}
 	// Push a default material at the end of the list for meshes with no material assigned
 	materials.push_back(Material(device));
+	materials.back().index = static_cast<uint32_t>(materials.size() - 1);
 }
 
 void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
@@ -1047,13 +1523,11 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 			// Read sampler input time values
 			{
 				const tinygltf::Accessor &accessor = gltfModel.accessors[samp.input];
-				const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
 
 				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
 				float *buf = new float[accessor.count];
-				memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(float));
+				memcpy(buf, accessorData(gltfModel, accessor), accessor.count * sizeof(float));
 				for (size_t index = 0; index < accessor.count; index++) {
 					sampler.inputs.push_back(buf[index]);
 				}
@@ -1071,15 +1545,13 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 			// Read sampler output T/R/S values 
 			{
 				const tinygltf::Accessor &accessor = gltfModel.accessors[samp.output];
-				const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
 
 				assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
 				switch (accessor.type) {
 				case TINYGLTF_TYPE_VEC3: {
 					glm::vec3 *buf = new glm::vec3[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec3));
+					memcpy(buf, accessorData(gltfModel, accessor), accessor.count * sizeof(glm::vec3));
 					for (size_t index = 0; index < accessor.count; index++) {
 						sampler.outputsVec4.push_back(glm::vec4(buf[index], 0.0f));
 					}
@@ -1088,7 +1560,7 @@ void vkglTF::Model::loadAnimations(tinygltf::Model &gltfModel)
 				}
 				case TINYGLTF_TYPE_VEC4: {
 					glm::vec4 *buf = new glm::vec4[accessor.count];
-					memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec4));
+					memcpy(buf, accessorData(gltfModel, accessor), accessor.count * sizeof(glm::vec4));
 					for (size_t index = 0; index < accessor.count; index++) {
 						sampler.outputsVec4.push_back(buf[index]);
 					}
@@ -1139,10 +1611,11 @@ void vkglTF::Model::loadFromFile(std::string filename, Cetus::VulkanDevice *devi
 {
 	tinygltf::Model gltfModel;
 	tinygltf::TinyGLTF gltfContext;
+	std::vector<MappedImage> mappedImages;
 	if (fileLoadingFlags & FileLoadingFlags::DontLoadImages) {
 		gltfContext.SetImageLoader(loadImageDataFuncEmpty, nullptr);
 	} else {
-		gltfContext.SetImageLoader(loadImageDataFunc, nullptr);
+		gltfContext.SetImageLoader(loadImageDataFunc, &mappedImages);
 	}
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
@@ -1155,13 +1628,36 @@ void vkglTF::Model::loadFromFile(std::string filename, Cetus::VulkanDevice *devi
 	std::string error, warning;
 
 	this->device = device;
+	// Bindless needs the table to be created on the device, otherwise the model uses per material image sets
+	bindless = (fileLoadingFlags & FileLoadingFlags::BindlessTextures) && !(fileLoadingFlags & FileLoadingFlags::DontLoadImages) && device->bindlessTable.isCreated();
 
 #if defined(__ANDROID__)
 	// On Android all assets are packed with the apk in a compressed form, so we need to open them using the asset manager
 	// We let tinygltf handle this, by passing the asset manager of our app
 	tinygltf::asset_manager = androidApp->activity->assetManager;
 #endif
-	bool fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	// Map the file and its external buffers instead of reading them, vertex data is then copied only once into the staging buffers
+	const bool binary = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".glb") == 0;
+	std::vector<Cetus::tools::MappedFile> mappedFiles;
+	bool fileLoaded = loadMappedFile(gltfContext, gltfModel, filename, path, binary, mappedFiles, bufferData, mappedImages, error, warning);
+	if (!fileLoaded && error.empty()) {
+		// Mapping not possible, let tinygltf read everything into memory
+		mappedFiles.clear();
+		mappedImages.clear();
+		bufferData.clear();
+		fileLoaded = binary ? gltfContext.LoadBinaryFromFile(&gltfModel, &error, &warning, filename) : gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+	}
+
+	// Cooked geometry from an earlier load replaces decoding the accessors, the cache key needs the source to be mapped
+	const bool useMeshCache = fileLoaded && !mappedFiles.empty() && !(fileLoadingFlags & FileLoadingFlags::DontUseMeshCache);
+	const std::string meshCacheFile = filename + ".meshcache";
+	MeshCacheHeader meshCacheHeader{};
+	Cetus::tools::MappedFile meshCache;
+	cookedGeometry = {};
+	if (useMeshCache) {
+		meshCacheHeader = meshCacheKey(mappedFiles, fileLoadingFlags, scale, vertexLayout);
+		cookedGeometry.loaded = openMeshCache(meshCacheFile, meshCacheHeader, meshCache);
+	}
 
 	std::vector<uint32_t> indexBuffer;
 	std::vector<Vertex> vertexBuffer;
@@ -1180,17 +1676,19 @@ void vkglTF::Model::loadFromFile(std::string filename, Cetus::VulkanDevice *devi
 			loadAnimations(gltfModel);
 		}
 		loadSkins(gltfModel);
+		createMeshUniforms();
 
+		// Assign skins
 		for (auto node : linearNodes) {
-			// Assign skins
 			if (node->skinIndex > -1) {
 				node->skin = skins[node->skinIndex];
 			}
-			// Initial pose
-			if (node->mesh) {
-				node->update();
-			}
 		}
+		// Initial pose, every node starts out dirty
+		buildHierarchy();
+		updateHierarchy();
+		// All accessors have been read, the mappings are released when mappedFiles goes out of scope
+		bufferData.clear();
 	}
 	else {
 		// TODO: throw
@@ -1198,14 +1696,14 @@ void vkglTF::Model::loadFromFile(std::string filename, Cetus::VulkanDevice *devi
 		return;
 	}
 
-	// Pre-Calculations for requested features
-	if ((fileLoadingFlags & FileLoadingFlags::PreTransformVertices) || (fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors) || (fileLoadingFlags & FileLoadingFlags::FlipY)) {
+	// Pre-Calculations for requested features, already applied to cooked geometry
+	if (!cookedGeometry.loaded && ((fileLoadingFlags & FileLoadingFlags::PreTransformVertices) || (fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors) || (fileLoadingFlags & FileLoadingFlags::FlipY))) {
 		const bool preTransform = fileLoadingFlags & FileLoadingFlags::PreTransformVertices;
 		const bool preMultiplyColor = fileLoadingFlags & FileLoadingFlags::PreMultiplyVertexColors;
 		const bool flipY = fileLoadingFlags & FileLoadingFlags::FlipY;
 		for (Node* node : linearNodes) {
 			if (node->mesh) {
-				const glm::mat4 localMatrix = node->getMatrix();
+				const glm::mat4 localMatrix = hierarchy.worldMatrices[node->hierarchyIndex];
 				for (Primitive* primitive : node->mesh->primitives) {
 					for (uint32_t i = 0; i < primitive->vertexCount; i++) {
 						Vertex& vertex = vertexBuffer[primitive->firstVertex + i];
@@ -1236,123 +1734,210 @@ void vkglTF::Model::loadFromFile(std::string filename, Cetus::VulkanDevice *devi
 		}
 	}
 
-	size_t vertexBufferSize = vertexBuffer.size() * sizeof(Vertex);
-	size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
+	void* vertexData = vertexBuffer.data();
+	void* indexData = indexBuffer.data();
 	indices.count = static_cast<uint32_t>(indexBuffer.size());
 	vertices.count = static_cast<uint32_t>(vertexBuffer.size());
+	const uint32_t vertexStride = vertexLayout.stride();
+	// Repack into the requested layout, cooked geometry is already stored in it
+	std::vector<unsigned char> packedVertices;
+	if (!cookedGeometry.loaded && vertexLayout.packed()) {
+		packedVertices.resize(vertexBuffer.size() * vertexStride);
+		if (!vertexLayout.pack(vertexBuffer.data(), vertexBuffer.size(), packedVertices.data())) {
+			Cetus::tools::exitFatal("Could not load glTF file \"" + filename + "\": joint indices don't fit into the quantized vertex layout", -1);
+			return;
+		}
+		vertexData = packedVertices.data();
+	}
+	// De-interleaved positions for position only passes
+	std::vector<glm::vec3> positionStream;
+	void* positionData = nullptr;
+	if (!cookedGeometry.loaded && vertexLayout.positionStream) {
+		positionStream.resize(vertexBuffer.size());
+		for (size_t i = 0; i < vertexBuffer.size(); i++) {
+			positionStream[i] = vertexBuffer[i].pos;
+		}
+		positionData = positionStream.data();
+	}
+	if (cookedGeometry.loaded) {
+		// Uploaded straight from the cache mapping
+		memcpy(&meshCacheHeader, meshCache.data, sizeof(MeshCacheHeader));
+		assert(meshCacheHeader.vertexCount == cookedGeometry.vertexCount && meshCacheHeader.indexCount == cookedGeometry.indexCount);
+		vertexData = const_cast<unsigned char*>(meshCache.data) + sizeof(MeshCacheHeader);
+		indexData = static_cast<unsigned char*>(vertexData) + size_t(meshCacheHeader.vertexCount) * vertexStride;
+		if (vertexLayout.positionStream) {
+			positionData = static_cast<unsigned char*>(indexData) + size_t(meshCacheHeader.indexCount) * sizeof(uint32_t);
+		}
+		indices.count = static_cast<int>(meshCacheHeader.indexCount);
+		vertices.count = static_cast<int>(meshCacheHeader.vertexCount);
+	}
+	else if (useMeshCache) {
+		writeMeshCache(meshCacheFile, meshCacheHeader, vertexData, static_cast<uint32_t>(vertices.count), indexBuffer, positionStream);
+	}
+	size_t vertexBufferSize = size_t(vertices.count) * vertexStride;
+	size_t positionBufferSize = positionData ? size_t(vertices.count) * sizeof(glm::vec3) : 0;
+	size_t indexBufferSize = size_t(indices.count) * sizeof(uint32_t);
 
 	assert((vertexBufferSize > 0) && (indexBufferSize > 0));
 
-	struct StagingBuffer {
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-	} vertexStaging, indexStaging;
+	// Device local memory is host visible (resizable BAR or unified memory), so the buffers are written directly without a staging copy.
+	// The BAR heap can still be full, in which case the Dynamic intent fails or falls back to system memory; whatever was created
+	// is released again and the buffers are staged into plain device memory instead
+	auto createDirect = [&](VkBufferUsageFlags usageFlags, VkDeviceSize size, VkBuffer* buffer, Cetus::Allocation* allocation, void* data) {
+		if (device->createBuffer(usageFlags, Cetus::MemoryUsage::Dynamic, size, buffer, allocation, data) != VK_SUCCESS) {
+			return false;
+		}
+		return (device->memoryAllocator.getMemoryProperties().memoryTypes[allocation->memoryType].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+	};
+	bool directUpload = device->directUploadSupported()
+		&& createDirect(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | memoryPropertyFlags, vertexBufferSize, &vertices.buffer, &vertices.allocation, vertexData)
+		&& createDirect(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | memoryPropertyFlags, indexBufferSize, &indices.buffer, &indices.allocation, indexData)
+		&& (!positionData || createDirect(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | memoryPropertyFlags, positionBufferSize, &positions.buffer, &positions.allocation, positionData));
+	if (!directUpload) {
+		for (auto* buffer : { &vertices.buffer, &indices.buffer, &positions.buffer }) {
+			if (*buffer != VK_NULL_HANDLE) {
+				vkDestroyBuffer(device->logicalDevice, *buffer, nullptr);
+				*buffer = VK_NULL_HANDLE;
+			}
+		}
+		device->memoryAllocator.free(vertices.allocation);
+		device->memoryAllocator.free(indices.allocation);
+		device->memoryAllocator.free(positions.allocation);
+
+		struct StagingBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Cetus::Allocation allocation;
+		} vertexStaging, indexStaging, positionStaging;
+
+		// Create staging buffers
+		// Vertex data
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			Cetus::MemoryUsage::Upload,
+			vertexBufferSize,
+			&vertexStaging.buffer,
+			&vertexStaging.allocation,
+			vertexData));
+		// Index data
+		VK_CHECK_RESULT(device->createBuffer(
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			Cetus::MemoryUsage::Upload,
+			indexBufferSize,
+			&indexStaging.buffer,
+			&indexStaging.allocation,
+			indexData));
+		// Position stream
+		if (positionData) {
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				Cetus::MemoryUsage::Upload,
+				positionBufferSize,
+				&positionStaging.buffer,
+				&positionStaging.allocation,
+				positionData));
+		}
 
-	// Create staging buffers
-	// Vertex data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		vertexBufferSize,
-		&vertexStaging.buffer,
-		&vertexStaging.memory,
-		vertexBuffer.data()));
-	// Index data
-	VK_CHECK_RESULT(device->createBuffer(
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		indexBufferSize,
-		&indexStaging.buffer,
-		&indexStaging.memory,
-		indexBuffer.data()));
+		// Create device local buffers
+		// Vertex buffer
+		VK_CHECK_RESULT(device->createBuffer(
+		    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
+			Cetus::MemoryUsage::GpuOnly,
+			vertexBufferSize,
+			&vertices.buffer,
+			&vertices.allocation));
+		// Index buffer
+		VK_CHECK_RESULT(device->createBuffer(
+		    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
+			Cetus::MemoryUsage::GpuOnly,
+			indexBufferSize,
+			&indices.buffer,
+			&indices.allocation));
+		// Position buffer
+		if (positionData) {
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
+				Cetus::MemoryUsage::GpuOnly,
+				positionBufferSize,
+				&positions.buffer,
+				&positions.allocation));
+		}
 
-	// Create device local buffers
-	// Vertex buffer
-	VK_CHECK_RESULT(device->createBuffer(
-	    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertexBufferSize,
-		&vertices.buffer,
-		&vertices.memory));
-	// Index buffer
-	VK_CHECK_RESULT(device->createBuffer(
-	    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | memoryPropertyFlags,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBufferSize,
-		&indices.buffer,
-		&indices.memory));
+		// Copy from staging buffers
+		VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 
-	// Copy from staging buffers
-	VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+		VkBufferCopy copyRegion = {};
 
-	VkBufferCopy copyRegion = {};
+		copyRegion.size = vertexBufferSize;
+		vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
 
-	copyRegion.size = vertexBufferSize;
-	vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
+		copyRegion.size = indexBufferSize;
+		vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
 
-	copyRegion.size = indexBufferSize;
-	vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
+		if (positionData) {
+			copyRegion.size = positionBufferSize;
+			vkCmdCopyBuffer(copyCmd, positionStaging.buffer, positions.buffer, 1, &copyRegion);
+		}
 
-	device->flushCommandBuffer(copyCmd, transferQueue, true);
+		device->flushCommandBuffer(copyCmd, transferQueue, true);
 
-	vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-	vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-	vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
+		vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
+		device->memoryAllocator.free(vertexStaging.allocation);
+		vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
+		device->memoryAllocator.free(indexStaging.allocation);
+		if (positionStaging.buffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device->logicalDevice, positionStaging.buffer, nullptr);
+			device->memoryAllocator.free(positionStaging.allocation);
+		}
+	}
 
 	getSceneDimensions();
 
 	// Setup descriptors
-	uint32_t uboCount{ 0 };
-	uint32_t imageCount{ 0 };
-	for (auto node : linearNodes) {
-		if (node->mesh) {
-			uboCount++;
-		}
-	}
-	for (auto material : materials) {
-		if (material.baseColorTexture != nullptr) {
-			imageCount++;
-		}
-	}
-	std::vector<VkDescriptorPoolSize> poolSizes = {
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount },
-	};
-	if (imageCount > 0) {
-		if (descriptorBindingFlags & DescriptorBindingFlags::ImageBaseColor) {
-			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount });
-		}
-		if (descriptorBindingFlags & DescriptorBindingFlags::ImageNormalMap) {
-			poolSizes.push_back({ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount });
-		}
-	}
-	VkDescriptorPoolCreateInfo descriptorPoolCI{};
-	descriptorPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descriptorPoolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	descriptorPoolCI.pPoolSizes = poolSizes.data();
-	descriptorPoolCI.maxSets = uboCount + imageCount;
-	VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
-
+	// Sets come from the device's descriptor allocator, which grows its pools as needed; layouts are cached by content
 	// Descriptors for per-node uniform buffers
 	{
 		// Layout is global, so only create if it hasn't already been created before
 		if (descriptorSetLayoutUbo == VK_NULL_HANDLE) {
 			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-				Cetus::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+				Cetus::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 0),
 			};
-			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
-			descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-			descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-			descriptorLayoutCI.pBindings = setLayoutBindings.data();
-			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutUbo));
+			descriptorSetLayoutUbo = device->descriptorAllocator.createLayout(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+			assert(descriptorSetLayoutUbo != VK_NULL_HANDLE);
 		}
-		for (auto node : nodes) {
-			prepareNodeDescriptor(node, descriptorSetLayoutUbo);
+		if (uniforms.buffer != VK_NULL_HANDLE) {
+			VK_CHECK_RESULT(device->descriptorAllocator.allocate(descriptorSetLayoutUbo, &uniforms.descriptorSet));
+
+			// The range covers one mesh's uniform block, the mesh is selected with its dynamic offset at bind time
+			VkDescriptorBufferInfo bufferInfo{ uniforms.buffer, 0, sizeof(Mesh::UniformBlock) };
+			VkWriteDescriptorSet writeDescriptorSet{};
+			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			writeDescriptorSet.descriptorCount = 1;
+			writeDescriptorSet.dstSet = uniforms.descriptorSet;
+			writeDescriptorSet.dstBinding = 0;
+			writeDescriptorSet.pBufferInfo = &bufferInfo;
+			vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+
+			for (auto node : linearNodes) {
+				if (node->mesh) {
+					node->mesh->uniformBuffer.descriptorSet = uniforms.descriptorSet;
+				}
+			}
 		}
 	}
 
+	// The draw data is fetched with gl_InstanceIndex, which only reaches firstInstance with the drawIndirectFirstInstance feature
+	indirectDraw = (fileLoadingFlags & FileLoadingFlags::IndirectDraw) && device->enabledFeatures.drawIndirectFirstInstance;
+	if (indirectDraw) {
+		createIndirectDraws();
+	}
+
+	// Bindless: textures are indexed from the device's texture table, materials from a storage buffer
+	if (bindless) {
+		createMaterialTable();
+	}
 	// Descriptors for per-material images
-	{
+	else {
 		// Layout is global, so only create if it hasn't already been created before
 		if (descriptorSetLayoutImage == VK_NULL_HANDLE) {
 			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
@@ -1362,28 +1947,45 @@ void vkglTF::Model::loadFromFile(std::string filename, Cetus::VulkanDevice *devi
 			if (descriptorBindingFlags & DescriptorBindingFlags::ImageNormalMap) {
 				setLayoutBindings.push_back(Cetus::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, static_cast<uint32_t>(setLayoutBindings.size())));
 			}
-			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
-			descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-			descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-			descriptorLayoutCI.pBindings = setLayoutBindings.data();
-			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayoutImage));
+			descriptorSetLayoutImage = device->descriptorAllocator.createLayout(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+			assert(descriptorSetLayoutImage != VK_NULL_HANDLE);
 		}
 		for (auto& material : materials) {
 			if (material.baseColorTexture != nullptr) {
-				material.createDescriptorSet(descriptorPool, vkglTF::descriptorSetLayoutImage, descriptorBindingFlags);
+				material.createDescriptorSet(vkglTF::descriptorSetLayoutImage, descriptorBindingFlags);
 			}
 		}
 	}
 }
 
-void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer)
+void vkglTF::Model::bindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t renderFlags)
 {
-	const VkDeviceSize offsets[1] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+	const VkDeviceSize offsets[2] = {0, 0};
+	if (positions.buffer != VK_NULL_HANDLE) {
+		// The position stream stays at binding 0, so position only pipelines also work with all streams bound
+		const VkBuffer buffers[2] = { positions.buffer, vertices.buffer };
+		vkCmdBindVertexBuffers(commandBuffer, 0, (renderFlags & RenderFlags::PositionsOnly) ? 1 : 2, buffers, offsets);
+	}
+	else {
+		assert(!(renderFlags & RenderFlags::PositionsOnly));
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+	}
 	vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void vkglTF::Model::bindBuffers(VkCommandBuffer commandBuffer, uint32_t renderFlags)
+{
+	bindVertexBuffers(commandBuffer, renderFlags);
 	buffersBound = true;
 }
 
+void vkglTF::Model::bindMaterials(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t firstSet)
+{
+	assert(bindless);
+	const VkDescriptorSet sets[2] = { device->bindlessTable.descriptorSet, materialTable.descriptorSet };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, firstSet, 2, sets, 0, nullptr);
+}
+
 void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
 {
 	if (node->mesh) {
@@ -1400,7 +2002,10 @@ void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t
 				skip = (material.alphaMode != Material::ALPHAMODE_BLEND);
 			}
 			if (!skip) {
-				if (renderFlags & RenderFlags::BindImages) {
+				if (renderFlags & RenderFlags::PushMaterialIndex) {
+					vkCmdPushConstants(commandBuffer, pipelineLayout, materialIndexPushConstantStages, materialIndexPushConstantOffset, sizeof(uint32_t), &material.index);
+				}
+				else if (renderFlags & RenderFlags::BindImages) {
 					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, bindImageSet, 1, &material.descriptorSet, 0, nullptr);
 				}
 				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
@@ -1415,21 +2020,76 @@ void vkglTF::Model::drawNode(Node *node, VkCommandBuffer commandBuffer, uint32_t
 void vkglTF::Model::draw(VkCommandBuffer commandBuffer, uint32_t renderFlags, VkPipelineLayout pipelineLayout, uint32_t bindImageSet)
 {
 	if (!buffersBound) {
-		const VkDeviceSize offsets[1] = {0};
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		bindVertexBuffers(commandBuffer, renderFlags);
 	}
 	for (auto& node : nodes) {
 		drawNode(node, commandBuffer, renderFlags, pipelineLayout, bindImageSet);
 	}
 }
 
+void vkglTF::Model::bindDrawData(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set)
+{
+	assert(indirect.descriptorSet != VK_NULL_HANDLE);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &indirect.descriptorSet, 0, nullptr);
+}
+
+void vkglTF::Model::drawIndirect(VkCommandBuffer commandBuffer, uint32_t renderFlags, bool culled)
+{
+	assert(indirectDraw && "drawIndirect on a model without indirect draws, check Model::indirectDraw and use draw instead");
+	if (indirect.commandBuffer == VK_NULL_HANDLE) {
+		return;
+	}
+	const VkBuffer commandSource = culled ? indirect.culledCommandBuffer : indirect.commandBuffer;
+	// Compacted commands: the culler wrote each bucket's visible count, let the device read it
+	const bool drawCount = culled && device->cmdDrawIndexedIndirectCount != nullptr;
+	if (!buffersBound) {
+		bindVertexBuffers(commandBuffer, renderFlags);
+	}
+	const uint32_t bucketFlags[3] = { RenderFlags::RenderOpaqueNodes, RenderFlags::RenderAlphaMaskedNodes, RenderFlags::RenderAlphaBlendedNodes };
+	const bool allBuckets = !(renderFlags & (RenderFlags::RenderOpaqueNodes | RenderFlags::RenderAlphaMaskedNodes | RenderFlags::RenderAlphaBlendedNodes));
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	for (uint32_t i = 0; i < 3; i++) {
+		const IndirectDraws::Bucket& bucket = indirect.buckets[i];
+		if (bucket.count == 0 || !(allBuckets || (renderFlags & bucketFlags[i]))) {
+			continue;
+		}
+		if (drawCount) {
+			device->cmdDrawIndexedIndirectCount(commandBuffer, commandSource, bucket.first * stride, indirect.countBuffer, i * sizeof(uint32_t), bucket.count, stride);
+		}
+		else if (device->enabledFeatures.multiDrawIndirect) {
+			vkCmdDrawIndexedIndirect(commandBuffer, commandSource, bucket.first * stride, bucket.count, stride);
+		}
+		else {
+			for (uint32_t j = 0; j < bucket.count; j++) {
+				vkCmdDrawIndexedIndirect(commandBuffer, commandSource, (bucket.first + j) * stride, 1, stride);
+			}
+		}
+	}
+}
+
+Cetus::DrawCuller::DrawSet vkglTF::Model::getCullDrawSet() const
+{
+	Cetus::DrawCuller::DrawSet drawSet;
+	drawSet.commands = indirect.commandBuffer;
+	drawSet.drawData = indirect.drawDataBuffer;
+	drawSet.uniforms = uniforms.buffer;
+	drawSet.bounds = indirect.boundsBuffer;
+	drawSet.culledCommands = indirect.culledCommandBuffer;
+	drawSet.counts = indirect.countBuffer;
+	drawSet.drawCount = indirect.drawCount;
+	for (uint32_t i = 0; i < Cetus::DrawCuller::bucketCount; i++) {
+		drawSet.bucketFirst[i] = indirect.buckets[i].first;
+	}
+	return drawSet;
+}
+
 void vkglTF::Model::getNodeDimensions(Node *node, glm::vec3 &min, glm::vec3 &max)
 {
 	if (node->mesh) {
+		const glm::mat4& nodeMatrix = hierarchy.worldMatrices[node->hierarchyIndex];
 		for (Primitive *primitive : node->mesh->primitives) {
-			glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * node->getMatrix();
-			glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * node->getMatrix();
+			glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * nodeMatrix;
+			glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * nodeMatrix;
 			if (locMin.x < min.x) { min.x = locMin.x; }
 			if (locMin.y < min.y) { min.y = locMin.y; }
 			if (locMin.z < min.z) { min.z = locMin.z; }
@@ -1465,49 +2125,81 @@ void vkglTF::Model::updateAnimation(uint32_t index, float time)
 
 	bool updated = false;
 	for (auto& channel : animation.channels) {
-		vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
-		if (sampler.inputs.size() > sampler.outputsVec4.size()) {
+		const vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
+		if (!sampler.valid()) {
 			continue;
 		}
+		const glm::vec4 value = sampler.sample(time, channel.cursor, channel.path == vkglTF::AnimationChannel::PathType::ROTATION);
+		switch (channel.path) {
+		case vkglTF::AnimationChannel::PathType::TRANSLATION:
+			channel.node->translation = glm::vec3(value);
+			break;
+		case vkglTF::AnimationChannel::PathType::SCALE:
+			channel.node->scale = glm::vec3(value);
+			break;
+		case vkglTF::AnimationChannel::PathType::ROTATION:
+			channel.node->rotation = glm::quat(value.w, value.x, value.y, value.z);
+			break;
+		}
+		markDirty(channel.node);
+		updated = true;
+	}
+	if (updated) {
+		updateHierarchy();
+	}
+}
+
+void vkglTF::Model::updateAnimations(const AnimationUpdate* updates, uint32_t count)
+{
+	// Every model owns its channel cursors and hierarchy, so instances don't share any state
+	Cetus::TaskScheduler::Get().ParallelFor(count, [updates](uint32_t i) {
+		updates[i].model->updateAnimation(updates[i].animation, updates[i].time);
+	});
+}
+
+void vkglTF::Model::markDirty(Node* node)
+{
+	assert(node->hierarchyIndex < hierarchy.dirty.size());
+	hierarchy.dirty[node->hierarchyIndex] = 1;
+}
+
+void vkglTF::Model::updateHierarchy()
+{
+	// Parents are sorted before their children, so a parent's world matrix and changed flag are final when a child is reached
+	const size_t count = hierarchy.nodes.size();
+	bool anyChanged = false;
+	for (size_t i = 0; i < count; i++) {
+		const int32_t parent = hierarchy.parents[i];
+		const bool changed = hierarchy.dirty[i] || (parent >= 0 && hierarchy.changed[parent]);
+		hierarchy.changed[i] = changed;
+		hierarchy.dirty[i] = 0;
+		if (changed) {
+			const glm::mat4 local = hierarchy.nodes[i]->localMatrix();
+			hierarchy.worldMatrices[i] = parent >= 0 ? hierarchy.worldMatrices[parent] * local : local;
+			anyChanged = true;
+		}
+	}
+	if (!anyChanged) {
+		return;
+	}
 
-		for (auto i = 0; i < sampler.inputs.size() - 1; i++) {
-			if ((time >= sampler.inputs[i]) && (time <= sampler.inputs[i + 1])) {
-				float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
-				if (u <= 1.0f) {
-					switch (channel.path) {
-					case vkglTF::AnimationChannel::PathType::TRANSLATION: {
-						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-						channel.node->translation = glm::vec3(trans);
-						break;
-					}
-					case vkglTF::AnimationChannel::PathType::SCALE: {
-						glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-						channel.node->scale = glm::vec3(trans);
-						break;
-					}
-					case vkglTF::AnimationChannel::PathType::ROTATION: {
-						glm::quat q1;
-						q1.x = sampler.outputsVec4[i].x;
-						q1.y = sampler.outputsVec4[i].y;
-						q1.z = sampler.outputsVec4[i].z;
-						q1.w = sampler.outputsVec4[i].w;
-						glm::quat q2;
-						q2.x = sampler.outputsVec4[i + 1].x;
-						q2.y = sampler.outputsVec4[i + 1].y;
-						q2.z = sampler.outputsVec4[i + 1].z;
-						q2.w = sampler.outputsVec4[i + 1].w;
-						channel.node->rotation = glm::normalize(glm::slerp(q1, q2, u));
-						break;
-					}
-					}
-					updated = true;
+	// A skinned mesh also needs updating when only some of its joints moved
+	for (size_t i = 0; i < count; i++) {
+		Node* node = hierarchy.nodes[i];
+		if (!node->mesh) {
+			continue;
+		}
+		bool changed = hierarchy.changed[i];
+		if (!changed && node->skin) {
+			for (Node* joint : node->skin->joints) {
+				if (hierarchy.changed[joint->hierarchyIndex]) {
+					changed = true;
+					break;
 				}
 			}
 		}
-	}
-	if (updated) {
-		for (auto &node : nodes) {
-			node->update();
+		if (changed) {
+			node->update(hierarchy);
 		}
 	}
 }
@@ -1540,26 +2232,215 @@ vkglTF::Node* vkglTF::Model::nodeFromIndex(uint32_t index) {
 	return nodeFound;
 }
 
-void vkglTF::Model::prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout) {
-	if (node->mesh) {
-		VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
-		descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		descriptorSetAllocInfo.descriptorPool = descriptorPool;
-		descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
-		descriptorSetAllocInfo.descriptorSetCount = 1;
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
+void vkglTF::Model::buildHierarchy()
+{
+	// Breadth first from the scene roots, which puts every parent before its children
+	hierarchy.nodes.clear();
+	hierarchy.parents.clear();
+	hierarchy.nodes.reserve(linearNodes.size());
+	hierarchy.parents.reserve(linearNodes.size());
+	for (auto node : nodes) {
+		node->hierarchyIndex = static_cast<uint32_t>(hierarchy.nodes.size());
+		hierarchy.nodes.push_back(node);
+		hierarchy.parents.push_back(-1);
+	}
+	for (size_t i = 0; i < hierarchy.nodes.size(); i++) {
+		for (auto child : hierarchy.nodes[i]->children) {
+			child->hierarchyIndex = static_cast<uint32_t>(hierarchy.nodes.size());
+			hierarchy.nodes.push_back(child);
+			hierarchy.parents.push_back(static_cast<int32_t>(i));
+		}
+	}
+	hierarchy.worldMatrices.assign(hierarchy.nodes.size(), glm::mat4(1.0f));
+	hierarchy.dirty.assign(hierarchy.nodes.size(), 1);
+	hierarchy.changed.assign(hierarchy.nodes.size(), 0);
+}
 
-		VkWriteDescriptorSet writeDescriptorSet{};
-		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorSet.descriptorCount = 1;
-		writeDescriptorSet.dstSet = node->mesh->uniformBuffer.descriptorSet;
-		writeDescriptorSet.dstBinding = 0;
-		writeDescriptorSet.pBufferInfo = &node->mesh->uniformBuffer.descriptor;
+void vkglTF::Model::createMeshUniforms()
+{
+	uint32_t meshCount = 0;
+	for (auto node : linearNodes) {
+		if (node->mesh) {
+			meshCount++;
+		}
+	}
+	if (meshCount == 0) {
+		return;
+	}
 
-		vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+	// One buffer for all meshes instead of a buffer and memory allocation per mesh, each slot aligned for use as a dynamic offset
+	// The stride is also a multiple of 16 bytes, so the indirect path can address the slots in vec4s
+	const VkDeviceSize alignment = std::max<VkDeviceSize>({ device->properties.limits.minUniformBufferOffsetAlignment, device->properties.limits.minStorageBufferOffsetAlignment, 16 });
+	uniforms.stride = (sizeof(Mesh::UniformBlock) + alignment - 1) / alignment * alignment;
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		uniforms.stride * meshCount,
+		&uniforms.buffer,
+		&uniforms.allocation));
+
+	uint32_t slot = 0;
+	for (auto node : linearNodes) {
+		if (node->mesh) {
+			Mesh::UniformBuffer& uniformBuffer = node->mesh->uniformBuffer;
+			uniformBuffer.buffer = uniforms.buffer;
+			uniformBuffer.dynamicOffset = static_cast<uint32_t>(uniforms.stride * slot);
+			uniformBuffer.descriptor = { uniforms.buffer, uniformBuffer.dynamicOffset, sizeof(Mesh::UniformBlock) };
+			// Host visible blocks stay persistently mapped by the allocator
+			uniformBuffer.mapped = static_cast<uint8_t*>(uniforms.allocation.mapped) + uniformBuffer.dynamicOffset;
+			memcpy(uniformBuffer.mapped, &node->mesh->uniformBlock, sizeof(Mesh::UniformBlock));
+			slot++;
+		}
 	}
-	for (auto& child : node->children) {
-		prepareNodeDescriptor(child, descriptorSetLayout);
+}
+
+void vkglTF::Model::createMaterialTable()
+{
+	Cetus::BindlessTable& table = device->bindlessTable;
+	for (auto& texture : textures) {
+		texture.bindlessIndex = table.registerTexture(texture.descriptor);
 	}
+	emptyTexture.bindlessIndex = table.registerTexture(emptyTexture.descriptor);
+
+	auto textureIndex = [](const vkglTF::Texture* texture) {
+		return texture ? texture->bindlessIndex : Cetus::BindlessTable::invalidIndex;
+	};
+	std::vector<MaterialData> materialData(materials.size());
+	for (auto& material : materials) {
+		MaterialData& data = materialData[material.index];
+		data = {};
+		data.baseColorFactor = material.baseColorFactor;
+		// Materials without a base color map sample the empty texture, like the per material image sets
+		data.baseColorTexture = material.baseColorTexture ? material.baseColorTexture->bindlessIndex : emptyTexture.bindlessIndex;
+		data.metallicRoughnessTexture = textureIndex(material.metallicRoughnessTexture);
+		data.normalTexture = textureIndex(material.normalTexture);
+		data.occlusionTexture = textureIndex(material.occlusionTexture);
+		data.emissiveTexture = textureIndex(material.emissiveTexture);
+		data.alphaMode = static_cast<uint32_t>(material.alphaMode);
+		data.alphaCutoff = material.alphaCutoff;
+		data.metallicFactor = material.metallicFactor;
+		data.roughnessFactor = material.roughnessFactor;
+	}
+
+	const VkDeviceSize bufferSize = materialData.size() * sizeof(MaterialData);
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		Cetus::MemoryUsage::Dynamic,
+		bufferSize,
+		&materialTable.buffer,
+		&materialTable.allocation,
+		materialData.data()));
+
+	// Layout is global, so only create if it hasn't already been created before
+	if (descriptorSetLayoutMaterials == VK_NULL_HANDLE) {
+		VkDescriptorSetLayoutBinding setLayoutBinding = Cetus::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+		descriptorSetLayoutMaterials = device->descriptorAllocator.createLayout(&setLayoutBinding, 1);
+		assert(descriptorSetLayoutMaterials != VK_NULL_HANDLE);
+	}
+	VK_CHECK_RESULT(device->descriptorAllocator.allocate(descriptorSetLayoutMaterials, &materialTable.descriptorSet));
+	VkDescriptorBufferInfo bufferInfo{ materialTable.buffer, 0, bufferSize };
+	VkWriteDescriptorSet writeDescriptorSet = Cetus::initializers::writeDescriptorSet(materialTable.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &bufferInfo);
+	vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+void vkglTF::Model::createIndirectDraws()
+{
+	// Group the primitives by alpha mode, in node order within a group
+	std::vector<Primitive*> buckets[3];
+	for (auto node : linearNodes) {
+		if (node->mesh) {
+			for (Primitive* primitive : node->mesh->primitives) {
+				buckets[primitive->material.alphaMode].push_back(primitive);
+			}
+		}
+	}
+
+	std::vector<VkDrawIndexedIndirectCommand> commands;
+	std::vector<DrawData> drawData;
+	std::vector<glm::vec4> bounds;
+	for (uint32_t i = 0; i < 3; i++) {
+		indirect.buckets[i].first = static_cast<uint32_t>(commands.size());
+		indirect.buckets[i].count = static_cast<uint32_t>(buckets[i].size());
+		for (Primitive* primitive : buckets[i]) {
+			primitive->drawIndex = static_cast<uint32_t>(commands.size());
+			VkDrawIndexedIndirectCommand command{};
+			command.indexCount = primitive->indexCount;
+			command.instanceCount = 1;
+			command.firstIndex = primitive->firstIndex;
+			command.vertexOffset = 0;	// Indices already include the primitive's first vertex
+			command.firstInstance = primitive->drawIndex;
+			commands.push_back(command);
+			DrawData data{};
+			data.bucket = i;
+			drawData.push_back(data);
+			bounds.push_back(glm::vec4(primitive->dimensions.center, primitive->dimensions.radius));
+		}
+	}
+	// The owning mesh is only known through the node, so fill the per draw data in a second pass
+	for (auto node : linearNodes) {
+		if (node->mesh) {
+			for (Primitive* primitive : node->mesh->primitives) {
+				DrawData& data = drawData[primitive->drawIndex];
+				data.uniformOffset = node->mesh->uniformBuffer.dynamicOffset / 16;
+				data.materialIndex = primitive->material.index;
+			}
+		}
+	}
+	indirect.drawCount = static_cast<uint32_t>(commands.size());
+	if (indirect.drawCount == 0) {
+		return;
+	}
+
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		Cetus::MemoryUsage::Dynamic,
+		commands.size() * sizeof(VkDrawIndexedIndirectCommand),
+		&indirect.commandBuffer,
+		&indirect.commandAllocation,
+		commands.data()));
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		Cetus::MemoryUsage::Dynamic,
+		drawData.size() * sizeof(DrawData),
+		&indirect.drawDataBuffer,
+		&indirect.drawDataAllocation,
+		drawData.data()));
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		Cetus::MemoryUsage::Dynamic,
+		bounds.size() * sizeof(glm::vec4),
+		&indirect.boundsBuffer,
+		&indirect.boundsAllocation,
+		bounds.data()));
+	// Only written by the culling shader
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		Cetus::MemoryUsage::GpuOnly,
+		commands.size() * sizeof(VkDrawIndexedIndirectCommand),
+		&indirect.culledCommandBuffer,
+		&indirect.culledCommandAllocation));
+	VK_CHECK_RESULT(device->createBuffer(
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		Cetus::MemoryUsage::GpuOnly,
+		Cetus::DrawCuller::bucketCount * sizeof(uint32_t),
+		&indirect.countBuffer,
+		&indirect.countAllocation));
+
+	// Layout is global, so only create if it hasn't already been created before
+	if (descriptorSetLayoutDraws == VK_NULL_HANDLE) {
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			Cetus::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+			Cetus::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1),
+		};
+		descriptorSetLayoutDraws = device->descriptorAllocator.createLayout(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+		assert(descriptorSetLayoutDraws != VK_NULL_HANDLE);
+	}
+	VK_CHECK_RESULT(device->descriptorAllocator.allocate(descriptorSetLayoutDraws, &indirect.descriptorSet));
+	VkDescriptorBufferInfo drawDataInfo{ indirect.drawDataBuffer, 0, VK_WHOLE_SIZE };
+	VkDescriptorBufferInfo uniformsInfo{ uniforms.buffer, 0, VK_WHOLE_SIZE };
+	std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+		Cetus::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &drawDataInfo),
+		Cetus::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &uniformsInfo),
+	};
+	vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
 }
@@ -13,6 +13,7 @@
 
 #include "vulkan/vulkan.h"
 #include "VulkanDevice.h"
+#include "VulkanDrawCuller.h"
 
 
 #define GLM_FORCE_RADIANS
@@ -30,8 +31,13 @@ namespace vkglTF
 
 	extern VkDescriptorSetLayout descriptorSetLayoutImage;
 	extern VkDescriptorSetLayout descriptorSetLayoutUbo;
+	extern VkDescriptorSetLayout descriptorSetLayoutMaterials;
+	extern VkDescriptorSetLayout descriptorSetLayoutDraws;
 	extern VkMemoryPropertyFlags memoryPropertyFlags;
 	extern uint32_t descriptorBindingFlags;
+	// Where RenderFlags::PushMaterialIndex writes the material index (a single uint) into the pipeline layout's push constant range
+	extern uint32_t materialIndexPushConstantOffset;
+	extern VkShaderStageFlags materialIndexPushConstantStages;
 
 	struct Node;
 
@@ -43,15 +49,21 @@ namespace vkglTF
 		VkImage image;
 		VkImageLayout imageLayout;
 		VkDeviceMemory deviceMemory;
+		Cetus::Allocation allocation;
 		VkImageView view;
 		uint32_t width, height;
 		uint32_t mipLevels;
 		uint32_t layerCount;
 		VkDescriptorImageInfo descriptor;
 		VkSampler sampler;
+		// Slot in the device's bindless texture table, only registered for models loaded with FileLoadingFlags::BindlessTextures
+		uint32_t bindlessIndex = Cetus::BindlessTable::invalidIndex;
 		void updateDescriptor();
+		// Hands the image and the bindless slot to VulkanDevice::deferFree, frames still in flight may sample them
 		void destroy();
+		// Uploads the image with all its mip levels, the image's pixel data is released afterwards (Model::loadImages batches all images of a model)
 		void fromglTfImage(tinygltf::Image& gltfimage, std::string path, Cetus::VulkanDevice* device, VkQueue copyQueue);
+		void createSamplerAndView(VkFormat format);
 	};
 
 	/*
@@ -75,9 +87,40 @@ namespace vkglTF
 		vkglTF::Texture* diffuseTexture;
 
 		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		// Index into the model's material list and material table
+		uint32_t index = 0;
 
 		Material(Cetus::VulkanDevice* device) : device(device) {};
-		void createDescriptorSet(VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
+		void createDescriptorSet(VkDescriptorSetLayout descriptorSetLayout, uint32_t descriptorBindingFlags);
+	};
+
+	/*
+		GPU side material record of the bindless material table (std430 layout)
+		Texture members are slots in the bindless texture table, BindlessTable::invalidIndex if the material has no such texture
+	*/
+	struct MaterialData {
+		glm::vec4 baseColorFactor;
+		uint32_t baseColorTexture;
+		uint32_t metallicRoughnessTexture;
+		uint32_t normalTexture;
+		uint32_t occlusionTexture;
+		uint32_t emissiveTexture;
+		uint32_t alphaMode;
+		float alphaCutoff;
+		float metallicFactor;
+		float roughnessFactor;
+		uint32_t padding[3];
+	};
+
+	/*
+		GPU side per draw record of the indirect draw path (std430 layout), indexed with gl_InstanceIndex
+		(every indirect command draws one instance with firstInstance set to its draw index)
+	*/
+	struct DrawData {
+		uint32_t uniformOffset;		// Offset of the mesh's UniformBlock in the mesh uniform buffer, in vec4s
+		uint32_t materialIndex;
+		uint32_t bucket;			// Material::AlphaMode of the primitive, used by the GPU culler to compact per bucket
+		uint32_t padding;
 	};
 
 	/*
@@ -89,6 +132,8 @@ namespace vkglTF
 		uint32_t firstVertex;
 		uint32_t vertexCount;
 		Material& material;
+		// Index of this primitive's command in the indirect draw buffer, only set for models loaded with FileLoadingFlags::IndirectDraw
+		uint32_t drawIndex = UINT32_MAX;
 
 		struct Dimensions {
 			glm::vec3 min = glm::vec3(FLT_MAX);
@@ -111,12 +156,13 @@ namespace vkglTF
 		std::vector<Primitive*> primitives;
 		std::string name;
 
+		// A slice of the model's shared uniform buffer, bound through the model's dynamic uniform buffer descriptor set
 		struct UniformBuffer {
-			VkBuffer buffer;
-			VkDeviceMemory memory;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			uint32_t dynamicOffset = 0;
 			VkDescriptorBufferInfo descriptor;
 			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-			void* mapped;
+			void* mapped = nullptr;
 		} uniformBuffer;
 
 		struct UniformBlock {
@@ -139,6 +185,18 @@ namespace vkglTF
 		std::vector<Node*> joints;
 	};
 
+	/*
+		Flattened node hierarchy, sorted so that every parent comes before its children
+		World matrices are cached and only recomputed for dirty nodes and their descendants, in a single linear pass
+	*/
+	struct NodeHierarchy {
+		std::vector<Node*> nodes;
+		std::vector<int32_t> parents;			// Index of the parent in nodes, -1 for root nodes
+		std::vector<glm::mat4> worldMatrices;	// Contiguous, so all of them can be uploaded with a single memcpy
+		std::vector<uint8_t> dirty;				// Local transform changed since the last update
+		std::vector<uint8_t> changed;			// World matrix recomputed by the last update
+	};
+
 	/*
 		glTF node
 	*/
@@ -154,9 +212,13 @@ namespace vkglTF
 		glm::vec3 translation{};
 		glm::vec3 scale{ 1.0f };
 		glm::quat rotation{};
+		// Slot in the model's flattened hierarchy
+		uint32_t hierarchyIndex = UINT32_MAX;
 		glm::mat4 localMatrix();
+		// Walks up to the root for every call, prefer the cached NodeHierarchy::worldMatrices
 		glm::mat4 getMatrix();
-		void update();
+		// Writes the mesh's (and skin's joint) matrices to its uniform buffer from the hierarchy's cached world matrices
+		void update(const NodeHierarchy& hierarchy);
 		~Node();
 	};
 
@@ -168,6 +230,8 @@ namespace vkglTF
 		PathType path;
 		Node* node;
 		uint32_t samplerIndex;
+		// Keyframe interval found by the last update, forward playback usually finds the next one right here
+		uint32_t cursor = 0;
 	};
 
 	/*
@@ -177,7 +241,13 @@ namespace vkglTF
 		enum InterpolationType { LINEAR, STEP, CUBICSPLINE };
 		InterpolationType interpolation;
 		std::vector<float> inputs;
+		// Quaternions are stored as (x, y, z, w); CUBICSPLINE stores (in tangent, value, out tangent) per key
 		std::vector<glm::vec4> outputsVec4;
+		bool valid() const;
+		/** @brief Returns the interval i with inputs[i] <= time <= inputs[i + 1], checks the cursor and its successor before a binary search */
+		uint32_t findInterval(float time, uint32_t cursor) const;
+		/** @brief Evaluates the sampler at time (clamped to the first and last key), rotations are slerped and normalized */
+		glm::vec4 sample(float time, uint32_t& cursor, bool rotation) const;
 	};
 
 	/*
@@ -196,6 +266,8 @@ namespace vkglTF
 	*/
 	enum class VertexComponent { Position, Normal, UV, Color, Tangent, Joint0, Weight0 };
 
+	struct VertexLayout;
+
 	struct Vertex {
 		glm::vec3 pos;
 		glm::vec3 normal;
@@ -205,6 +277,7 @@ namespace vkglTF
 		glm::vec4 weight0;
 		glm::vec4 tangent;
 		static VkVertexInputBindingDescription vertexInputBindingDescription;
+		static std::vector<VkVertexInputBindingDescription> vertexInputBindingDescriptions;
 		static std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
 		static VkPipelineVertexInputStateCreateInfo pipelineVertexInputStateCreateInfo;
 		static VkVertexInputBindingDescription inputBindingDescription(uint32_t binding);
@@ -212,6 +285,41 @@ namespace vkglTF
 		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, const std::vector<VertexComponent> components);
 		/** @brief Returns the default pipeline vertex input state create info structure for the requested vertex components */
 		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const std::vector<VertexComponent> components);
+		/**
+			@brief Returns the pipeline vertex input state for a model loaded with the given layout, one attribute per layout component at locations 0..n-1
+			With a position stream the position is location 0 at binding 0 and the other components follow from binding 1
+			positionsOnly returns the state for drawing with RenderFlags::PositionsOnly: just the position stream at binding 0, location 0
+		*/
+		static VkPipelineVertexInputStateCreateInfo* getPipelineVertexInputState(const VertexLayout& layout, bool positionsOnly = false);
+	};
+
+	/*
+		Layout of a model's vertex buffer, set in Model::vertexLayout before loading
+		Without components the buffer holds complete Vertex structs, otherwise only the listed components, tightly packed in the listed order
+		Quantized components use compact formats that need matching shader inputs:
+			Position	R32G32B32_SFLOAT
+			Normal		R16G16_SNORM, octahedral encoded, decode with octDecode from shaders/base/vertexpacking.glsl
+			UV			R16G16_SFLOAT
+			Color		R8G8B8A8_UNORM
+			Tangent		R16G16_SNORM, octahedral encoded with the handedness in the sign of y, decode with tangentDecode
+			Joint0		R8G8B8A8_UINT, read as uvec4
+			Weight0		R8G8B8A8_UNORM
+	*/
+	struct VertexLayout {
+		std::vector<VertexComponent> components;
+		bool quantized = false;
+		// Also store the positions de-interleaved in Model::positions (R32G32B32_SFLOAT, 12 byte stride), bound at binding 0 while the
+		// vertex buffer moves to binding 1, so depth and shadow passes fetch positions only; leave Position out of components to not store it twice
+		bool positionStream = false;
+
+		bool packed() const { return !components.empty(); }
+		uint32_t stride() const;
+		VkFormat format(VertexComponent component) const;
+		uint32_t size(VertexComponent component) const;
+		/** @brief Unique key of the layout, used to tell cooked mesh caches of different layouts apart */
+		uint32_t key() const;
+		/** @brief Writes count vertices in this layout to dst (count * stride() bytes), fails if quantized joint indices don't fit into 8 bits */
+		bool pack(const Vertex* vertices, size_t count, unsigned char* dst) const;
 	};
 
 	enum FileLoadingFlags {
@@ -219,14 +327,26 @@ namespace vkglTF
 		PreTransformVertices = 0x00000001,
 		PreMultiplyVertexColors = 0x00000002,
 		FlipY = 0x00000004,
-		DontLoadImages = 0x00000008
+		DontLoadImages = 0x00000008,
+		// Register all textures in the device's bindless texture table and put the materials into a storage buffer instead of creating per material image descriptor sets
+		// Falls back to per material sets if the device has no bindless support, check Model::bindless after loading
+		BindlessTextures = 0x00000010,
+		// Flatten all primitives into an indirect draw buffer and a per draw data buffer for drawIndirect
+		// Ignored if the device was created without the drawIndirectFirstInstance feature, check Model::indirectDraw after loading and use draw otherwise
+		IndirectDraw = 0x00000020,
+		// Neither read nor write the cooked mesh cache (<file>.meshcache) holding the final vertex and index buffers
+		DontUseMeshCache = 0x00000040
 	};
 
 	enum RenderFlags {
 		BindImages = 0x00000001,
 		RenderOpaqueNodes = 0x00000002,
 		RenderAlphaMaskedNodes = 0x00000004,
-		RenderAlphaBlendedNodes = 0x00000008
+		RenderAlphaBlendedNodes = 0x00000008,
+		// Push the material index as a push constant instead of binding the material's image set (bindless models, see bindMaterials)
+		PushMaterialIndex = 0x00000010,
+		// Only bind the position stream (VertexLayout::positionStream), for depth prepass and shadow pipelines
+		PositionsOnly = 0x00000020
 	};
 
 	/*
@@ -237,23 +357,65 @@ namespace vkglTF
 		vkglTF::Texture* getTexture(uint32_t index);
 		vkglTF::Texture emptyTexture;
 		void createEmptyTexture(VkQueue transferQueue);
+		void bindVertexBuffers(VkCommandBuffer commandBuffer, uint32_t renderFlags);
 	public:
 		Cetus::VulkanDevice* device;
-		VkDescriptorPool descriptorPool;
 
 		struct Vertices {
 			int count;
-			VkBuffer buffer;
-			VkDeviceMemory memory;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Cetus::Allocation allocation;
 		} vertices;
 		struct Indices {
 			int count;
-			VkBuffer buffer;
-			VkDeviceMemory memory;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Cetus::Allocation allocation;
 		} indices;
+		// Tightly packed positions, only created with VertexLayout::positionStream
+		struct Positions {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Cetus::Allocation allocation;
+		} positions;
+		// Uniform blocks of all meshes, one aligned slot per mesh
+		struct Uniforms {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Cetus::Allocation allocation;
+			VkDeviceSize stride = 0;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		} uniforms;
+		// Storage buffer with one MaterialData per material, only created for bindless models
+		struct MaterialTable {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			Cetus::Allocation allocation;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		} materialTable;
+		// All primitives flattened at load time, one VkDrawIndexedIndirectCommand and one DrawData per primitive
+		// Commands are grouped into one contiguous bucket per alpha mode, so a bucket is drawn with a single vkCmdDrawIndexedIndirect
+		struct IndirectDraws {
+			VkBuffer commandBuffer = VK_NULL_HANDLE;
+			Cetus::Allocation commandAllocation;
+			VkBuffer drawDataBuffer = VK_NULL_HANDLE;
+			Cetus::Allocation drawDataAllocation;
+			// Binding 0: DrawData array, binding 1: the mesh uniform buffer as a vec4 array
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			// GPU culling inputs and outputs (see Cetus::DrawCuller): a local bounding sphere per draw,
+			// the culled command buffer (same size and bucket layout as commandBuffer) and the visible count per bucket
+			VkBuffer boundsBuffer = VK_NULL_HANDLE;
+			Cetus::Allocation boundsAllocation;
+			VkBuffer culledCommandBuffer = VK_NULL_HANDLE;
+			Cetus::Allocation culledCommandAllocation;
+			VkBuffer countBuffer = VK_NULL_HANDLE;
+			Cetus::Allocation countAllocation;
+			struct Bucket {
+				uint32_t first = 0;
+				uint32_t count = 0;
+			} buckets[3];				// Indexed by Material::AlphaMode
+			uint32_t drawCount = 0;
+		} indirect;
 
 		std::vector<Node*> nodes;
 		std::vector<Node*> linearNodes;
+		NodeHierarchy hierarchy;
 
 		std::vector<Skin*> skins;
 
@@ -271,24 +433,70 @@ namespace vkglTF
 
 		bool metallicRoughnessWorkflow = true;
 		bool buffersBound = false;
+		bool bindless = false;
+		// Set if the model was loaded with FileLoadingFlags::IndirectDraw and the device supports it
+		bool indirectDraw = false;
 		std::string path;
+		// Base address of every glTF buffer while loading, memory mapped buffers point into their file mapping
+		std::vector<const unsigned char*> bufferData;
+		// Layout the vertex buffer is written in, has to be set before loadFromFile
+		VertexLayout vertexLayout;
+		// Set while loading from a valid mesh cache: loadNode then only advances these counts instead of decoding accessors
+		struct CookedGeometry {
+			bool loaded = false;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+		} cookedGeometry;
 
 		Model() {};
 		~Model();
+		/** @brief Returns the first element of an accessor, read directly from the mapped file for memory mapped buffers */
+		const unsigned char* accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor) const;
 		void loadNode(vkglTF::Node* parent, const tinygltf::Node& node, uint32_t nodeIndex, const tinygltf::Model& model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale);
 		void loadSkins(tinygltf::Model& gltfModel);
 		void loadImages(tinygltf::Model& gltfModel, Cetus::VulkanDevice* device, VkQueue transferQueue);
 		void loadMaterials(tinygltf::Model& gltfModel);
 		void loadAnimations(tinygltf::Model& gltfModel);
 		void loadFromFile(std::string filename, Cetus::VulkanDevice* device, VkQueue transferQueue, uint32_t fileLoadingFlags = vkglTF::FileLoadingFlags::None, float scale = 1.0f);
-		void bindBuffers(VkCommandBuffer commandBuffer);
+		/** @brief Binds the vertex streams and the index buffer once for the following draws, pass RenderFlags::PositionsOnly to bind only the position stream */
+		void bindBuffers(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0);
+		/** @brief Binds the bindless texture table at firstSet and the model's material table at firstSet + 1, once per command buffer instead of an image set per draw */
+		void bindMaterials(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t firstSet);
 		void drawNode(Node* node, VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1);
 		void draw(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, VkPipelineLayout pipelineLayout = VK_NULL_HANDLE, uint32_t bindImageSet = 1);
+		/** @brief Binds the per draw data set (see IndirectDraws::descriptorSet) at the given set index */
+		void bindDrawData(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set);
+		/**
+			@brief Draws the alpha mode buckets selected by the Render*Nodes flags (all if none is set) with one indirect draw per bucket
+			Shaders fetch their DrawData with gl_InstanceIndex, which needs the drawIndirectFirstInstance feature,
+			so this is only valid if Model::indirectDraw is set; without multiDrawIndirect each command is issued as its own indirect draw.
+			With culled set the commands written by the last DrawCuller::cull of getCullDrawSet() are drawn instead
+		*/
+		void drawIndirect(VkCommandBuffer commandBuffer, uint32_t renderFlags = 0, bool culled = false);
+		/**
+			@brief Returns the model's draws for Cetus::DrawCuller::cull, after which drawIndirect with culled = true
+			draws from the culled command buffer (with the per bucket counts if the culler is compacting)
+		*/
+		Cetus::DrawCuller::DrawSet getCullDrawSet() const;
 		void getNodeDimensions(Node* node, glm::vec3& min, glm::vec3& max);
 		void getSceneDimensions();
 		void updateAnimation(uint32_t index, float time);
+		struct AnimationUpdate {
+			Model* model;
+			uint32_t animation;
+			float time;
+		};
+		/** @brief Updates the animations of many models in parallel on the task scheduler, a model must not appear twice */
+		static void updateAnimations(const AnimationUpdate* updates, uint32_t count);
+		/** @brief Flags a node whose translation, rotation, scale or matrix was changed, picked up by the next updateHierarchy */
+		void markDirty(Node* node);
+		/** @brief Recomputes the world matrices of dirty nodes and their descendants and updates the affected mesh uniforms */
+		void updateHierarchy();
 		Node* findNode(Node* parent, uint32_t index);
 		Node* nodeFromIndex(uint32_t index);
-		void prepareNodeDescriptor(vkglTF::Node* node, VkDescriptorSetLayout descriptorSetLayout);
+		void buildHierarchy();
+		void createMeshUniforms();
+		void createMaterialTable();
+		void createIndirectDraws();
 	};
 }
\ No newline at end of file
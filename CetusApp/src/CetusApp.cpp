@@ -2,16 +2,39 @@
 #include "Cetus/EntryPoint.h"
 
 #include "Cetus/Image.h"
+#include "Cetus/MemoryStatsLayer.h"
+#include "Cetus/Random.h"
+#include "Cetus/Renderer.h"
+#include "Cetus/Timer.h"
 
 class ExampleLayer : public Cetus::Layer
 {
 public:
+	virtual void OnUpdate(float ts) override
+	{
+		if (m_Rendering && !m_Renderer.IsRendering())
+		{
+			m_LastRenderTime = m_Timer.ElapsedMillis();
+			m_Rendering = false;
+		}
+
+		if (m_Progressive)
+			RenderProgressive();
+	}
+
 	virtual void OnUIRender() override
 	{
 		ImGui::Begin("Hello");
-		if(ImGui::Button("Render")) {
+		ImGui::Text("Last render: %.3fms", m_LastRenderTime);
+		if(ImGui::Button("Render") && !m_Progressive) {
 			Render();
 		};
+		ImGui::ProgressBar(m_Renderer.GetProgress());
+		ImGui::Separator();
+		ImGui::Checkbox("Progressive", &m_Progressive);
+		ImGui::DragFloat("Radius", &m_Radius, 1.0f, 1.0f, 1000.0f);
+		ImGui::SliderFloat("Frame budget (ms)", &m_Renderer.GetSettings().FrameBudget, 1.0f, 33.0f);
+		ImGui::Text("Passes: %u, unconverged pixels: %llu", m_Renderer.GetAccumulationPasses(), (unsigned long long)m_Renderer.GetActivePixelCount());
 		ImGui::End();
 
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
@@ -20,27 +43,62 @@ public:
 		m_ViewportWidth = static_cast<uint32_t>(ImGui::GetContentRegionAvail().x);
 		m_ViewportHeight = static_cast<uint32_t>(ImGui::GetContentRegionAvail().y);
 
-		if(m_Image)
-			ImGui::Image(m_Image->GetDescriptorSet(), { (float)m_Image->GetWidth(),(float)m_Image->GetHeight() });
+		m_Renderer.UpdateImage();	// upload the tiles finished since the last frame
+		auto image = m_Renderer.GetFinalImage();
+		if (image)
+		{
+			// The image may be allocated larger than it is; only show the part that holds the render
+			glm::vec2 uv = image->GetUVScale();
+			ImGui::Image(image->GetDescriptorSet(), { (float)image->GetWidth(),(float)image->GetHeight() }, { 0.0f, 0.0f }, { uv.x, uv.y });
+		}
 
 		ImGui::End();
 		ImGui::PopStyleVar();
 	}
 	void Render() {
-		if (!m_Image || m_ViewportWidth != m_Image->GetWidth() || m_ViewportHeight != m_Image->GetHeight()) {
-			m_Image = std::make_shared<Cetus::Image>(m_ViewportWidth, m_ViewportHeight, Cetus::ImageFormat::RGBA);
-			delete[] m_ImageData;
-			m_ImageData = new uint32_t[m_ViewportWidth * m_ViewportHeight];
-		}
-		for (uint32_t i = 0; i < m_ViewportWidth * m_ViewportHeight; i++) {
-			m_ImageData[i] = 0xffff00ff;
-		}
-		m_Image->SetData(m_ImageData);
+		if (m_ViewportWidth == 0 || m_ViewportHeight == 0)
+			return;
+
+		m_Timer.Reset();
+		m_Renderer.OnResize(m_ViewportWidth, m_ViewportHeight);
+		m_Renderer.Render([](const Cetus::Tile& tile, uint32_t* imageData, uint32_t width) {
+			for (uint32_t y = tile.Y; y < tile.Y + tile.Height; y++) {
+				for (uint32_t x = tile.X; x < tile.X + tile.Width; x++) {
+					imageData[x + y * width] = 0xffff00ff;
+				}
+			}
+		});
+		m_Rendering = true;
 	};
+
+	void RenderProgressive() {
+		if (m_ViewportWidth == 0 || m_ViewportHeight == 0)
+			return;
+
+		// Anything that changes the picture must go into the hash so the accumulation restarts
+		uint64_t sceneHash = std::hash<float>()(m_Radius);
+
+		m_Renderer.OnResize(m_ViewportWidth, m_ViewportHeight);
+		float centerX = m_ViewportWidth * 0.5f, centerY = m_ViewportHeight * 0.5f, radius = m_Radius;
+		uint32_t width = m_ViewportWidth;
+		m_Renderer.RenderProgressive([=](uint32_t x, uint32_t y, uint32_t sample) {
+			// Jittered sample of an anti-aliased disc: only pixels on the edge stay noisy
+			uint32_t pixel = x + y * width;
+			float dx = x + Cetus::Random::FloatAt(pixel, sample, 0) - centerX;
+			float dy = y + Cetus::Random::FloatAt(pixel, sample, 1) - centerY;
+			return dx * dx + dy * dy < radius * radius ? glm::vec4(1.0f, 0.0f, 1.0f, 1.0f) : glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
+		}, sceneHash);
+	}
 private:
-	std::shared_ptr<Cetus::Image> m_Image;
+	Cetus::Renderer m_Renderer;
 	uint32_t m_ViewportWidth = 0, m_ViewportHeight = 0;
-	uint32_t* m_ImageData = nullptr;
+
+	Cetus::Timer m_Timer;
+	float m_LastRenderTime = 0.0f;
+	bool m_Rendering = false;
+
+	bool m_Progressive = false;
+	float m_Radius = 100.0f;
 };
 
 Cetus::Application* Cetus::CreateApplication(int argc, char** argv)
@@ -50,6 +108,7 @@ Cetus::Application* Cetus::CreateApplication(int argc, char** argv)
 
 	Cetus::Application* app = new Cetus::Application(spec);
 	app->PushLayer<ExampleLayer>();
+	app->PushLayer<Cetus::MemoryStatsLayer>();
 	app->SetMenubarCallback([app]()
 	{
 		if (ImGui::BeginMenu("File"))
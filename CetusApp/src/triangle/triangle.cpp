@@ -13,6 +13,7 @@
 
 #include <vulkan/vulkan.h>
 #include "base/test/VulkanBase.h"
+#include "base/VulkanUniformAllocator.h"
 
 #define ENABLE_VALIDATION true
 #define MAX_CONCURRENT_FRAMES 2
@@ -36,13 +37,9 @@ public:
 		uint32_t count;
 	} indices;
 
-	struct UniformBuffer {
-		VkDeviceMemory memory;
-		VkBuffer buffer;
-		VkDescriptorSet descriptorSet;
-		uint8_t* mapped{ nullptr };
-	};
-	std::array<UniformBuffer, MAX_CONCURRENT_FRAMES> uniformBuffers;
+	// ÿ֡UniformݶͬһפӳĻз䣬ֻһ̬Uniformʱ붯̬ƫ
+	Cetus::UniformAllocator uniformAllocator;
+	VkDescriptorSet descriptorSet;
 
 	struct ShaderData {
 		glm::mat4 projectionMatrix;
@@ -89,9 +86,8 @@ public:
 			vkDestroyFence(device, waitFences[i], nullptr);
 			vkDestroySemaphore(device, presentCompleteSemaphores[i], nullptr);
 			vkDestroySemaphore(device, renderCompleteSemaphores[i], nullptr);
-			vkDestroyBuffer(device, uniformBuffers[i].buffer, nullptr);
-			vkFreeMemory(device, uniformBuffers[i].memory, nullptr);
 		}
+		uniformAllocator.destroy();
 	}
 
 	void prepare()
@@ -186,7 +182,7 @@ public:
 	{	// ֺ͹ֵ߲ĺ
 		// ְ
 		VkDescriptorSetLayoutBinding layoutBinding{};
-		layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;	// ΪUniform
+		layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;	// Ϊ̬Uniformƫڰʱ
 		layoutBinding.descriptorCount = 1;									// Ϊ1
 		layoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;				// ڶɫ׶ʹ
 		layoutBinding.pImmutableSamplers = nullptr;							// ʹòɱĲ
@@ -449,37 +445,16 @@ public:
 	}
 
 	void createUniformBuffers()
-	{
-		VkBufferCreateInfo bufferInfo{};		// 建Ϣṹ
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(ShaderData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		VkMemoryAllocateInfo allocInfo{};		// ڴϢṹ
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = nullptr;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-		VkMemoryRequirements memReqs;
-
-		// ѭ֡Uniform
-		for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
-			VK_CHECK_RESULT(vkCreateBuffer(device, &bufferInfo, nullptr, &uniformBuffers[i].buffer));	// Uniform
-			vkGetBufferMemoryRequirements(device, uniformBuffers[i].buffer, &memReqs);					// ȡڴ
-			allocInfo.allocationSize = memReqs.size;													// ڴϢ
-			allocInfo.memoryTypeIndex = vulkanDevice->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &(uniformBuffers[i].memory)));
-			VK_CHECK_RESULT(vkBindBufferMemory(device, uniformBuffers[i].buffer, uniformBuffers[i].memory, 0));// ڴ뻺
-			VK_CHECK_RESULT(vkMapMemory(device, uniformBuffers[i].memory, 0, sizeof(ShaderData), 0, (void**)&uniformBuffers[i].mapped));// ӳڴ浽CPUɷʵָ
-		}
+	{	// ÿ֡һΣÿܷһShaderDataʱѶεĴСΪԶShaderDataС
+		VK_CHECK_RESULT(uniformAllocator.create(vulkanDevice, sizeof(ShaderData), MAX_CONCURRENT_FRAMES));
 	}
 
 	void createDescriptorPool()
 	{
-		// ͺuniform͵
+		// ͺֻһ̬uniform͵
 		VkDescriptorPoolSize descriptorTypeCounts[1];
-		descriptorTypeCounts[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorTypeCounts[0].descriptorCount = MAX_CONCURRENT_FRAMES;
+		descriptorTypeCounts[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorTypeCounts[0].descriptorCount = 1;
 
 		// ʼϢṹ
 		VkDescriptorPoolCreateInfo descriptorPoolCI{};
@@ -487,40 +462,34 @@ public:
 		descriptorPoolCI.pNext = nullptr;
 		descriptorPoolCI.poolSizeCount = 1;
 		descriptorPoolCI.pPoolSizes = descriptorTypeCounts;
-		descriptorPoolCI.maxSets = MAX_CONCURRENT_FRAMES;
+		descriptorPoolCI.maxSets = 1;
 
 		// 
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &descriptorPool));
 	}
 
 	void createDescriptorSets()
-	{	// ʹѭΪÿһ֡
-		for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; i++) {
-			// ϷϢṹ
-			VkDescriptorSetAllocateInfo allocInfo{};
-			allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			allocInfo.descriptorPool = descriptorPool;			// Ϸʹõ
-			allocInfo.descriptorSetCount = 1;					// Ҫ
-			allocInfo.pSetLayouts = &descriptorSetLayout;		// ϵĲ
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &uniformBuffers[i].descriptorSet)); // 
-
-			// дϵĽṹ
-			VkWriteDescriptorSet writeDescriptorSet{};
-
-			// Ϣṹ
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = uniformBuffers[i].buffer;		// Ļ
-			bufferInfo.range = sizeof(ShaderData);				// ĻĴС
-
-			// дϵĽṹ
-			writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writeDescriptorSet.dstSet = uniformBuffers[i].descriptorSet; // Ŀ
-			writeDescriptorSet.dstBinding = 0;					// еİ󶨵
-			writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // ΪUniform
-			writeDescriptorSet.descriptorCount = 1;				// Ҫµ
-			writeDescriptorSet.pBufferInfo = &bufferInfo;		// ָϢָ
-			vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr); // 
-		}
+	{	// ֡һϣÿ̬֡ͨƫѡ
+		// ϷϢṹ
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;			// Ϸʹõ
+		allocInfo.descriptorSetCount = 1;					// Ҫ
+		allocInfo.pSetLayouts = &descriptorSetLayout;		// ϵĲ
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet)); // 
+
+		// ϢƫΪ0ΧһShaderDataʵλɶ̬ƫƾ
+		VkDescriptorBufferInfo bufferInfo = uniformAllocator.descriptor(sizeof(ShaderData));
+
+		// дϵĽṹ
+		VkWriteDescriptorSet writeDescriptorSet{};
+		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSet.dstSet = descriptorSet;			// Ŀ
+		writeDescriptorSet.dstBinding = 0;					// еİ󶨵
+		writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; // Ϊ̬Uniform
+		writeDescriptorSet.descriptorCount = 1;				// Ҫµ
+		writeDescriptorSet.pBufferInfo = &bufferInfo;		// ָϢָ
+		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr); // 
 	}
 
 	void createSynchronizationPrimitives()
@@ -561,7 +530,9 @@ public:
 		shaderData.projectionMatrix = camera.matrices.perspective;
 		shaderData.viewMatrix = camera.matrices.view;
 		shaderData.modelMatrix = glm::mat4(1.0f);
-		memcpy(uniformBuffers[currentBuffer].mapped, &shaderData, sizeof(ShaderData));	// Uniformݿǰ֡ӦĻ
+		uniformAllocator.beginFrame(currentFrame);		// ȹ˵ǰ֡fenceһ֡Ķο·
+		Cetus::UniformAllocation uniforms = uniformAllocator.push(shaderData);			// Uniformд뵱ǰ֡Ķ
+		uniformAllocator.flush();
 
 		VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentFrame]));			// õǰ֡fenceź
 		vkResetCommandBuffer(commandBuffers[currentBuffer], 0);							// õǰ֡Ӧ壬׼ʼ¼
@@ -598,7 +569,7 @@ public:
 		scissor.offset.x = 0;
 		scissor.offset.y = 0;
 		vkCmdSetScissor(commandBuffers[currentBuffer], 0, 1, &scissor);						// ͼι
-		vkCmdBindDescriptorSets(commandBuffers[currentBuffer], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &uniformBuffers[currentBuffer].descriptorSet, 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffers[currentBuffer], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &uniforms.offset);
 		vkCmdBindPipeline(commandBuffers[currentBuffer], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);// ͼι
 		VkDeviceSize offsets[1]{ 0 };					// 󶨶㻺壬
 		vkCmdBindVertexBuffers(commandBuffers[currentBuffer], 0, 1, &vertices.buffer, offsets);